@@ -0,0 +1,268 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_ACCESS_LOG_HPP
+#define FINDER_ACCESS_LOG_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "files.hpp"
+#include "id.hpp"
+#include "os.hpp"
+#include "types.hpp"
+
+/**
+ * Log of files picked by the user (copied from results), which ranks them first in later searches.
+ * Every pick adds 1 to the frecency score of the file, and scores halve every half_life, so files
+ * picked often and recently rank highest.
+ *
+ * Log is a fixed size open addressing hash table keyed by a hash of the full path, since file ids
+ * change between sessions. It is mapped from a file, so picks are persisted as they happen,
+ * without any serialization. When the probe window of a key is full, the entry with the lowest
+ * score is evicted.
+ *
+ * Log also keeps directories of the last picks, which the crawl indexes first.
+ */
+class Access_log {
+public:
+    static constexpr u32 magic = 0x474F4C41; // "ALOG"
+    static constexpr u32 version = 2;
+    static constexpr usize capacity = 4096; // Power of two.
+    static constexpr usize max_probes = 16;
+    static constexpr usize recent_count = 16;
+    static constexpr usize recent_path_size = 256; // With terminating zero.
+    static constexpr f64 half_life = 14.0 * 24 * 3600; // In seconds.
+    static constexpr u64 fnv_basis = 14695981039346656037ULL;
+
+    struct Entry {
+        u64 m_key = 0;     // Full path hash, 0 for empty entry.
+        i64 m_time = 0;    // Last pick, in seconds since epoch.
+        f64 m_score = 0.0; // Score at the last pick.
+    };
+
+    struct Recent_dir {
+        std::array<char, recent_path_size> m_path{}; // Zero terminated, empty if unused.
+    };
+
+    struct Header {
+        u32 m_magic = magic;
+        u32 m_version = version;
+        u64 m_capacity = capacity;
+    };
+
+    static constexpr usize file_size =
+        sizeof(Header) + (capacity * sizeof(Entry)) + (recent_count * sizeof(Recent_dir));
+
+    /**
+     * In memory log, which is lost on exit.
+     */
+    Access_log() : m_data{new std::byte[file_size], [](std::byte* data) { delete[] data; }}
+    {
+        init();
+    }
+
+    /**
+     * Log persisted in the file, which is created if it doesn't exist. Log in a file of another
+     * version is reset.
+     */
+    explicit Access_log(const std::string& path)
+        : m_data{static_cast<std::byte*>(os::map_file(path, file_size)),
+                 [](std::byte* data) { os::unmap_file(data, file_size); }}
+    {
+        if (m_data == nullptr)
+            throw std::runtime_error{std::format("Can't map access log {}.", path)};
+
+        const Header& header = *reinterpret_cast<const Header*>(m_data.get());
+        if (header.m_magic != magic || header.m_version != version ||
+            header.m_capacity != capacity)
+            init();
+    }
+
+    /**
+     * FNV-1a hash, which can continue from a hash of the path prefix. It is stable across builds
+     * and platforms, unlike std::hash.
+     */
+    static constexpr u64 hash(std::string_view text, u64 state = fnv_basis) noexcept
+    {
+        for (const char c : text)
+            state = (state ^ u8(c)) * 1099511628211ULL;
+
+        return state;
+    }
+
+    /**
+     * Key of full path hash. Keys are never 0, which marks empty entries.
+     */
+    static constexpr u64 key(u64 path_hash) noexcept { return path_hash | 1U; }
+
+    /**
+     * Records pick of the file and returns its new score.
+     */
+    f64 record(std::string_view full_path, i64 now) noexcept
+    {
+        record_dir(full_path);
+
+        const u64 k = key(hash(full_path));
+
+        Entry* victim = nullptr;
+        for (usize probe = 0; probe < max_probes; ++probe) {
+            Entry& entry = entries()[(k + probe) & (capacity - 1)];
+            if (entry.m_key == k) {
+                entry.m_score = score(entry, now) + 1.0;
+                entry.m_time = now;
+                return entry.m_score;
+            }
+
+            if (entry.m_key == 0) {
+                victim = &entry;
+                break;
+            }
+
+            if (victim == nullptr || score(entry, now) < score(*victim, now))
+                victim = &entry;
+        }
+
+        *victim = Entry{.m_key = k, .m_time = now, .m_score = 1.0};
+        return victim->m_score;
+    }
+
+    /**
+     * Current score of the file, 0 if it was never picked (or it was evicted).
+     */
+    [[nodiscard]] f64 score(std::string_view full_path, i64 now) const noexcept
+    {
+        const Entry* entry = find(key(hash(full_path)));
+        return entry != nullptr ? score(*entry, now) : 0.0;
+    }
+
+    /**
+     * Directories of the last picks, the most recent first.
+     */
+    [[nodiscard]] std::vector<std::string> recent_dirs() const
+    {
+        std::vector<std::string> dirs;
+        for (usize i = 0; i < recent_count && recent()[i].m_path[0] != 0; ++i)
+            dirs.emplace_back(recent()[i].m_path.data());
+
+        return dirs;
+    }
+
+    /**
+     * Sets ranking boosts of all indexed files found in the log. Full paths are hashed
+     * incrementally, so every directory path is hashed once.
+     */
+    void apply(Files& files, i64 now) const
+    {
+        if (std::ranges::none_of(entries(), entries() + capacity,
+                                 [](const Entry& entry) { return entry.m_key != 0; }))
+            return;
+
+        std::vector<std::pair<File_id, f32>> boosts;
+        Dir_id last_dir;
+        u64 dir_hash = 0;
+
+        files.for_each_file([&](File_id id, Dir_id dir, std::string_view name) {
+            if (dir != last_dir) {
+                last_dir = dir;
+                dir_hash = hash(files.dir_path(dir));
+            }
+
+            if (const Entry* entry = find(key(hash(name, dir_hash))); entry != nullptr)
+                boosts.emplace_back(id, f32(score(*entry, now)));
+        });
+
+        for (const auto& [id, boost] : boosts)
+            files.set_boost(id, boost);
+    }
+
+private:
+    static f64 score(const Entry& entry, i64 now) noexcept
+    {
+        return entry.m_score * std::exp2(-f64(std::max(now - entry.m_time, i64(0))) / half_life);
+    }
+
+    [[nodiscard]] Entry* entries() const noexcept
+    {
+        return reinterpret_cast<Entry*>(m_data.get() + sizeof(Header));
+    }
+
+    [[nodiscard]] Recent_dir* recent() const noexcept
+    {
+        return reinterpret_cast<Recent_dir*>(m_data.get() + sizeof(Header) +
+                                             (capacity * sizeof(Entry)));
+    }
+
+    /**
+     * Moves directory of the picked file to the front of recent directories, and drops the oldest
+     * one if it was not there. Directories with too long paths are not kept.
+     */
+    void record_dir(std::string_view full_path) const noexcept
+    {
+        const usize sep = full_path.find_last_of(os::path_sep);
+        if (sep == std::string_view::npos || sep == 0 || sep >= recent_path_size)
+            return;
+
+        const std::string_view dir = full_path.substr(0, sep);
+        Recent_dir* dirs = recent();
+
+        usize pos = recent_count - 1;
+        for (usize i = 0; i < recent_count; ++i) {
+            if (dir == dirs[i].m_path.data()) {
+                pos = i;
+                break;
+            }
+        }
+
+        std::memmove(dirs + 1, dirs, pos * sizeof(Recent_dir));
+        dirs[0] = Recent_dir{};
+        std::memcpy(dirs[0].m_path.data(), dir.data(), dir.size());
+    }
+
+    [[nodiscard]] const Entry* find(u64 k) const noexcept
+    {
+        for (usize probe = 0; probe < max_probes; ++probe) {
+            const Entry& entry = entries()[(k + probe) & (capacity - 1)];
+            if (entry.m_key == k)
+                return &entry;
+
+            if (entry.m_key == 0)
+                return nullptr;
+        }
+
+        return nullptr;
+    }
+
+    void init() noexcept
+    {
+        std::memset(m_data.get(), 0, file_size);
+        *reinterpret_cast<Header*>(m_data.get()) = Header{};
+    }
+
+    // Header, entries and recent directories, allocated for in memory log and mapped otherwise.
+    std::unique_ptr<std::byte, void (*)(std::byte*)> m_data;
+};
+
+#endif // FINDER_ACCESS_LOG_HPP
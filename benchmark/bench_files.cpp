@@ -0,0 +1,187 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "files.hpp"
+#include "os.hpp"
+#include "perf.hpp"
+#include "util.hpp"
+
+#if defined(OS_LINUX)
+#include <unistd.h>
+#endif
+
+// NOLINTBEGIN
+
+/**
+ * Index built from linux paths test input, shared by all benchmarks.
+ */
+static Files& linux_files()
+{
+    static Files files = [] {
+        Files f;
+        std::ifstream in{std::string(PROJECT_ROOT) + "/test/input_files/linux_paths.txt"};
+        for (std::string path; std::getline(in, path);)
+            f.insert(std::filesystem::path(path));
+
+        return f;
+    }();
+
+    return files;
+}
+
+/**
+ * Adds hardware counters per iteration into benchmark counters. Counters are zero when
+ * perf_event_open is not available.
+ */
+static void set_perf_counters(benchmark::State& state, const Perf_sample& sample)
+{
+    using benchmark::Counter;
+
+    const auto per_iter = [&](Perf_event e) {
+        return Counter(f64(sample[e]), Counter::kAvgIterations);
+    };
+
+    state.counters["cycles"] = per_iter(Perf_event::cycles);
+    state.counters["instructions"] = per_iter(Perf_event::instructions);
+    state.counters["cache_misses"] = per_iter(Perf_event::cache_misses);
+    state.counters["branch_misses"] = per_iter(Perf_event::branch_misses);
+    state.counters["IPC"] = sample.ipc();
+}
+
+static void bm_files_search(benchmark::State& state, const std::string& query)
+{
+    Files& files = linux_files();
+    const Files::Pattern pattern = files.compile(query);
+
+    Perf_counters& counters = Perf_counters::local();
+    const Perf_sample start = counters.read_sample();
+
+    for (auto _ : state) {
+        auto matches = files.partial_search(pattern, 1, 0);
+        dont_optimize(matches);
+    }
+
+    set_perf_counters(state, counters.read_sample() - start);
+    state.counters["files"] = f64(files.files_count());
+}
+
+BENCHMARK_CAPTURE(bm_files_search, single_char, std::string("a"));
+BENCHMARK_CAPTURE(bm_files_search, word, std::string("config"));
+BENCHMARK_CAPTURE(bm_files_search, wildcard, std::string("lib*.so"));
+BENCHMARK_CAPTURE(bm_files_search, no_match, std::string("zzzzqqq"));
+BENCHMARK_CAPTURE(bm_files_search, pinned_path, std::string("/usr/lib/x"));
+
+static void bm_files_insert(benchmark::State& state)
+{
+    std::ifstream in{std::string(PROJECT_ROOT) + "/test/input_files/linux_paths.txt"};
+    std::vector<std::filesystem::path> paths;
+    for (std::string path; std::getline(in, path);)
+        paths.emplace_back(path);
+
+    Perf_counters& counters = Perf_counters::local();
+    const Perf_sample start = counters.read_sample();
+
+    for (auto _ : state) {
+        Files files;
+        for (const auto& path : paths)
+            files.insert(path);
+
+        dont_optimize(files);
+    }
+
+    set_perf_counters(state, counters.read_sample() - start);
+    state.SetItemsProcessed(i64(state.iterations() * paths.size()));
+}
+
+BENCHMARK(bm_files_insert)->Unit(benchmark::kMillisecond);
+
+/**
+ * Resident set size of the process in bytes, or 0 if it can't be read (non linux OS).
+ */
+static usize rss_bytes()
+{
+#if defined(OS_LINUX)
+    std::ifstream in{"/proc/self/statm"};
+    usize size = 0;
+    usize resident = 0;
+    in >> size >> resident;
+    return in.fail() ? 0 : resident * usize(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Synthetic corpus of the provided size: 100 files per directory, 100 directories per parent, with
+ * realistic name lengths.
+ */
+static std::vector<std::filesystem::path> synthetic_paths(usize count)
+{
+    std::vector<std::filesystem::path> paths;
+    paths.reserve(count);
+
+    for (usize i = 0; i < count; ++i)
+        paths.emplace_back(std::format("/synthetic/project_{}/module_{}/source_file_{}.cpp",
+                                       i / 10'000, i / 100 % 100, i % 100));
+
+    return paths;
+}
+
+/**
+ * Index RSS delta and bytes per file, on linux paths input (arg 0) or synthetic corpus of the
+ * provided size.
+ */
+static void bm_files_rss(benchmark::State& state)
+{
+    std::vector<std::filesystem::path> paths;
+    if (state.range(0) == 0) {
+        std::ifstream in{std::string(PROJECT_ROOT) + "/test/input_files/linux_paths.txt"};
+        for (std::string path; std::getline(in, path);)
+            paths.emplace_back(path);
+    }
+    else {
+        paths = synthetic_paths(usize(state.range(0)));
+    }
+
+    for (auto _ : state) {
+        const usize rss_start = rss_bytes();
+
+        Files files;
+        for (const auto& path : paths)
+            files.insert(path);
+
+        const usize rss = rss_bytes() - rss_start;
+        state.counters["rss_MB"] = f64(rss) / f64(1024 * 1024);
+        state.counters["rss_per_file"] = f64(rss) / f64(files.files_count());
+        state.counters["files_size_per_file"] = f64(files.files_size()) / f64(files.files_count());
+        dont_optimize(files);
+    }
+}
+
+BENCHMARK(bm_files_rss)->Arg(0)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+/**
+ * Synthetic corpus takes gigabytes of memory, so it is benchmarked only when its size is set in
+ * FINDER_BENCH_SYNTHETIC_FILES (20000000 for the target scale).
+ */
+static const bool synthetic_rss_registered = [] {
+    const char* files = std::getenv("FINDER_BENCH_SYNTHETIC_FILES");
+    if (files == nullptr || std::atoll(files) <= 0)
+        return false;
+
+    benchmark::RegisterBenchmark("bm_files_rss", bm_files_rss)
+        ->Arg(std::atoll(files))
+        ->Iterations(1)
+        ->Unit(benchmark::kMillisecond);
+
+    return true;
+}();
+
+BENCHMARK_MAIN();
+
+// NOLINTEND
@@ -0,0 +1,386 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_BITMAP_HPP
+#define FINDER_BITMAP_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <iterator>
+#include <vector>
+
+#include "types.hpp"
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+
+/**
+ * Compressed bitmap of 32 bit ids, in the style of roaring bitmaps.
+ * Id space is split into chunks of 2^16 ids, and every non empty chunk is a container keyed by the
+ * high 16 bits. Sparse containers are sorted arrays of the low 16 bits (2 bytes per id), and dense
+ * containers are plain 8KiB bitsets. Container switches representation at array_max ids, where
+ * both take the same memory.
+ */
+class Id_bitmap {
+public:
+    static constexpr usize array_max = 4096;
+
+    void insert(u32 id)
+    {
+        Container& c = container(high(id));
+        if (c.dense()) {
+            u64& word = c.m_bits[low(id) / 64];
+            const u64 bit = u64(1) << (low(id) % 64);
+            c.m_count += (word & bit) == 0 ? 1 : 0;
+            word |= bit;
+            return;
+        }
+
+        auto it = std::ranges::lower_bound(c.m_array, low(id));
+        if (it != c.m_array.end() && *it == low(id))
+            return;
+
+        c.m_array.insert(it, low(id));
+        ++c.m_count;
+
+        if (c.m_array.size() > array_max)
+            c.make_dense();
+    }
+
+    void erase(u32 id)
+    {
+        auto cit = find(high(id));
+        if (cit == m_containers.end())
+            return;
+
+        Container& c = *cit;
+        if (c.dense()) {
+            u64& word = c.m_bits[low(id) / 64];
+            const u64 bit = u64(1) << (low(id) % 64);
+            c.m_count -= (word & bit) != 0 ? 1 : 0;
+            word &= ~bit;
+
+            if (c.m_count <= array_max / 2)
+                c.make_sparse();
+        }
+        else if (auto it = std::ranges::lower_bound(c.m_array, low(id));
+                 it != c.m_array.end() && *it == low(id)) {
+            c.m_array.erase(it);
+            --c.m_count;
+        }
+
+        if (c.m_count == 0)
+            m_containers.erase(cit);
+    }
+
+    [[nodiscard]] bool contains(u32 id) const noexcept
+    {
+        auto it = std::ranges::lower_bound(m_containers, high(id), {}, &Container::m_key);
+        if (it == m_containers.end() || it->m_key != high(id))
+            return false;
+
+        if (it->dense())
+            return (it->m_bits[low(id) / 64] & (u64(1) << (low(id) % 64))) != 0;
+
+        return std::ranges::binary_search(it->m_array, low(id));
+    }
+
+    [[nodiscard]] usize count() const noexcept
+    {
+        usize count = 0;
+        for (const Container& c : m_containers)
+            count += c.m_count;
+
+        return count;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return m_containers.empty(); }
+
+    /**
+     * Adds all ids of the other bitmap.
+     */
+    void unite(const Id_bitmap& other)
+    {
+        for (const Container& oc : other.m_containers) {
+            Container& c = container(oc.m_key);
+            if (!c.dense() && c.m_count + oc.m_count > array_max)
+                c.make_dense();
+
+            if (c.dense()) {
+                if (oc.dense()) {
+                    for (usize i = 0; i < words; ++i)
+                        c.m_bits[i] |= oc.m_bits[i];
+                }
+                else {
+                    for (u16 v : oc.m_array)
+                        c.m_bits[v / 64] |= u64(1) << (v % 64);
+                }
+
+                c.m_count = 0;
+                for (u64 w : c.m_bits)
+                    c.m_count += u32(std::popcount(w));
+            }
+            else {
+                std::vector<u16> merged;
+                merged.reserve(c.m_array.size() + oc.m_array.size());
+                std::ranges::set_union(c.m_array, oc.m_array, std::back_inserter(merged));
+                c.m_array = std::move(merged);
+                c.m_count = u32(c.m_array.size());
+            }
+        }
+    }
+
+    /**
+     * Keeps only ids that are also in the other bitmap.
+     */
+    void intersect(const Id_bitmap& other)
+    {
+        usize kept = 0;
+        auto oit = other.m_containers.begin();
+        for (usize i = 0; i < m_containers.size(); ++i) {
+            Container& c = m_containers[i];
+            oit = std::ranges::lower_bound(oit, other.m_containers.end(), c.m_key, {},
+                                           &Container::m_key);
+            if (oit == other.m_containers.end() || oit->m_key != c.m_key)
+                continue;
+
+            c.intersect(*oit);
+            if (c.m_count == 0)
+                continue;
+
+            if (kept != i)
+                m_containers[kept] = std::move(c);
+
+            ++kept;
+        }
+
+        m_containers.resize(kept);
+    }
+
+    /**
+     * Removes all ids of the other bitmap.
+     */
+    void subtract(const Id_bitmap& other)
+    {
+        usize kept = 0;
+        auto oit = other.m_containers.begin();
+        for (usize i = 0; i < m_containers.size(); ++i) {
+            Container& c = m_containers[i];
+            oit = std::ranges::lower_bound(oit, other.m_containers.end(), c.m_key, {},
+                                           &Container::m_key);
+            if (oit != other.m_containers.end() && oit->m_key == c.m_key)
+                c.subtract(*oit);
+
+            if (c.m_count == 0)
+                continue;
+
+            if (kept != i)
+                m_containers[kept] = std::move(c);
+
+            ++kept;
+        }
+
+        m_containers.resize(kept);
+    }
+
+    /**
+     * Calls f for all ids in [begin, end), in increasing order.
+     */
+    template<class F>
+    void for_each(u32 begin, u32 end, F&& f) const
+    {
+        auto it = std::ranges::lower_bound(m_containers, high(begin), {}, &Container::m_key);
+        for (; it != m_containers.end() && (u64(it->m_key) << 16U) < end; ++it) {
+            const u32 base = u32(it->m_key) << 16U;
+
+            if (it->dense()) {
+                for (usize i = 0; i < words; ++i) {
+                    for (u64 w = it->m_bits[i]; w != 0; w &= w - 1) {
+                        const u32 id = base + u32(i * 64) + u32(std::countr_zero(w));
+                        if (id >= end)
+                            return;
+                        if (id >= begin)
+                            f(id);
+                    }
+                }
+            }
+            else {
+                for (u16 v : it->m_array) {
+                    const u32 id = base + v;
+                    if (id >= end)
+                        return;
+                    if (id >= begin)
+                        f(id);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] usize size_in_bytes() const noexcept
+    {
+        usize size = m_containers.capacity() * sizeof(Container);
+        for (const Container& c : m_containers)
+            size += c.m_array.capacity() * sizeof(u16) + c.m_bits.capacity() * sizeof(u64);
+
+        return size;
+    }
+
+private:
+    static constexpr usize words = 65536 / 64;
+
+    struct Container {
+        u16 m_key = 0;
+        u32 m_count = 0;
+        std::vector<u16> m_array; // Sorted low bits, if container is sparse.
+        std::vector<u64> m_bits;  // Bitset of low bits, if container is dense.
+
+        [[nodiscard]] bool dense() const noexcept { return !m_bits.empty(); }
+
+        [[nodiscard]] bool contains(u16 v) const noexcept
+        {
+            if (dense())
+                return (m_bits[v / 64] & (u64(1) << (v % 64))) != 0;
+
+            return std::ranges::binary_search(m_array, v);
+        }
+
+        /**
+         * Keeps only low bits that are also in the other container. Sparse side is iterated, so a
+         * dense container against a sparse one costs the size of the sparse one.
+         */
+        void intersect(const Container& other)
+        {
+            if (dense() && other.dense()) {
+                m_count = 0;
+                for (usize i = 0; i < words; ++i) {
+                    m_bits[i] &= other.m_bits[i];
+                    m_count += u32(std::popcount(m_bits[i]));
+                }
+
+                if (m_count <= array_max / 2)
+                    make_sparse();
+
+                return;
+            }
+
+            if (dense()) {
+                std::vector<u16> kept;
+                kept.reserve(other.m_array.size());
+                for (u16 v : other.m_array)
+                    if (contains(v))
+                        kept.push_back(v);
+
+                m_array = std::move(kept);
+                m_bits = std::vector<u64>{};
+            }
+            else {
+                usize kept = 0;
+                for (u16 v : m_array)
+                    if (other.contains(v))
+                        m_array[kept++] = v;
+
+                m_array.resize(kept);
+            }
+
+            m_count = u32(m_array.size());
+        }
+
+        /**
+         * Removes low bits of the other container.
+         */
+        void subtract(const Container& other)
+        {
+            if (!dense()) {
+                usize kept = 0;
+                for (u16 v : m_array)
+                    if (!other.contains(v))
+                        m_array[kept++] = v;
+
+                m_array.resize(kept);
+                m_count = u32(m_array.size());
+                return;
+            }
+
+            if (other.dense()) {
+                for (usize i = 0; i < words; ++i)
+                    m_bits[i] &= ~other.m_bits[i];
+            }
+            else {
+                for (u16 v : other.m_array)
+                    m_bits[v / 64] &= ~(u64(1) << (v % 64));
+            }
+
+            m_count = 0;
+            for (u64 w : m_bits)
+                m_count += u32(std::popcount(w));
+
+            if (m_count <= array_max / 2)
+                make_sparse();
+        }
+
+        void make_dense()
+        {
+            if (dense())
+                return;
+
+            m_bits.assign(words, 0);
+            for (u16 v : m_array)
+                m_bits[v / 64] |= u64(1) << (v % 64);
+
+            m_array = std::vector<u16>{};
+        }
+
+        void make_sparse()
+        {
+            if (!dense())
+                return;
+
+            m_array.clear();
+            m_array.reserve(m_count);
+            for (usize i = 0; i < words; ++i)
+                for (u64 w = m_bits[i]; w != 0; w &= w - 1)
+                    m_array.push_back(u16(i * 64 + usize(std::countr_zero(w))));
+
+            m_bits = std::vector<u64>{};
+        }
+    };
+
+    static constexpr u16 high(u32 id) noexcept { return u16(id >> 16U); }
+
+    static constexpr u16 low(u32 id) noexcept { return u16(id & 0xFFFFU); }
+
+    std::vector<Container>::iterator find(u16 key)
+    {
+        auto it = std::ranges::lower_bound(m_containers, key, {}, &Container::m_key);
+        return it != m_containers.end() && it->m_key == key ? it : m_containers.end();
+    }
+
+    Container& container(u16 key)
+    {
+        auto it = std::ranges::lower_bound(m_containers, key, {}, &Container::m_key);
+        if (it == m_containers.end() || it->m_key != key)
+            it = m_containers.insert(it, Container{.m_key = key});
+
+        return *it;
+    }
+
+    std::vector<Container> m_containers; // Sorted by key.
+};
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
+
+#endif // FINDER_BITMAP_HPP
@@ -22,4 +22,14 @@ endif()
 
 if (CMAKE_CXX_COMPILER_ID STREQUAL "MSVC")
     SET(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} /EHsc")
-endif()
\ No newline at end of file
+endif()
+
+# Vectorized prefilters (name character masks are checked 4 at a time).
+OPTION(FINDER_ENABLE_AVX2 "If set, compiles with AVX2 instructions enabled." OFF)
+if (FINDER_ENABLE_AVX2)
+    if (MSVC)
+        SET(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} /arch:AVX2")
+    else()
+        SET(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -mavx2")
+    endif()
+endif()
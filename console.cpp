@@ -18,6 +18,7 @@
 #include <cstddef>
 #include <iostream>
 #include <string>
+#include <thread>
 
 #include "os.hpp"
 
@@ -43,12 +44,31 @@ Console::Console()
     flush();
 }
 
+Console::Console(const Session& replay, bool realtime)
+    : m_in_handle{nullptr}
+    , m_out_handle{nullptr}
+    , m_replay{replay.m_events.begin(), replay.m_events.end()}
+    , m_headless{true}
+    , m_realtime{realtime}
+{
+    m_max_x = std::max(i16(1), replay.m_terminal.x);
+    m_max_y = std::max(i16(1), replay.m_terminal.y);
+    m_picker.m_x = m_min_x;
+    m_picker.m_y = m_max_y < 2 ? 1 : m_max_y - 2;
+    m_stream.reserve(usize(m_max_x) * m_max_y);
+
+    clear();
+    flush();
+}
+
 Console::~Console()
 {
     clear();
     write<term_default>(""); // Reset color.
     flush();
-    os::close_console(m_in_handle, m_out_handle);
+
+    if (!m_headless)
+        os::close_console(m_in_handle, m_out_handle);
 }
 
 void Console::resize(os::Coordinates coord)
@@ -62,12 +82,52 @@ void Console::resize(os::Coordinates coord)
     m_picker.m_y = m_max_y < 2 ? 1 : m_max_y - 2;
 }
 
+/**
+ * Reads next console input. Headless console reads inputs from replayed session, and when there
+ * are no more inputs, it returns ctrl + q (exit).
+ */
 Console& Console::operator>>(os::ConsoleInput& input)
 {
-    os::console_scan(m_in_handle, input);
+    if (m_headless) {
+        constexpr i32 ctrl_q = 17;
+
+        if (m_replay.empty()) {
+            input = ctrl_q;
+            return *this;
+        }
+
+        if (m_realtime)
+            std::this_thread::sleep_for(m_replay.front().m_delay);
+
+        input = m_replay.front().m_input;
+        m_replay.pop_front();
+    }
+    else {
+        os::console_scan(m_in_handle, input);
+    }
+
+    if (m_recorder != nullptr)
+        m_recorder->record(input);
+
     return *this;
 }
 
+bool Console::read(os::ConsoleInput& input, milliseconds timeout)
+{
+    if (m_headless) {
+        *this >> input;
+        return true;
+    }
+
+    if (!os::console_scan(m_in_handle, input, i32(timeout.count())))
+        return false;
+
+    if (m_recorder != nullptr)
+        m_recorder->record(input);
+
+    return true;
+}
+
 Console& Console::clear()
 {
     command("2J");
@@ -78,10 +138,14 @@ Console& Console::clear()
 
 Console& Console::flush()
 {
-    std::cout << m_stream;
-    std::cout.flush();
-    m_stream.clear();
+    TZoneScoped;
+
+    if (!m_headless) {
+        std::cout << m_stream;
+        std::cout.flush();
+    }
 
+    m_stream.clear();
     return *this;
 }
 
@@ -131,7 +195,7 @@ Console& Console::pop_cursor_coord()
     return *this;
 }
 
-[[nodiscard]] const Files::Match& Console::pick_result(const Files::Matches& results) const
+[[nodiscard]] Files::Match_view Console::pick_result(const Files::Matches& results) const
 {
     usize idx = m_max_y - 2 - m_picker.m_y;
     if (idx > results.size())
@@ -148,12 +212,11 @@ Console& Console::pop_cursor_coord()
  * Current limit for matched letters in a single word is 63.
  */
 template<bool picked>
-Console& Console::print_single_search_result(const Files::Match& match, const Query& query)
+Console& Console::print_single_search_result(const Files::Match_view& match, const Query& query)
 {
-    const auto& bs = match.m_match_bs;
-    const FileInfo* file = match.m_file;
+    const auto& bs = match.match_bs();
 
-    std::string print = file->full_path();
+    std::string print = match.full_path();
     for (usize i = query.pinned().size(); i < print.size(); ++i) {
         if (i < bs.size() && bs.test(i))
             if constexpr (picked)
@@ -178,13 +241,12 @@ Console& Console::print_search_results(const Files::Matches& matches, const Quer
 {
     move_cursor<up>(2).move_cursor_to<edge_left>().move_cursor<right>();
 
-    auto it = matches.data().begin();
-    const auto it_end = matches.data().end();
+    usize idx = 0;
 
     while (y() >= min_y()) {
-        if (it != it_end) {
-            print_single_search_result(*it, query);
-            ++it;
+        if (idx < matches.size()) {
+            print_single_search_result(matches[idx], query);
+            ++idx;
         }
 
         clear_rest_of_line();
@@ -265,6 +327,9 @@ Console& Console::copy_result_to_clipboard(const Files::Matches& results)
 {
     assert(!results.empty());
 
+    if (m_headless) // Replay must not touch user's clipboard.
+        return *this;
+
     u32 first = m_max_y - 2;
     usize idx = first - m_picker.m_y;
 
@@ -272,20 +337,20 @@ Console& Console::copy_result_to_clipboard(const Files::Matches& results)
     idx = std::clamp(idx, usize(0), results.size());
 
     if constexpr (copy_opt == CopyOpt::file_name)
-        os::copy_to_clipboard<true>(std::string(results[idx].m_file->name()));
+        os::copy_to_clipboard<true>(std::string(results[idx].name()));
     else if constexpr (copy_opt == CopyOpt::file_path)
-        os::copy_to_clipboard<true>(std::string(results[idx].m_file->path()));
+        os::copy_to_clipboard<true>(results[idx].path());
     else if constexpr (copy_opt == CopyOpt::full)
-        os::copy_to_clipboard<true>(results[idx].m_file->full_path());
+        os::copy_to_clipboard<true>(results[idx].full_path());
     else if constexpr (copy_opt == CopyOpt::full_quoted)
-        os::copy_to_clipboard<true>("\"" + results[idx].m_file->full_path() + "\"");
+        os::copy_to_clipboard<true>("\"" + results[idx].full_path() + "\"");
     else
         static_assert(false, "Invalid copy opt.");
 
     return *this;
 }
 
-Console& Console::draw_symbol_search_results(const Symbol* symbol)
+Console& Console::draw_symbol_search_results(const Symbol* symbol, const Files& files)
 {
     move_cursor_to<edge_top>();
     move_cursor_to<edge_left>();
@@ -295,7 +360,7 @@ Console& Console::draw_symbol_search_results(const Symbol* symbol)
             for (const auto& line : symref.lines()) {
                 clear_rest_of_line();
 
-                write("{}\\{} {}: {}\n", symref.file()->path(), symref.file()->name().c_str(),
+                write("{}\\{} {}: {}\n", files.path(symref.file()), files.name(symref.file()),
                       line.number(), std::string(line.preview()));
 
                 move_cursor<down>();
@@ -316,19 +381,40 @@ Console& Console::draw_symbol_search_results(const Symbol* symbol)
     return *this;
 }
 
+/**
+ * Prints status line on the line above the query line. Empty status just clears that line.
+ */
+Console& Console::print_status_line(const std::string& status)
+{
+    push_cursor_coord();
+
+    move_cursor_to<edge_bottom>().move_cursor<up>().move_cursor_to<edge_left>();
+    write(status);
+    clear_rest_of_line();
+
+    pop_cursor_coord();
+    return *this;
+}
+
+/**
+ * Renders main screen into the console stream. Caller is responsible for flushing the stream, so
+ * rendering and terminal output can be measured separately.
+ */
 void Console::render_main(const Query& query, u32 cpus_count, u32 workers_count, u32 tasks_count,
                           u32 objects_count, const Files::Matches& results,
-                          std::chrono::duration<long long, std::ratio<1, 1000>> time)
+                          std::chrono::duration<long long, std::ratio<1, 1000>> time,
+                          const std::string& status)
 {
+    TZoneScoped;
+
     if (m_max_x < min_x_required || m_max_y < min_y_required) {
         write("Window too small.");
-        flush();
         return;
     }
 
     move_cursor_to<edge_bottom>().move_cursor_to<edge_left>();
 
-    write("{}: {}", query.pinned(), query.query());
+    write("{}{}: {}", query.regex() ? "(regex) " : "", query.pinned(), query.query());
     clear_rest_of_line();
 
     push_cursor_coord();
@@ -339,12 +425,11 @@ void Console::render_main(const Query& query, u32 cpus_count, u32 workers_count,
           workers_count, tasks_count, objects_count, time);
     pop_cursor_coord();
 
+    print_status_line(status);
     print_search_results(results, query);
     pop_cursor_coord();
 
     init_picker(results, query);
-
-    flush();
 }
 
 template Console& Console::move_picker<Direction::up>(const Files::Matches&, const Query&);
@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <deque>
 #include <format>
 #include <string>
 #include <string_view>
@@ -29,6 +30,7 @@
 #include "files.hpp"
 #include "os.hpp"
 #include "query.hpp"
+#include "session.hpp"
 #include "symbols.hpp"
 
 inline const std::string esc = "\x1b[";
@@ -111,6 +113,13 @@ public:
 
     explicit Console();
 
+    /**
+     * Headless console used for session replay. It takes terminal size and inputs from recorded
+     * session and renders into a null sink. If realtime is set, recorded delays between inputs
+     * are respected.
+     */
+    explicit Console(const Session& replay, bool realtime = false);
+
     Console(const Console&) = delete;
     Console(Console&&) noexcept = delete;
 
@@ -121,9 +130,26 @@ public:
 
     void resize(os::Coordinates coord);
 
+    /**
+     * Sets recorder which will receive every console input. Null disables recording.
+     */
+    void set_recorder(Session_recorder* recorder) noexcept { m_recorder = recorder; }
+
+    [[nodiscard]] bool headless() const noexcept { return m_headless; }
+
+    [[nodiscard]] os::Coordinates size() const noexcept
+    {
+        return os::Coordinates{static_cast<i16>(m_max_x), static_cast<i16>(m_max_y)};
+    }
+
     Console& operator<<(const std::string& s);
     Console& operator>>(os::ConsoleInput& input);
 
+    /**
+     * Reads next console input, waiting at most for the timeout. Returns false on timeout.
+     */
+    bool read(os::ConsoleInput& input, milliseconds timeout);
+
     template<Color color_fg, Color color_bg>
     void set_color()
     {
@@ -247,9 +273,9 @@ public:
     Console& pop_cursor_coord();
 
     template<bool picked = false>
-    Console& print_single_search_result(const Files::Match& match, const Query& query);
+    Console& print_single_search_result(const Files::Match_view& match, const Query& query);
 
-    [[nodiscard]] const Files::Match& pick_result(const Files::Matches& results) const;
+    [[nodiscard]] Files::Match_view pick_result(const Files::Matches& results) const;
 
     Console& init_picker(const Files::Matches& results, const Query& query);
 
@@ -261,11 +287,14 @@ public:
 
     Console& print_search_results(const Files::Matches& matches, const Query& query);
 
-    Console& draw_symbol_search_results(const Symbol* symbol);
+    Console& draw_symbol_search_results(const Symbol* symbol, const Files& files);
+
+    Console& print_status_line(const std::string& status);
 
     void render_main(const Query& query, u32 cpus_count, u32 workers_count, u32 tasks_count,
                      u32 objects_count, const Files::Matches& results,
-                     std::chrono::duration<long long, std::ratio<1, 1000>> time);
+                     std::chrono::duration<long long, std::ratio<1, 1000>> time,
+                     const std::string& status = "");
 
 private:
     [[nodiscard]] i16 short_x() const
@@ -297,6 +326,10 @@ private: // NOLINT
     Color m_color_fg = term_default;
     Color m_color_bg = term_default;
     std::string m_stream; // need to cache cout, because of horrible windows terminal performance.
+    Session_recorder* m_recorder = nullptr;
+    std::deque<Session::Event> m_replay; // Pending inputs for headless console.
+    bool m_headless = false;
+    bool m_realtime = false;
 };
 
 #endif // CONSOLE_HPP
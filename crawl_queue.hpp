@@ -0,0 +1,100 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_CRAWL_QUEUE_HPP
+#define FINDER_CRAWL_QUEUE_HPP
+
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "os.hpp"
+#include "types.hpp"
+
+/**
+ * Order in which the crawl visits directories. Root is crawled depth first in directory order, so
+ * directories the user works in can come last. Instead, directories inside of the root are
+ * scheduled by priority: hot ones (working and home directory, recent picks) are crawled first,
+ * then the rest of the root, and cold ones (system directories) last.
+ *
+ * Every scheduled directory is crawled in its own turn. Crawls of other directories index it, but
+ * don't enter it, so every file is crawled once.
+ */
+class Crawl_queue {
+public:
+    enum class Priority : u8 { hot, normal, cold };
+
+    struct Dir {
+        std::string m_path;
+        Priority m_priority = Priority::normal;
+    };
+
+    /**
+     * Queue of the root alone, which is crawled whole.
+     */
+    explicit Crawl_queue(std::string root) : m_root{std::move(root)}
+    {
+        m_dirs.push_back(Dir{.m_path = m_root, .m_priority = Priority::normal});
+        m_paths.insert(m_root);
+    }
+
+    /**
+     * Schedules directory inside of the root, spelled as the crawl spells its paths. Returns false
+     * if directory is not inside of the root, or is already scheduled (with the first priority).
+     */
+    bool add(std::string path, Priority priority)
+    {
+        while (path.size() > 1 && path.ends_with(os::path_sep))
+            path.pop_back();
+
+        const bool inside = path.size() > m_root.size() && path.starts_with(m_root) &&
+                            (m_root.ends_with(os::path_sep) || path[m_root.size()] == os::path_sep);
+        if (!inside || !m_paths.insert(path).second)
+            return false;
+
+        m_dirs.push_back(Dir{.m_path = std::move(path), .m_priority = priority});
+        return true;
+    }
+
+    /**
+     * Scheduled directories in crawl order, by priority and then in order they were added.
+     */
+    [[nodiscard]] std::vector<Dir> dirs() const
+    {
+        std::vector<Dir> result = m_dirs;
+        std::ranges::stable_sort(result, {}, &Dir::m_priority);
+        return result;
+    }
+
+    /**
+     * Whether the directory is crawled in its own turn.
+     */
+    [[nodiscard]] bool scheduled(const std::string& path) const { return m_paths.contains(path); }
+
+    [[nodiscard]] const std::string& root() const noexcept { return m_root; }
+
+    [[nodiscard]] usize size() const noexcept { return m_dirs.size(); }
+
+private:
+    std::string m_root;
+    std::vector<Dir> m_dirs; // In order they were added, root first.
+    std::unordered_set<std::string> m_paths;
+};
+
+#endif // FINDER_CRAWL_QUEUE_HPP
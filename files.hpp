@@ -18,57 +18,249 @@
 #ifndef FINDER_FILES_HPP
 #define FINDER_FILES_HPP
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <bitset>
 #include <cstddef>
 #include <cstring>
 #include <filesystem>
+#include <iterator>
 #include <limits>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-#include "array_map.hpp"
 #include "art.hpp"
+#include "bitmap.hpp"
+#include "fuzzy.hpp"
+#include "id.hpp"
+#include "memory.hpp"
+#include "names.hpp"
 #include "os.hpp"
-#include "small_string.hpp"
+#include "regex.hpp"
+#include "terms.hpp"
 #include "types.hpp"
+#include "unicode.hpp"
 #include "util.hpp"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 // NOLINTBEGIN(readability-implicit-bool-conversion, readability-redundant-access-specifiers,
 // hicpp-explicit-conversions)
 
 namespace fs = std::filesystem;
 
+/**
+ * File name and directory id, packed into 16 bytes so scans touch as little memory as possible.
+ * FileInfo does not own the name, it is stored in the Files arena. Path is resolved through the
+ * Files directory table.
+ * Erased files are left as tombstones (null name) so ids of other files stay valid.
+ */
 class FileInfo {
 public:
     FileInfo() = default;
 
-    explicit FileInfo(const std::string& file_name) : m_name{file_name} {}
+    FileInfo(std::string_view file_name, Dir_id dir)
+        : m_name{file_name.data()}
+        , m_name_size{static_cast<u32>(file_name.size())}
+        , m_dir{dir}
+    {
+        assert(file_name.size() <= std::numeric_limits<u32>::max());
+    }
+
+    /**
+     * File with compressed name. Name points to the entry in the front coded name store, and
+     * entry offset from its block head is kept in place of the name size.
+     */
+    FileInfo(Front_coded_names::Entry entry, Dir_id dir)
+        : m_name{entry.m_data}
+        , m_name_size{entry.m_offset}
+        , m_dir{dir}
+    {
+    }
+
+    /**
+     * File name. Valid only for files with uncompressed names.
+     */
+    [[nodiscard]] constexpr std::string_view name() const noexcept { return {m_name, m_name_size}; }
 
-    FileInfo(const std::string& file_name, std::string_view file_path)
-        : m_name{file_name}
-        , m_path{file_path}
+    [[nodiscard]] constexpr Front_coded_names::Entry name_entry() const noexcept
     {
-        if (!file_path.ends_with(file_name))
-            throw std::runtime_error{"File path does not end with file name."};
+        return {.m_data = m_name, .m_offset = m_name_size};
     }
 
-    [[nodiscard]] constexpr const stl::SmallString& name() const noexcept { return m_name; }
+    [[nodiscard]] constexpr Dir_id dir() const noexcept { return m_dir; }
+
+    [[nodiscard]] constexpr bool erased() const noexcept { return m_name == nullptr; }
+
+private:
+    const char* m_name = nullptr; // File name with extension (null terminated) or name entry.
+    u32 m_name_size = 0; // Name size or name entry offset.
+    Dir_id m_dir;
+};
 
-    [[nodiscard]] const std::string_view& path() const noexcept { return m_path; }
+/**
+ * Directory table entry. Only the last path component (with trailing separator) is stored, and
+ * the full path is reconstructed from parents on demand. First component of a path is its root
+ * ("/" or "C:\\"), which has no parent.
+ * Full path size is cached, since search needs it for match highlighting.
+ */
+class DirInfo {
+public:
+    DirInfo() = default;
 
-    [[nodiscard]] std::string full_path() const noexcept
+    DirInfo(std::string_view name, Dir_id parent, usize path_size)
+        : m_name{name.data()}
+        , m_name_size{static_cast<u32>(name.size())}
+        , m_path_size{static_cast<u32>(path_size)}
+        , m_parent{parent}
     {
-        return std::format("{}{}", path(), name().c_str());
+        assert(path_size <= std::numeric_limits<u32>::max());
     }
 
-    void set_path(std::string_view path) { m_path = path; }
+    [[nodiscard]] constexpr std::string_view name() const noexcept { return {m_name, m_name_size}; }
+
+    [[nodiscard]] constexpr Dir_id parent() const noexcept { return m_parent; }
+
+    [[nodiscard]] constexpr usize path_size() const noexcept { return m_path_size; }
+
+    [[nodiscard]] constexpr u32 children() const noexcept { return m_children; }
+
+    [[nodiscard]] constexpr bool erased() const noexcept { return m_name == nullptr; }
+
+    void add_child() noexcept { ++m_children; }
+
+    void remove_child() noexcept
+    {
+        assert(m_children > 0);
+        --m_children;
+    }
 
 private:
-    stl::SmallString m_name; // File name with extension.
-    std::string_view m_path; // Full file path.
+    const char* m_name = nullptr; // Last path component with separator (null terminated).
+    u32 m_name_size = 0;
+    u32 m_path_size = 0; // Full path size.
+    Dir_id m_parent;
+    u32 m_children = 0; // Number of child directories.
 };
 
+/**
+ * Character class (bit) of every byte. Letters are case folded, digits and the most common
+ * punctuation have their own bits, and all other bytes share the remaining bits.
+ */
+static constexpr std::array<u8, 256> char_classes = [] {
+    std::array<u8, 256> classes{};
+    for (usize c = 0; c < classes.size(); ++c) {
+        if (c >= 'a' && c <= 'z')
+            classes[c] = u8(c - 'a');
+        else if (c >= 'A' && c <= 'Z')
+            classes[c] = u8(c - 'A');
+        else if (c >= '0' && c <= '9')
+            classes[c] = u8(26 + c - '0');
+        else if (c == '.')
+            classes[c] = 36;
+        else if (c == '_')
+            classes[c] = 37;
+        else if (c == '-')
+            classes[c] = 38;
+        else if (c == ' ')
+            classes[c] = 39;
+        else
+            classes[c] = u8(40 + c % 24);
+    }
+
+    return classes;
+}();
+
+/**
+ * Bitmask of character classes present in a string. If mask of a name doesn't contain all bits of
+ * the query mask, name can't contain the query.
+ */
+static constexpr u64 char_mask(std::string_view str) noexcept
+{
+    u64 mask = 0;
+    for (const char c : str)
+        mask |= u64(1) << char_classes[static_cast<u8>(c)];
+
+    return mask;
+}
+
+/**
+ * Number of leading masks that miss some of the query bits. Masks are checked 4 at a time with
+ * AVX2 when it is enabled.
+ */
+static usize rejected_masks(const u64* masks, usize count, u64 query) noexcept
+{
+    usize i = 0;
+
+#if defined(__AVX2__)
+    const __m256i q = _mm256_set1_epi64x(static_cast<i64>(query));
+    for (; i + 4 <= count; i += 4) {
+        const __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(masks + i));
+        const __m256i accepted = _mm256_cmpeq_epi64(_mm256_and_si256(m, q), q);
+        if (_mm256_testz_si256(accepted, accepted) == 0)
+            break;
+    }
+#endif
+
+    while (i < count && (masks[i] & query) != query)
+        ++i;
+
+    return i;
+}
+
+/**
+ * Sets bit i of bits for every value within [lo, hi], and clears the rest. Bits hold count bits.
+ * Every word is accumulated in a register, with values compared 4 at a time with AVX2 when it is
+ * enabled.
+ */
+static void range_bits(const i64* values, usize count, i64 lo, i64 hi, u64* bits) noexcept
+{
+#if defined(__AVX2__)
+    const __m256i l = _mm256_set1_epi64x(lo);
+    const __m256i h = _mm256_set1_epi64x(hi);
+#endif
+
+    for (usize first = 0; first < count; first += 64) {
+        const usize last = std::min(count, first + 64);
+        usize i = first;
+        u64 word = 0;
+
+#if defined(__AVX2__)
+        for (; i + 4 <= last; i += 4) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+            const __m256i out =
+                _mm256_or_si256(_mm256_cmpgt_epi64(l, v), _mm256_cmpgt_epi64(v, h));
+            word |= (~u64(_mm256_movemask_pd(_mm256_castsi256_pd(out))) & 0xFU) << (i - first);
+        }
+#endif
+
+        // Single unsigned compare, so the loop has no branches.
+        for (; i < last; ++i)
+            word |= u64(u64(values[i]) - u64(lo) <= u64(hi) - u64(lo)) << (i - first);
+
+        bits[first / 64] = word;
+    }
+}
+
+/**
+ * Extension is the name part after the last dot. Names without a dot have no extension.
+ */
+static constexpr std::optional<std::string_view> extension(std::string_view name) noexcept
+{
+    const usize dot = name.rfind('.');
+    if (dot == std::string_view::npos)
+        return std::nullopt;
+
+    return name.substr(dot + 1);
+}
+
 static fs::path parent_path(const fs::path& path)
 {
     fs::path parrent = path.parent_path();
@@ -89,70 +281,123 @@ public:
     static constexpr usize match_max = 256;
 
     /**
-     * Struct that holds file info pointer and offset at which we matched file name. Offset is
-     * used to highlight matched string with different color for easy visualization on console.
+     * Struct that holds file id and offset at which we matched file name. Offset is used to
+     * highlight matched string with different color for easy visualization on console.
      */
     struct Match {
-        const FileInfo* m_file;
         std::bitset<match_max> m_match_bs;
+        File_id m_file;
+        f32 m_boost = 0; // Ranking boost of the file (see set_boost()).
+    };
+
+    /**
+     * Match with its file resolved through the files that produced it. It is returned from
+     * Matches by value, and it is valid as long as files are not modified.
+     */
+    class Match_view {
+    public:
+        Match_view(const Files& files, const Match& match) noexcept
+            : m_files{&files}
+            , m_match{&match}
+        {
+        }
+
+        [[nodiscard]] File_id id() const noexcept { return m_match->m_file; }
+
+        [[nodiscard]] const std::bitset<match_max>& match_bs() const noexcept
+        {
+            return m_match->m_match_bs;
+        }
+
+        [[nodiscard]] std::string_view name() const noexcept { return m_files->name(id()); }
+
+        [[nodiscard]] std::string path() const { return m_files->path(id()); }
+
+        [[nodiscard]] std::string full_path() const { return m_files->full_path(id()); }
 
-        const FileInfo* operator->() const { return m_file; }
+    private:
+        const Files* m_files;
+        const Match* m_match;
     };
 
     /**
      * Struct that holds vector of matches and total number of objects matched. Since number of
      * matches can be limited (no need to put all objects in a results if user limits it), we need
      * to separate results from number of objects matched.
+     * Results are the top matches, ordered by boost and then by file id (scan order). Without
+     * boosts, they are the first matches found, as partial searches scan in file id order.
      */
     class Matches {
     public:
-        Matches(usize limit = objects_max) : m_limit(limit) { m_results.reserve(m_limit); }
-
         /**
-         * Inserts other matches into the final matches.
+         * Search counters used for instrumentation. Scan time is the longest scan time of all
+         * merged partial searches, since tasks are running in parallel.
          */
-        void insert(Matches& other)
-        {
-            if (m_results.size() < m_limit) {
-                const std::vector<Match>& other_res = other.m_results;
-                usize ins = std::min(m_limit - m_results.size(), other_res.size());
-
-                if (ins > 0)
-                    m_results.insert(m_results.end(), other_res.begin(), other_res.begin() + ins);
+        struct Search_stats {
+            usize m_scanned = 0;  // Number of files visited by the scan.
+            usize m_rejected = 0; // Number of files rejected by a prefilter (path, etc.).
+            nanoseconds m_scan_time{0};
+            nanoseconds m_work_time{0}; // Scan time summed over all partial searches.
+
+            void merge(const Search_stats& other) noexcept
+            {
+                m_scanned += other.m_scanned;
+                m_rejected += other.m_rejected;
+                m_scan_time = std::max(m_scan_time, other.m_scan_time);
+                m_work_time += other.m_work_time;
             }
+        };
 
-            m_objects += other.m_objects;
-        }
+        Matches(usize limit = objects_max) : m_limit(limit) { m_results.reserve(m_limit); }
+
+        Matches(const Files* files, usize limit = objects_max) : Matches{limit} { m_files = files; }
 
         /**
          * Inserts other matches into the final matches.
          */
         void insert(const Matches& other)
         {
-            if (m_results.size() < m_limit) {
-                const std::vector<Match>& other_res = other.m_results;
-                usize ins = std::min(m_limit - m_results.size(), other_res.size());
+            TZoneScopedN("Matches::merge");
 
-                if (ins > 0)
-                    m_results.insert(m_results.end(), other_res.begin(), other_res.begin() + ins);
-            }
+            for (const Match& match : other.m_results)
+                rank(match);
+
+            if (m_files == nullptr)
+                m_files = other.m_files;
 
             m_objects += other.m_objects;
+            m_stats.merge(other.m_stats);
         }
 
-        template<class... Args>
-        void insert(Args&&... args)
+        /**
+         * Inserts matched file. Match must be accepted (see accepts()).
+         */
+        void insert(const std::bitset<match_max>& match_bs, File_id id)
         {
-            if (m_objects < m_limit)
-                m_results.emplace_back(std::forward<Args>(args)...);
+            assert(accepts(id));
 
+            rank(Match{.m_match_bs = match_bs, .m_file = id, .m_boost = boost(id)});
             ++m_objects;
         }
 
+        /**
+         * Counts matched file that is not accepted into results.
+         */
+        void insert() noexcept { ++m_objects; }
+
+        /**
+         * Whether matched file would make it into results, so its highlight is worth computing.
+         */
+        [[nodiscard]] bool accepts(File_id id) const noexcept
+        {
+            return !full() || (m_limit > 0 && ranks_before(boost(id), id, m_results.back()));
+        }
+
         void clear() noexcept
         {
             m_results.clear();
             m_objects = 0;
+            m_stats = Search_stats{};
         }
 
         const std::vector<Match>& data() const noexcept { return m_results; }
@@ -165,41 +410,190 @@ public:
 
         bool full() const noexcept { return m_results.size() == m_limit; }
 
-        const Match& operator[](usize idx) const noexcept
+        Search_stats& stats() noexcept { return m_stats; }
+
+        const Search_stats& stats() const noexcept { return m_stats; }
+
+        Match_view operator[](usize idx) const noexcept
         {
             assert(idx < m_results.size());
-            return m_results[idx];
+            assert(m_files != nullptr);
+            return Match_view{*m_files, m_results[idx]};
         }
 
     private:
+        [[nodiscard]] f32 boost(File_id id) const noexcept
+        {
+            return m_files != nullptr ? m_files->boost(id) : 0;
+        }
+
+        static bool ranks_before(f32 boost, File_id id, const Match& other) noexcept
+        {
+            return boost != other.m_boost ? boost > other.m_boost : id < other.m_file;
+        }
+
+        /**
+         * Inserts match into ordered results, dropping the last one if results are full. Matches
+         * mostly arrive in order, so they are appended.
+         */
+        void rank(const Match& match)
+        {
+            if (full() &&
+                (m_limit == 0 || !ranks_before(match.m_boost, match.m_file, m_results.back())))
+                return;
+
+            if (full())
+                m_results.pop_back();
+
+            const auto pos = std::ranges::upper_bound(
+                m_results, match, [](const Match& lhs, const Match& rhs) {
+                    return ranks_before(lhs.m_boost, lhs.m_file, rhs);
+                });
+
+            m_results.insert(pos, match);
+        }
+
+        const Files* m_files = nullptr; // Files that produced matches, used to resolve file ids.
         std::vector<Match> m_results;
         usize m_objects = 0;
         usize m_limit;
+        Search_stats m_stats;
+    };
+
+    /**
+     * Access path of a compiled pattern, chosen by the planner. Estimated cost is in nanoseconds of
+     * scan work summed over all partial searches, so it can be compared with the actual
+     * Search_stats::m_work_time.
+     */
+    struct Plan {
+        enum class Access : u8 {
+            scan,      // All files, with character class masks skipped in bulk.
+            extension, // Files from the extension bitmaps of the query extension.
+            subtree,   // Files of the directories on the searched path.
+            index,     // Intersection of ext: and dir: term bitmaps.
+            filter,    // Files set in the filter bitset of metadata and negated terms.
+            prefix     // Range of the sorted name index starting with the anchored name prefix.
+        };
+
+        Access m_access = Access::scan;
+        usize m_files = 0; // Estimated number of visited files.
+        f64 m_cost = 0.0;
+
+        [[nodiscard]] std::string_view name() const noexcept
+        {
+            switch (m_access) {
+            case Access::scan:
+                return "scan";
+            case Access::extension:
+                return "extension";
+            case Access::subtree:
+                return "subtree";
+            case Access::index:
+                return "index";
+            case Access::filter:
+                return "filter";
+            case Access::prefix:
+                return "prefix";
+            }
+
+            unreachable();
+        }
+    };
+
+    /**
+     * Compiled search query. User query is split into a path and name parts only once per
+     * keystroke, and the same pattern is shared by all partial searches.
+     */
+    struct Pattern {
+        /**
+         * Name term other than the first one. Anchored term matches from the start of the name.
+         */
+        struct Name_term {
+            std::vector<std::string> m_parts;
+            bool m_anchored = false;
+        };
+
+        std::string m_path;               // Searched path (query part before last separator).
+        std::vector<std::string> m_parts; // Name parts (query name part separated by *).
+        bool m_anchored = false;          // Name parts match from the start of the name (^).
+
+        // Other name terms, which must match too, in any order, and negated name terms, none of
+        // which may match.
+        std::vector<Name_term> m_other_terms;
+        std::vector<Name_term> m_excluded_terms;
+
+        // Bitset of files passing metadata terms and negated ext: and dir: terms, when they are
+        // not folded into candidates. Flat, so a scan checks it with a single load.
+        std::vector<u64> m_filter;
+        std::vector<u8> m_dirs_on_path;   // Per directory id, 1 if directory is on searched path.
+        bool m_path_found = true;         // Whether any directory is on searched path.
+        u64 m_name_mask = 0;              // Character classes of all name parts.
+        bool m_ignore_case = true;        // Smart case, query without uppercase ignores case.
+
+        // Files that can match, when the plan is not a scan. Otherwise, all files are scanned.
+        std::optional<Id_bitmap> m_candidates;
+        Plan m_plan;
+
+        // Approximate name matching, set only for patterns made by fuzzy().
+        std::optional<Fuzzy_pattern> m_fuzzy;
+        usize m_max_errors = 0;
+
+        // Regex name matching, set only for patterns made by compile_regex(). Parts are then the
+        // literals that every match contains, which are checked before the regex.
+        std::shared_ptr<const Regex> m_regex;
+        std::string m_error; // Regex syntax error, pattern matches nothing.
+    };
+
+    // Exact searches with fewer results are repeated with a fuzzy pattern.
+    static constexpr usize fuzzy_min_results = 3;
+
+    struct Options {
+        // Directory index is an ART keyed by full directory paths, which speeds up directory
+        // lookups on inserts and erases at the cost of storing full paths again.
+        bool m_dir_index = false;
+
+        // Front codes file names. Names take a fraction of memory, for some decoding work on
+        // every scanned file.
+        bool m_compress_names = false;
+
+        // Keeps size, mtime, mode and device columns (set by set_metadata()), so queries can
+        // filter on them.
+        bool m_metadata = false;
+
+        // Keeps file ids sorted by folded name, so anchored queries (^name) visit only files
+        // whose names start with the query, found by a binary search.
+        bool m_name_index = false;
     };
 
+    Files() = default;
+
+    explicit Files(Options options)
+        : m_compressed_names{options.m_compress_names ?
+                                 std::make_unique<Front_coded_names>(m_memory.get()) :
+                                 nullptr}
+        , m_metadata_enabled{options.m_metadata}
+        , m_name_index_enabled{options.m_name_index}
+        , m_dir_index_enabled{options.m_dir_index}
+    {
+    }
+
     /**
      * Class that wraps insert result.
-     * It holds a pointer to Leaf and a bool flag representing whether insert succeeded (read insert
+     * It holds id of the file and a bool flag representing whether insert succeeded (read insert
      * for more details).
      */
     class result {
     public:
-        result(FileInfo* value, bool ok) : m_value{value}, m_ok{ok} { assert(m_value != nullptr); }
-
-        FileInfo* get() noexcept { return m_value; }
+        result(File_id value, bool ok) : m_value{value}, m_ok{ok} { assert(m_value.valid()); }
 
-        [[nodiscard]] const FileInfo* get() const noexcept { return m_value; }
+        [[nodiscard]] File_id get() const noexcept { return m_value; }
 
         [[nodiscard]] constexpr bool ok() const noexcept { return m_ok; }
 
-        FileInfo* operator->() noexcept { return get(); }
-
-        const FileInfo* operator->() const noexcept { return get(); }
-
         constexpr operator bool() const noexcept { return ok(); }
 
     private:
-        FileInfo* m_value;
+        File_id m_value;
         bool m_ok;
     };
 
@@ -213,228 +607,1574 @@ public:
     }
 
     /**
-     * Erases file from files.
+     * Erases file from files. Returns id the file had, which is reused by later inserts, or
+     * invalid id if file is not indexed.
      */
-    void erase(const fs::path& path)
+    File_id erase(const fs::path& path)
     {
-        erase(path.filename().string(), parent_path(path).string());
+        return erase(path.filename().string(), parent_path(path).string());
     }
 
     /**
-     * Searches for files with provided regex.
-     */
-    Matches search(const std::string& regex) const noexcept { return partial_search(regex, 1, 0); }
-
-    /**
-     * Partial files search user for multithreaded search. User should provide number of slices
-     * (threads) and a slice number (thread number) that is used for search.
-     * Slice number is 0 based.
+     * Names of files directly in the directory, empty if the directory is not indexed.
      */
-    Matches partial_search(const std::string& regex, usize slice_count,
-                           usize slice_number) const noexcept
+    [[nodiscard]] std::vector<std::string> dir_file_names(std::string dir_path)
     {
-        assert(slice_count > slice_number);
-
-        Matches matches;
-        usize slash_pos = regex.find_last_of(os::path_sep);
+        if (!dir_path.ends_with(os::path_sep))
+            dir_path += os::path_sep;
 
-        std::string search_name{slash_pos != std::string::npos ? regex.substr(slash_pos + 1) :
-                                                                 regex};
-        std::string search_path{slash_pos != std::string::npos ? regex.substr(0, slash_pos) : ""};
-
-        if (!search_path.empty() && !m_file_paths.search_prefix_node(search_path))
-            return matches;
+        const Dir_id dir = find_dir(dir_path, false);
+        if (!dir.valid())
+            return {};
 
-        usize chunk = std::max(usize(1), m_files.size() / slice_count);
-        auto file = m_files.begin() + chunk * slice_number;
-        if (file >= m_files.end())
-            return matches;
+        std::vector<std::string> names;
+        for (const File_id id : m_dir_files[dir.index()])
+            names.emplace_back(name(id));
 
-        const auto& end = slice_count == slice_number + 1 ? m_files.end() : file + chunk;
+        return names;
+    }
 
-        std::vector<std::string> parts{string_split(search_name, "*")};
+    [[nodiscard]] bool metadata_enabled() const noexcept { return m_metadata_enabled; }
 
-        for (; file < end; ++file) {
-            const stl::SmallString& file_name = file->name();
-            const std::string_view& file_path = file->path();
+    /**
+     * Stores metadata of the file into the metadata columns. Ignored when metadata is disabled.
+     */
+    void set_metadata(File_id id, const os::File_stat& stat) noexcept
+    {
+        if (!m_metadata_enabled)
+            return;
 
-            const bool on_path = search_path.empty() || file_path.starts_with(search_path);
-            if (!on_path)
-                continue;
+        m_sizes[id.index()] = i64(stat.m_size);
+        m_mtimes[id.index()] = stat.m_mtime;
+        m_modes[id.index()] = stat.m_mode;
+        m_devices[id.index()] = stat.m_device;
+    }
 
-            if (!match_name(file_name, parts))
-                continue;
+    [[nodiscard]] os::File_stat metadata(File_id id) const noexcept
+    {
+        assert(m_metadata_enabled);
+        return {.m_size = u64(m_sizes[id.index()]),
+                .m_mtime = m_mtimes[id.index()],
+                .m_mode = m_modes[id.index()],
+                .m_device = m_devices[id.index()]};
+    }
 
-            if (matches.full()) {
-                matches.insert();
-                continue;
-            }
+    /**
+     * Sets ranking boost of the file. Matches of boosted files are ranked before the rest, higher
+     * boosts first. Boosts may be resized, so no search can run meanwhile.
+     */
+    void set_boost(File_id id, f32 boost)
+    {
+        assert(id.index() < m_files.size());
+        if (m_boosts.size() <= id.index())
+            m_boosts.resize(m_files.size());
 
-            match_slow(matches, parts, file_name, file_path, search_path, &*file);
-        }
+        m_boosts[id.index()] = boost;
+    }
 
-        return matches;
+    [[nodiscard]] f32 boost(File_id id) const noexcept
+    {
+        return id.index() < m_boosts.size() ? m_boosts[id.index()] : 0;
     }
 
     /**
-     * File name match.
-     * It iterates over all parts (strings in the original string separated by *) and checks if file
-     * name constains them in order.
+     * Calls fn(id, dir, name) for every file, in file id order. Name view is valid only during
+     * the call.
      */
-    [[clang::always_inline]] bool match_name(const stl::SmallString& file_name,
-                                             const std::vector<std::string>& parts) const noexcept
+    template<class Fn>
+    void for_each_file(Fn&& fn) const
     {
-        usize offset = 0;
-        for (const std::string& part : parts) {
-            if (part.empty())
-                continue;
-
-            offset = file_name.find(part, offset);
-            if (offset == stl::SmallString::npos)
-                return false;
-
-            offset += part.size();
+        Front_coded_names::Cursor cursor;
+        for (usize i = 0; i < m_files.size(); ++i) {
+            if (!m_files[i].erased())
+                fn(File_id::from_index(i), m_files[i].dir(), name(m_files[i], cursor));
         }
-
-        return true;
     }
 
     /**
-     * Slow file name match.
-     * Similar to fast match, it iterates over all parts (strings in the original string separated
-     * by *) and checks if file name constains them in order. If all checks passed, it inserts a
-     * full match. Slow means additional tracking of a matched characters positions. We will keep
-     * matched letters in a bitset which will later be used to highlight matched text.
+     * Searches for files with provided regex.
      */
-    void match_slow(Matches& matches, const std::vector<std::string>& parts,
-                    const stl::SmallString& file_name, const std::string_view& file_path,
-                    const std::string& search_path, const FileInfo* file_info) const noexcept
+    Matches search(const std::string& regex) const noexcept { return partial_search(regex, 1, 0); }
+
+    /**
+     * Compiles user query into a search pattern. Query is split into terms (see Query_term).
+     */
+    Pattern compile(const std::string& query) const { return compile(parse_terms(query)); }
+
+    /**
+     * Compiles query terms into a search pattern. First name term with a path separator gives
+     * the searched path, and its directories are resolved here, once per keystroke, so partial
+     * searches only check one byte per file.
+     * ext: and dir: terms are answered from bitmaps, which are intersected (and negated ones
+     * subtracted) here, so every extra term makes partial searches visit fewer files. Metadata
+     * terms are vectorized scans over metadata columns, and become candidates when they are
+     * selective enough. Only name terms are matched per file.
+     */
+    Pattern compile(const std::vector<Query_term>& terms) const
     {
-        assert(!matches.full());
+        Pattern pattern;
+        bool has_name = false;
+        std::string names; // All name terms, for smart case.
+
+        std::vector<Id_bitmap> required;
+        Id_bitmap excluded;
+        std::vector<const Query_term*> metadata;
+
+        for (const Query_term& term : terms) {
+            if (term.m_kind == Query_term::Kind::size || term.m_kind == Query_term::Kind::mtime ||
+                term.m_kind == Query_term::Kind::type) {
+                metadata.push_back(&term);
+                continue;
+            }
 
-        std::bitset<match_max> match_bs;
-        usize offset = 0;
+            if (term.m_kind != Query_term::Kind::name) {
+                Id_bitmap files = term.m_kind == Query_term::Kind::ext ?
+                                      extension_files(term.m_text) :
+                                      dir_files(term.m_text);
+                if (term.m_negated)
+                    excluded.unite(files);
+                else
+                    required.push_back(std::move(files));
 
-        for (const std::string& part : parts) {
-            if (part.empty())
                 continue;
+            }
 
-            offset = file_name.find(part, offset);
-            if (offset == stl::SmallString::npos)
-                return;
+            std::string name = term.m_text;
+            if (const usize sep = name.find_last_of(os::path_sep);
+                sep != std::string::npos && !term.m_negated && !has_name) {
+                pattern.m_path = name.substr(0, sep);
+                name.erase(0, sep + 1);
+            }
 
-            std::bitset<match_max> match_count{(usize(1) << part.size()) - 1};
-            usize shift = file_path.size() + offset;
-            match_bs |= match_count << shift;
+            names += name;
+            std::vector<std::string> parts = string_split(name, "*");
 
-            offset += part.size();
+            if (term.m_negated) {
+                pattern.m_excluded_terms.push_back(
+                    {.m_parts = std::move(parts), .m_anchored = term.m_anchored});
+                continue;
+            }
+
+            // Masks are built from folded names, so query mask is folded even for case sensitive
+            // queries.
+            for (const std::string& part : string_split(fold_case(name), "*"))
+                pattern.m_name_mask |= char_mask(part);
+
+            if (has_name) {
+                pattern.m_other_terms.push_back(
+                    {.m_parts = std::move(parts), .m_anchored = term.m_anchored});
+            }
+            else {
+                pattern.m_parts = std::move(parts);
+                pattern.m_anchored = term.m_anchored;
+            }
+
+            has_name = true;
         }
 
-        for (usize i = 0; i < search_path.size(); ++i)
-            match_bs.set(i);
+        // Names are matched in their folded form when query has no uppercase.
+        pattern.m_ignore_case = fold_case(names) == names;
 
-        matches.insert(file_info, match_bs);
-    }
+        if (!metadata.empty() && !m_metadata_enabled) {
+            pattern.m_error = "Metadata terms need metadata columns (--metadata)";
+            return pattern;
+        }
 
-    auto files_count() { return m_files.size(); }
+        plan(pattern);
 
-    auto files_size()
-    {
-        return m_files.size() * (sizeof(FileInfo) + sizeof(std::unique_ptr<FileInfo>));
-    }
+        const bool indexed = !required.empty();
+        if (indexed) {
+            std::ranges::sort(required, {}, [](const Id_bitmap& files) { return files.count(); });
 
-    auto file_paths_leaves_count() { return m_file_paths.leaves_count(); }
+            if (!pattern.m_candidates) {
+                pattern.m_candidates = std::move(required.front());
+                required.erase(required.begin());
+            }
 
-    auto file_paths_size(bool full_leaves = true)
-    {
-        return m_file_paths.size_in_bytes(full_leaves);
-    }
+            for (const Id_bitmap& files : required)
+                pattern.m_candidates->intersect(files);
+        }
 
-    void print_stats()
-    {
-        std::cout << "-------------------------------\n";
-        std::cout << "Files count: " << m_files.size() << "\n";
-        std::cout << "-------------------------------\n";
+        std::vector<u64> filter;
+        if (!metadata.empty())
+            filter = metadata_filter(metadata);
 
-        std::cout << "File paths stats:\n";
-        m_file_paths.print_stats();
-    }
+        const bool subtracted = !excluded.empty() && pattern.m_candidates;
+        if (subtracted)
+            pattern.m_candidates->subtract(excluded);
+        else if (!excluded.empty()) {
+            if (filter.empty())
+                filter.assign((m_files.size() + 63) / 64, ~u64(0));
 
-private:
-    result insert(std::string file_name, std::string file_path)
-    {
-        if (FileInfo* res = find(file_name, file_path); res != nullptr) // File already exist.
-            return {res, false};
+            excluded.for_each(0, u32(m_files.size()), [&](u32 idx) {
+                filter[idx / 64] &= ~(u64(1) << (idx % 64));
+            });
+        }
 
-        static usize guid{0};
-        usize file_guid = guid++;
+        // Files passing a selective filter are visited directly, a dense filter is only checked on
+        // every scanned file. Unlike candidates, filter needs no building.
+        if (!filter.empty() && !pattern.m_candidates) {
+            if (m_files.size() % 64 != 0)
+                filter.back() &= (u64(1) << (m_files.size() % 64)) - 1;
+
+            usize files = 0;
+            for (const u64 word : filter)
+                files += usize(std::popcount(word));
+
+            const f64 cost =
+                f64(files) * (visit_cost + (mask_selectivity(pattern.m_name_mask) * match_cost));
+            if (cost < pattern.m_plan.m_cost) {
+                pattern.m_plan =
+                    Plan{.m_access = Plan::Access::filter, .m_files = files, .m_cost = cost};
+            }
+        }
 
-        m_files.emplace(file_guid, file_name);
-        FileInfo& file = m_files[file_guid];
-        assert(file.name() == file_name);
+        pattern.m_filter = std::move(filter);
 
-        m_file_paths[file_path].push_back(file_guid);
-        file.set_path(m_file_paths.leaf_from_value(m_file_paths[file_path])->key_to_string_view());
-        assert(file.path() == file_path);
+        if (indexed || subtracted) {
+            const usize files = pattern.m_candidates->count();
+            pattern.m_plan = Plan{.m_access = Plan::Access::index,
+                                  .m_files = files,
+                                  .m_cost = candidates_cost(files, pattern.m_name_mask)};
+        }
 
-        return {&file, true};
+        return pattern;
     }
 
-    void erase(const std::string& file_name, const std::string& file_path)
+    /**
+     * Compiles regex query into a search pattern. Regex is matched against file names, and
+     * directories are filtered by the path, same as in compile(). Regex syntax errors don't throw,
+     * they are reported in the pattern, since queries are compiled while they are typed.
+     */
+    Pattern compile_regex(const std::string& regex, std::string path = {}) const
     {
-        auto res = m_file_paths.search(file_path);
-        if (res == nullptr)
-            return;
+        if (path.size() > 1 && path.ends_with(os::path_sep))
+            path.pop_back();
+
+        Pattern pattern{.m_path = std::move(path)};
+
+        // Smart case, escapes like \D and \W don't make the regex case sensitive.
+        std::string unescaped;
+        for (usize i = 0; i < regex.size(); ++i) {
+            if (regex[i] == '\\')
+                ++i;
+            else
+                unescaped += regex[i];
+        }
 
-        std::vector<usize>& files_on_path = res->value();
-        auto fpaths_it = std::ranges::find_if(
-            files_on_path, [&](usize guid) { return m_files[guid].name() == file_name; });
+        pattern.m_ignore_case = fold_case(unescaped) == unescaped;
 
-        if (fpaths_it == files_on_path.end())
-            return;
+        try {
+            pattern.m_regex = std::make_shared<const Regex>(regex);
+        }
+        catch (const std::runtime_error& e) {
+            pattern.m_error = e.what();
+            return pattern;
+        }
 
-        files_on_path.erase(fpaths_it);
+        pattern.m_parts = pattern.m_regex->literals();
+        for (const std::string& part : pattern.m_parts)
+            pattern.m_name_mask |= char_mask(fold_case(part));
 
-        auto file_it = std::ranges::find_if(m_files, [&](const FileInfo& file) {
-            return file.name() == file_name && file.path() == file_path;
-        });
+        plan(pattern);
+        return pattern;
+    }
 
-        assert(file_it != m_files.end());
-        m_files.erase(file_it);
+    /**
+     * Typo tolerant version of the pattern, for queries where exact search finds fewer than
+     * fuzzy_min_results files. Only single part queries of 3 to 64 bytes can be fuzzy, with one
+     * error allowed up to 5 bytes and two errors for longer queries.
+     */
+    std::optional<Pattern> fuzzy(const Pattern& pattern) const
+    {
+        const auto non_empty = [](const std::string& part) { return !part.empty(); };
+        if (std::ranges::count_if(pattern.m_parts, non_empty) != 1 || !pattern.m_path_found ||
+            pattern.m_regex || pattern.m_plan.m_access == Plan::Access::index ||
+            !pattern.m_filter.empty() || !pattern.m_other_terms.empty() ||
+            !pattern.m_excluded_terms.empty() || pattern.m_anchored)
+            return std::nullopt;
+
+        const std::string& part = *std::ranges::find_if(pattern.m_parts, non_empty);
+        if (part.size() < 3 || part.size() > Fuzzy_pattern::max_size)
+            return std::nullopt;
+
+        Pattern fuzzy = pattern;
+        fuzzy.m_candidates.reset(); // Extension can be mistyped too.
+        fuzzy.m_plan = Plan{.m_access = Plan::Access::scan,
+                            .m_files = m_files.size(),
+                            .m_cost = f64(m_files.size()) * (mask_cost + match_cost)};
+        fuzzy.m_fuzzy.emplace(part);
+        fuzzy.m_max_errors = part.size() <= 5 ? 1 : 2;
+        return fuzzy;
+    }
 
-        /**
-         * This must be done after removing file from m_files, since file's path is in file
-         * paths, and we won't be able to match path when searching for file.
-         */
-        if (files_on_path.empty())
-            m_file_paths.erase(file_path);
+    /**
+     * Partial files search user for multithreaded search. User should provide number of slices
+     * (threads) and a slice number (thread number) that is used for search.
+     * Slice number is 0 based.
+     */
+    Matches partial_search(const std::string& regex, usize slice_count,
+                           usize slice_number) const noexcept
+    {
+        return partial_search(compile(regex), slice_count, slice_number);
     }
 
     /**
-     * Finds single file with provided name and file path if it exists.
+     * Partial files search with already compiled pattern.
+     */
+    Matches partial_search(const Pattern& pattern, usize slice_count,
+                           usize slice_number) const noexcept
+    {
+        TZoneScopedN("partial_search");
+        TZoneValue(slice_number);
+
+        assert(slice_count > slice_number);
+
+        Matches matches{this};
+        const Time_point start = now();
+
+        const std::string& search_path = pattern.m_path;
+        const std::vector<std::string>& parts = pattern.m_parts;
+        const std::vector<u8>& on_path_dirs = pattern.m_dirs_on_path;
+        const u64 name_mask = pattern.m_name_mask;
+        const bool fuzzy = pattern.m_fuzzy.has_value();
+
+        if (!pattern.m_path_found || !pattern.m_error.empty())
+            return matches;
+
+        const usize chunk = std::max(usize(1), m_files.size() / slice_count);
+        const usize first = chunk * slice_number;
+        if (first >= m_files.size())
+            return matches;
+
+        const usize last = slice_count == slice_number + 1 ? m_files.size() : first + chunk;
+
+        usize scanned = 0;
+        usize rejected = 0;
+        Front_coded_names::Cursor cursor;
+
+        // DFA cache is built lazily while matching, so every partial search has its own.
+        std::optional<Regex::Dfa> dfa;
+        if (pattern.m_regex)
+            dfa.emplace(*pattern.m_regex);
+
+        const auto scan = [&](usize idx) {
+            const FileInfo& file = m_files[idx];
+            if (file.erased())
+                return;
+
+            if (!pattern.m_filter.empty() && (pattern.m_filter[idx / 64] >> (idx % 64) & 1U) == 0) {
+                ++scanned;
+                ++rejected;
+                return;
+            }
+
+            // Every query character class missing from the name costs at least one error.
+            if (fuzzy && usize(std::popcount(name_mask & ~m_name_masks[idx])) >
+                             pattern.m_max_errors) {
+                ++scanned;
+                ++rejected;
+                return;
+            }
+
+            const std::string_view file_name = name(file, cursor);
+            const std::string_view match_name_view =
+                pattern.m_ignore_case ? folded_name(idx, file_name) : file_name;
+
+            ++scanned;
+
+            const usize dir = file.dir().index();
+            const bool on_path =
+                search_path.empty() || (dir < on_path_dirs.size() && on_path_dirs[dir] != 0);
+            if (!on_path) {
+                ++rejected;
+                return;
+            }
+
+            const auto id = File_id::from_index(idx);
+            if (fuzzy) {
+                match_fuzzy(matches, pattern, match_name_view, file_name, m_dirs[dir].path_size(),
+                            id);
+                return;
+            }
+
+            if (!match_name(match_name_view, parts, pattern.m_anchored))
+                return;
+
+            const auto term_matches = [&](const Pattern::Name_term& term) {
+                return match_name(match_name_view, term.m_parts, term.m_anchored);
+            };
+
+            if (!std::ranges::all_of(pattern.m_other_terms, term_matches) ||
+                std::ranges::any_of(pattern.m_excluded_terms, term_matches))
+                return;
+
+            if (dfa && !dfa->search(match_name_view))
+                return;
+
+            if (!matches.accepts(id)) {
+                matches.insert();
+                return;
+            }
+
+            if (dfa) {
+                match_regex(matches, *dfa, match_name_view, file_name, m_dirs[dir].path_size(),
+                            search_path, id);
+                return;
+            }
+
+            match_slow(matches, parts, match_name_view, file_name, m_dirs[dir].path_size(),
+                       search_path, id, pattern.m_other_terms);
+        };
+
+        if (pattern.m_candidates) {
+            // Only candidates of the plan, the rest of the slice is never touched.
+            pattern.m_candidates->for_each(u32(first), u32(last), [&](u32 idx) {
+                if ((m_name_masks[idx] & name_mask) != name_mask) {
+                    ++scanned;
+                    ++rejected;
+                    return;
+                }
+
+                scan(idx);
+            });
+        }
+        else if (pattern.m_plan.m_access == Plan::Access::filter) {
+            // Only files set in the filter, words without any are skipped whole.
+            for (usize i = first / 64; i * 64 < last; ++i) {
+                for (u64 word = pattern.m_filter[i]; word != 0; word &= word - 1) {
+                    const usize idx = (i * 64) + usize(std::countr_zero(word));
+                    if (idx < first)
+                        continue;
+
+                    if (idx >= last)
+                        break;
+
+                    if ((m_name_masks[idx] & name_mask) != name_mask) {
+                        ++scanned;
+                        ++rejected;
+                        continue;
+                    }
+
+                    scan(idx);
+                }
+            }
+        }
+        else {
+            for (usize idx = first; idx < last; ++idx) {
+                if (name_mask != 0 && !fuzzy) {
+                    // Skip names that miss some of the query characters without touching them.
+                    const usize skip =
+                        rejected_masks(m_name_masks.data() + idx, last - idx, name_mask);
+
+                    scanned += skip;
+                    rejected += skip;
+                    idx += skip;
+                    if (idx == last)
+                        break;
+                }
+
+                scan(idx);
+            }
+        }
+
+        matches.stats().m_scanned = scanned;
+        matches.stats().m_rejected = rejected;
+        matches.stats().m_scan_time = now() - start;
+        matches.stats().m_work_time = matches.stats().m_scan_time;
+        return matches;
+    }
+
+    /**
+     * File name match.
+     * It iterates over all parts (strings in the original string separated by *) and checks if file
+     * name constains them in order.
+     */
+    [[clang::always_inline]] bool match_name(std::string_view file_name,
+                                             const std::vector<std::string>& parts,
+                                             bool anchored = false) const noexcept
+    {
+        if (anchored && !parts.empty() && !file_name.starts_with(parts.front()))
+            return false;
+
+        usize offset = 0;
+        for (const std::string& part : parts) {
+            if (part.empty())
+                continue;
+
+            offset = file_name.find(part, offset);
+            if (offset == std::string_view::npos)
+                return false;
+
+            offset += part.size();
+        }
+
+        return true;
+    }
+
+    /**
+     * Slow file name match.
+     * Similar to fast match, it iterates over all parts (strings in the original string separated
+     * by *) and checks if file name constains them in order. If all checks passed, it inserts a
+     * full match. Slow means additional tracking of a matched characters positions. We will keep
+     * matched letters in a bitset which will later be used to highlight matched text.
+     */
+    void match_slow(Matches& matches, const std::vector<std::string>& parts,
+                    std::string_view file_name, std::string_view original_name, usize path_size,
+                    const std::string& search_path, File_id file_id,
+                    const std::vector<Pattern::Name_term>& other_terms = {}) const noexcept
+    {
+        assert(matches.accepts(file_id));
+
+        std::bitset<match_max> match_bs;
+
+        // Matched name can be folded, and folding can change sizes of code points, so offsets
+        // are mapped back to the original name.
+        const bool folded = file_name.data() != original_name.data();
+        const auto original_offset = [&](usize pos) {
+            return folded ? unfold_offset(original_name, file_name, pos) : pos;
+        };
+
+        const auto highlight = [&](const std::vector<std::string>& term_parts) {
+            usize offset = 0;
+            for (const std::string& part : term_parts) {
+                if (part.empty())
+                    continue;
+
+                offset = file_name.find(part, offset);
+                if (offset == std::string_view::npos)
+                    return false;
+
+                const usize begin = original_offset(offset);
+                const usize size = original_offset(offset + part.size()) - begin;
+
+                std::bitset<match_max> match_count{(usize(1) << size) - 1};
+                usize shift = path_size + begin;
+                match_bs |= match_count << shift;
+
+                offset += part.size();
+            }
+
+            return true;
+        };
+
+        if (!highlight(parts))
+            return;
+
+        for (const Pattern::Name_term& term : other_terms)
+            highlight(term.m_parts);
+
+        for (usize i = 0; i < search_path.size(); ++i)
+            match_bs.set(i);
+
+        matches.insert(match_bs, file_id);
+    }
+
+    /**
+     * Regex file name match, for names that already matched. Matched text is highlighted as the
+     * leftmost longest match.
+     */
+    void match_regex(Matches& matches, Regex::Dfa& dfa, std::string_view file_name,
+                     std::string_view original_name, usize path_size,
+                     const std::string& search_path, File_id file_id) const
+    {
+        assert(matches.accepts(file_id));
+
+        const bool folded = file_name.data() != original_name.data();
+        const auto original_offset = [&](usize pos) {
+            return folded ? unfold_offset(original_name, file_name, pos) : pos;
+        };
+
+        std::bitset<match_max> match_bs;
+        if (const auto match = dfa.find(file_name); match) {
+            const usize begin = original_offset(match->first);
+            const usize end = original_offset(match->second);
+            for (usize i = path_size + begin; i < path_size + end && i < match_max; ++i)
+                match_bs.set(i);
+        }
+
+        for (usize i = 0; i < search_path.size(); ++i)
+            match_bs.set(i);
+
+        matches.insert(match_bs, file_id);
+    }
+
+    /**
+     * Approximate file name match. Matched text is highlighted as the pattern sized window that
+     * ends at the best match.
+     */
+    void match_fuzzy(Matches& matches, const Pattern& pattern, std::string_view file_name,
+                     std::string_view original_name, usize path_size,
+                     File_id file_id) const noexcept
+    {
+        const auto result = pattern.m_fuzzy->search(file_name);
+        if (result.m_distance > pattern.m_max_errors)
+            return;
+
+        if (!matches.accepts(file_id)) {
+            matches.insert();
+            return;
+        }
+
+        const bool folded = file_name.data() != original_name.data();
+        const auto original_offset = [&](usize pos) {
+            return folded ? unfold_offset(original_name, file_name, pos) : pos;
+        };
+
+        const usize end = original_offset(result.m_end);
+        const usize begin =
+            original_offset(result.m_end - std::min(result.m_end, pattern.m_fuzzy->size()));
+
+        std::bitset<match_max> match_bs;
+        for (usize i = path_size + begin; i < path_size + end && i < match_max; ++i)
+            match_bs.set(i);
+
+        for (usize i = 0; i < pattern.m_path.size(); ++i)
+            match_bs.set(i);
+
+        matches.insert(match_bs, file_id);
+    }
+
+    auto files_count() const noexcept { return m_files.size() - m_free_files.size(); }
+
+    [[nodiscard]] const FileInfo& file(File_id id) const noexcept
+    {
+        assert(id.index() < m_files.size() && !m_files[id.index()].erased());
+        return m_files[id.index()];
+    }
+
+    /**
+     * File name. When names are compressed, returned view is valid only until the next name()
+     * call on the same thread.
      */
-    FileInfo* find(const std::string& file_name, const std::string& file_path)
+    [[nodiscard]] std::string_view name(File_id id) const
     {
-        auto res = m_file_paths.search(file_path);
-        if (!res)
-            return nullptr;
+        thread_local Front_coded_names::Cursor cursor;
+        return name(file(id), cursor);
+    }
+
+    [[nodiscard]] std::string path(File_id id) const { return dir_path(file(id).dir()); }
 
-        const auto& files = res->value();
-        for (usize guid : files) {
-            FileInfo& file = m_files[guid];
-            if (file.name() == file_name)
-                return &file;
+    /**
+     * Reconstructs full directory path from directory table.
+     */
+    [[nodiscard]] std::string dir_path(Dir_id id) const
+    {
+        std::string path;
+        path.resize(m_dirs[id.index()].path_size());
+
+        for (; id.valid(); id = m_dirs[id.index()].parent()) {
+            const DirInfo& dir = m_dirs[id.index()];
+            std::ranges::copy(dir.name(), path.begin() + i64(dir.path_size() - dir.name().size()));
         }
 
-        return nullptr;
+        return path;
+    }
+
+    [[nodiscard]] usize dirs_count() const noexcept { return m_dirs.size() - m_free_dirs.size(); }
+
+    [[nodiscard]] std::string full_path(File_id id) const
+    {
+        return std::format("{}{}", path(id), name(id));
+    }
+
+    /**
+     * Index generation. It is incremented on every successful insert and erase, so two indexes
+     * with the same generation and files count were (most likely) built from the same tree.
+     */
+    [[nodiscard]] u64 generation() const noexcept { return m_generation; }
+
+    /**
+     * Count of erased files. Ids of erased files are reused by inserts, so matches taken before
+     * an erase can refer to other files, or to none.
+     */
+    [[nodiscard]] u64 erasures() const noexcept { return m_erasures; }
+
+    /**
+     * Memory used by file infos, names, directory table and per directory file lists. Names and
+     * file lists are counted exactly, with allocator slack, since they are allocated from the
+     * tracking resource.
+     */
+    auto files_size()
+    {
+        return m_files.capacity() * sizeof(FileInfo) + m_name_masks.capacity() * sizeof(u64) +
+               m_folded_names.capacity() * sizeof(const char*) +
+               m_free_files.capacity() * sizeof(File_id) + m_boosts.capacity() * sizeof(f32) +
+               extensions_size() + metadata_size() + name_index_size() + dirs_size() +
+               m_memory->stats().usable();
+    }
+
+    /**
+     * Memory used by the sorted name index. Samples are estimated by their capacity.
+     */
+    [[nodiscard]] usize name_index_size() const noexcept
+    {
+        usize size = (m_sorted_names.capacity() + m_pending_names.capacity()) * sizeof(File_id) +
+                     m_name_samples.capacity() * sizeof(std::string);
+        for (const std::string& sample : m_name_samples)
+            size += sample.capacity();
+
+        return size;
+    }
+
+    /**
+     * Memory used by metadata columns.
+     */
+    [[nodiscard]] usize metadata_size() const noexcept
+    {
+        return (m_sizes.capacity() * sizeof(i64)) + (m_mtimes.capacity() * sizeof(i64)) +
+               (m_modes.capacity() * sizeof(u32)) + (m_devices.capacity() * sizeof(u64));
+    }
+
+    /**
+     * Memory used by directory table and children lookup, excluding names. Hash map nodes are
+     * estimated, since unordered_map doesn't expose its allocations.
+     */
+    usize dirs_size()
+    {
+        constexpr usize node_size =
+            sizeof(void*) + sizeof(std::pair<Dir_key, Dir_id>) + sizeof(usize);
+
+        return m_dirs.capacity() * sizeof(DirInfo) + m_free_dirs.capacity() * sizeof(Dir_id) +
+               m_dir_files.capacity() * sizeof(std::pmr::vector<File_id>) +
+               m_children.bucket_count() * sizeof(void*) + m_children.size() * node_size;
+    }
+
+    /**
+     * Memory used by extension bitmaps. Hash map nodes are not counted.
+     */
+    [[nodiscard]] usize extensions_size() const noexcept
+    {
+        usize size = m_multi_dot_files.size_in_bytes();
+        for (const auto& [ext, files] : m_extensions)
+            size += ext.capacity() + files.size_in_bytes();
+
+        return size;
+    }
+
+    [[nodiscard]] const Memory_stats& memory_stats() const noexcept { return m_memory->stats(); }
+
+    void print_stats()
+    {
+        std::cout << "-------------------------------\n";
+        std::cout << "Files count: " << files_count() << "\n";
+        std::cout << "Directories count: " << dirs_count() << "\n";
+        std::cout << "-------------------------------\n";
+
+        std::cout << std::format("Names arena: {} bytes used, {} bytes reserved\n",
+                                 m_names->used(), m_names->reserved());
+        if (m_compressed_names)
+            std::cout << std::format("Compressed names: {} bytes used for {} bytes of names\n",
+                                     m_compressed_names->used(), m_compressed_names->raw_size());
+        std::cout << std::format("Directory table: {} bytes\n", dirs_size());
+        std::cout << std::format("Extension bitmaps: {} extensions, {} bytes\n",
+                                 m_extensions.size(), extensions_size());
+        if (m_metadata_enabled)
+            std::cout << std::format("Metadata columns: {} bytes\n", metadata_size());
+        if (m_name_index_enabled)
+            std::cout << std::format("Name index: {} bytes\n", name_index_size());
+        std::cout << "Names and directory file lists memory:\n" << m_memory->stats().report();
+
+        if (m_dir_index_enabled) {
+            std::cout << "Directory index stats:\n";
+            m_dir_index.print_stats();
+        }
     }
 
 private:
-    // Container with file infos.
-    stl::ArrayMap<FileInfo> m_files;
+    /**
+     * Key of children lookup. Name views point to names stored in the directory table.
+     */
+    struct Dir_key {
+        Dir_id m_parent;
+        std::string_view m_name;
+
+        bool operator==(const Dir_key&) const noexcept = default;
+    };
+
+    struct Dir_key_hash {
+        usize operator()(const Dir_key& key) const noexcept
+        {
+            return std::hash<std::string_view>{}(key.m_name) ^
+                   (usize(key.m_parent.value()) * 0x9E3779B97F4A7C15ULL);
+        }
+    };
+
+    result insert(std::string file_name, std::string file_path)
+    {
+        TZoneScopedN("Files::insert");
+
+        if (File_id res = find(file_name, file_path); res.valid()) // File already exist.
+            return {res, false};
+
+        const Dir_id dir = find_dir(file_path, true);
+        const std::string folded = fold_case(file_name);
+        const char* folded_entry =
+            folded == file_name ? nullptr : m_names->local().store(folded).data();
+        const File_id id = add_file(make_file(file_name, dir), char_mask(folded), folded_entry);
+        assert(name(id) == file_name);
+        assert(path(id) == file_path);
+
+        m_dir_files[dir.index()].push_back(id);
+        index_extension(file_name, id, true);
+        if (m_name_index_enabled)
+            index_name(id);
+
+        ++m_generation;
+        return {id, true};
+    }
+
+    File_id erase(const std::string& file_name, const std::string& file_path)
+    {
+        TZoneScopedN("Files::erase");
+
+        const Dir_id dir = find_dir(file_path, false);
+        if (!dir.valid())
+            return File_id{};
+
+        std::pmr::vector<File_id>& files_on_path = m_dir_files[dir.index()];
+        auto fpaths_it =
+            std::ranges::find_if(files_on_path, [&](File_id id) { return name(id) == file_name; });
+
+        if (fpaths_it == files_on_path.end())
+            return File_id{};
+
+        const File_id id = *fpaths_it;
+        index_extension(file_name, *fpaths_it, false);
+        if (m_name_index_enabled)
+            unindex_name(*fpaths_it);
 
-    // Trie that holds file info indexes, where key is the full file path.
-    stl::ART<std::vector<usize>> m_file_paths;
+        m_files[fpaths_it->index()] = FileInfo{};
+        m_name_masks[fpaths_it->index()] = erased_mask;
+        m_folded_names[fpaths_it->index()] = nullptr;
+        if (fpaths_it->index() < m_boosts.size())
+            m_boosts[fpaths_it->index()] = 0;
+
+        m_free_files.push_back(*fpaths_it);
+        files_on_path.erase(fpaths_it);
+        ++m_generation;
+        ++m_erasures;
+
+        remove_empty_dirs(dir);
+        return id;
+    }
+
+    /**
+     * Finds single file with provided name and file path if it exists.
+     */
+    File_id find(const std::string& file_name, const std::string& file_path)
+    {
+        const Dir_id dir = find_dir(file_path, false);
+        if (!dir.valid())
+            return {};
+
+        for (File_id id : m_dir_files[dir.index()])
+            if (name(id) == file_name)
+                return id;
+
+        return {};
+    }
+
+    /**
+     * Finds directory by its full path, and creates it (and all missing parents) if requested.
+     * Crawl inserts all files of a directory one after another, so the last directory is cached.
+     */
+    Dir_id find_dir(std::string_view dir_path, bool create)
+    {
+        if (m_last_dir.valid() && dir_path == m_last_dir_path)
+            return m_last_dir;
+
+        Dir_id id;
+        if (!m_dir_index_enabled) {
+            id = walk_dir(dir_path, create);
+        }
+        else if (create) {
+            Dir_id& indexed = m_dir_index[std::string{dir_path}];
+            if (!indexed.valid())
+                indexed = walk_dir(dir_path, true);
+
+            id = indexed;
+        }
+        else if (auto* leaf = m_dir_index.search(std::string{dir_path}); leaf != nullptr) {
+            id = leaf->value();
+        }
+
+        if (id.valid()) {
+            m_last_dir = id;
+            m_last_dir_path = dir_path;
+        }
+
+        return id;
+    }
+
+    /**
+     * Walks directory table component by component, starting from the root.
+     */
+    Dir_id walk_dir(std::string_view dir_path, bool create)
+    {
+        Dir_id parent;
+        usize begin = 0;
+
+        do {
+            usize end = dir_path.find(os::path_sep, begin);
+            end = end == std::string_view::npos ? dir_path.size() : end + 1;
+
+            const std::string_view component = dir_path.substr(begin, end - begin);
+            if (auto it = m_children.find(Dir_key{parent, component}); it != m_children.end())
+                parent = it->second;
+            else if (create)
+                parent = add_dir(component, parent);
+            else
+                return {};
+
+            begin = end;
+        } while (begin < dir_path.size());
+
+        return parent;
+    }
+
+    Dir_id add_dir(std::string_view component, Dir_id parent)
+    {
+        const std::string_view name = m_names->local().store(component);
+        const usize parent_size = parent.valid() ? m_dirs[parent.index()].path_size() : 0;
+        const DirInfo dir{name, parent, parent_size + name.size()};
+
+        Dir_id id;
+        if (!m_free_dirs.empty()) {
+            id = m_free_dirs.back();
+            m_free_dirs.pop_back();
+            m_dirs[id.index()] = dir;
+        }
+        else {
+            m_dirs.push_back(dir);
+            m_dir_files.emplace_back(m_lists.get());
+            id = Dir_id::from_index(m_dirs.size() - 1);
+        }
+
+        if (parent.valid())
+            m_dirs[parent.index()].add_child();
+
+        m_children.emplace(Dir_key{parent, name}, id);
+        return id;
+    }
+
+    /**
+     * Removes directory if it has no files and no child directories, and then does the same for
+     * its parents.
+     */
+    void remove_empty_dirs(Dir_id id)
+    {
+        while (id.valid() && m_dir_files[id.index()].empty() &&
+               m_dirs[id.index()].children() == 0) {
+            const DirInfo dir = m_dirs[id.index()];
+
+            if (m_dir_index_enabled) {
+                const std::string path = dir_path(id);
+                if (m_dir_index.search(path) != nullptr)
+                    m_dir_index.erase(path);
+            }
+
+            if (m_last_dir == id)
+                m_last_dir = Dir_id{};
+
+            m_children.erase(Dir_key{dir.parent(), dir.name()});
+            m_dir_files[id.index()].shrink_to_fit();
+            m_dirs[id.index()] = DirInfo{};
+            m_free_dirs.push_back(id);
+
+            if (dir.parent().valid())
+                m_dirs[dir.parent().index()].remove_child();
+
+            id = dir.parent();
+        }
+    }
+
+    /**
+     * Marks directories whose full path starts with provided path. State of a directory is
+     * derived from the state of its parent, so every directory is resolved once, and full paths
+     * are never reconstructed.
+     */
+    std::vector<u8> dirs_on_path(std::string_view search_path) const
+    {
+        // Prefix state means that directory path is a proper prefix of the searched path.
+        enum State : u8 { off_path, on_path, prefix, unknown };
+
+        std::vector<u8> state(m_dirs.size(), unknown);
+        std::vector<Dir_id> stack;
+
+        const auto resolve = [&](const DirInfo& dir) -> u8 {
+            const u8 parent = dir.parent().valid() ? state[dir.parent().index()] : u8(prefix);
+            if (parent != prefix)
+                return parent;
+
+            const std::string_view rest = search_path.substr(dir.path_size() - dir.name().size());
+            if (dir.name().size() >= rest.size())
+                return dir.name().starts_with(rest) ? on_path : off_path;
+
+            return rest.starts_with(dir.name()) ? prefix : off_path;
+        };
+
+        for (usize i = 0; i < m_dirs.size(); ++i) {
+            if (state[i] != unknown || m_dirs[i].erased())
+                continue;
+
+            for (Dir_id id = Dir_id::from_index(i); id.valid() && state[id.index()] == unknown;
+                 id = m_dirs[id.index()].parent())
+                stack.push_back(id);
+
+            for (; !stack.empty(); stack.pop_back())
+                state[stack.back().index()] = resolve(m_dirs[stack.back().index()]);
+        }
+
+        for (u8& s : state)
+            s = s == on_path ? 1 : 0;
+
+        return state;
+    }
+
+    /**
+     * Adds file into (or removes it from) the bitmap of its extension. Names with more than one
+     * dot are also kept in a separate bitmap, since a query extension can be in the middle of
+     * their names (libfoo.so.1).
+     */
+    void index_extension(std::string_view file_name, File_id id, bool insert)
+    {
+        const auto ext = extension(file_name);
+        if (!ext)
+            return;
+
+        Id_bitmap& files = m_extensions[fold_case(*ext)];
+        insert ? files.insert(id.value()) : files.erase(id.value());
+
+        if (std::ranges::count(file_name, '.') > 1)
+            insert ? m_multi_dot_files.insert(id.value()) : m_multi_dot_files.erase(id.value());
+    }
+
+    /**
+     * Adds the file to the name index. Inserts are buffered and merged into the sorted ids in
+     * batches that grow with the index, so building the index costs a few sorts in total.
+     */
+    void index_name(File_id id)
+    {
+        m_pending_names.push_back(id);
+        if (m_pending_names.size() >= std::max(min_name_batch, m_sorted_names.size() / 8))
+            merge_names();
+    }
+
+    /**
+     * Removes the file from the name index, while its name is still stored. Sorted entry is
+     * replaced with an invalid id, so the slot can be reused by a file with another name, and
+     * entries are compacted by the next merge.
+     */
+    void unindex_name(File_id id)
+    {
+        if (const auto it = std::ranges::find(m_pending_names, id); it != m_pending_names.end()) {
+            *it = m_pending_names.back();
+            m_pending_names.pop_back();
+            return;
+        }
+
+        Front_coded_names::Cursor cursor;
+        Front_coded_names::Cursor entry_cursor;
+        const std::string_view folded = sorted_name(id, cursor);
+        for (usize i = names_range_start(folded); i < m_sorted_names.size(); ++i) {
+            const File_id entry = m_sorted_names[i];
+            if (entry == id) {
+                m_sorted_names[i] = File_id{};
+                ++m_stale_names;
+                break;
+            }
+
+            if (entry.valid() && sorted_name(entry, entry_cursor) > folded)
+                break;
+        }
+
+        if (m_stale_names > std::max(min_name_batch, m_sorted_names.size() / 8))
+            merge_names();
+    }
+
+    /**
+     * Sorts pending files, merges them into the sorted ids and drops erased entries. Samples are
+     * rebuilt from the merged ids.
+     */
+    void merge_names()
+    {
+        Front_coded_names::Cursor lhs_cursor;
+        Front_coded_names::Cursor rhs_cursor;
+        const auto name_less = [&](File_id lhs, File_id rhs) {
+            const std::string_view lhs_name = sorted_name(lhs, lhs_cursor);
+            const std::string_view rhs_name = sorted_name(rhs, rhs_cursor);
+            return lhs_name < rhs_name || (lhs_name == rhs_name && lhs < rhs);
+        };
+
+        std::ranges::sort(m_pending_names, name_less);
+        std::erase_if(m_sorted_names, [](File_id id) { return !id.valid(); });
+
+        std::vector<File_id> merged;
+        merged.reserve(m_sorted_names.size() + m_pending_names.size());
+        std::ranges::merge(m_sorted_names, m_pending_names, std::back_inserter(merged), name_less);
+
+        m_sorted_names = std::move(merged);
+        m_pending_names.clear();
+        m_stale_names = 0;
+
+        m_name_samples.clear();
+        for (usize i = 0; i < m_sorted_names.size(); i += name_sample_step)
+            m_name_samples.emplace_back(sorted_name(m_sorted_names[i], lhs_cursor));
+    }
+
+    /**
+     * Folded name of the file, the key of the name index.
+     */
+    std::string_view sorted_name(File_id id, Front_coded_names::Cursor& cursor) const
+    {
+        return folded_name(id.index(), name(m_files[id.index()], cursor));
+    }
+
+    /**
+     * Position in the sorted ids from which names not less than the folded name start. Samples
+     * are binary searched, and the block before the first sample not less than the name can hold
+     * equal names too.
+     */
+    [[nodiscard]] usize names_range_start(std::string_view folded) const noexcept
+    {
+        const auto sample = std::ranges::lower_bound(m_name_samples, folded, {},
+                                                     [](const std::string& s) {
+                                                         return std::string_view{s};
+                                                     });
+        const auto block = usize(sample - m_name_samples.begin());
+        return block == 0 ? 0 : (block - 1) * name_sample_step;
+    }
+
+    /**
+     * Sorted ids of files whose folded names start with the folded prefix. Sorted names with the
+     * prefix are contiguous, so the walk stops at the first greater name. Pending files are
+     * checked one by one, with their masks first.
+     */
+    std::vector<u32> prefix_files(std::string_view prefix) const
+    {
+        std::vector<u32> ids;
+        Front_coded_names::Cursor cursor;
+        for (usize i = names_range_start(prefix); i < m_sorted_names.size(); ++i) {
+            const File_id id = m_sorted_names[i];
+            if (!id.valid())
+                continue;
+
+            const std::string_view folded = sorted_name(id, cursor);
+            if (folded.starts_with(prefix))
+                ids.push_back(id.value());
+            else if (folded > prefix)
+                break;
+        }
+
+        const u64 mask = char_mask(prefix);
+        for (const File_id id : m_pending_names) {
+            if ((m_name_masks[id.index()] & mask) == mask &&
+                sorted_name(id, cursor).starts_with(prefix))
+                ids.push_back(id.value());
+        }
+
+        std::ranges::sort(ids);
+        return ids;
+    }
+
+    /**
+     * Chooses the cheapest access path for the pattern and builds its candidates. Selectivity of
+     * the name mask is estimated from a sample of masks, and sizes of the other access paths are
+     * known from the extension bitmaps and directory file lists. Also resolves directories on the
+     * searched path.
+     */
+    void plan(Pattern& pattern) const
+    {
+        if (!pattern.m_path.empty()) {
+            pattern.m_dirs_on_path = dirs_on_path(pattern.m_path);
+            pattern.m_path_found = std::ranges::find(pattern.m_dirs_on_path, u8(1)) !=
+                                   pattern.m_dirs_on_path.end();
+        }
+
+        const f64 selectivity = mask_selectivity(pattern.m_name_mask);
+        const auto candidates_cost = [&](usize files) {
+            return this->candidates_cost(files, pattern.m_name_mask);
+        };
+
+        Plan best{.m_access = Plan::Access::scan,
+                  .m_files = m_files.size(),
+                  .m_cost = f64(m_files.size()) * (mask_cost + (selectivity * match_cost))};
+
+        // Every name term must match, so any of their parts can narrow extensions.
+        std::vector<std::string> parts = pattern.m_parts;
+        for (const Pattern::Name_term& other : pattern.m_other_terms)
+            parts.insert(parts.end(), other.m_parts.begin(), other.m_parts.end());
+
+        const std::vector<const Id_bitmap*> bitmaps = extension_bitmaps(parts);
+        usize extension_files = 0;
+        for (const Id_bitmap* files : bitmaps)
+            extension_files += files->count();
+
+        if (!bitmaps.empty() && candidates_cost(extension_files) < best.m_cost)
+            best = Plan{.m_access = Plan::Access::extension,
+                        .m_files = extension_files,
+                        .m_cost = candidates_cost(extension_files)};
+
+        usize subtree_files = 0;
+        for (usize i = 0; i < pattern.m_dirs_on_path.size(); ++i)
+            subtree_files += pattern.m_dirs_on_path[i] != 0 ? m_dir_files[i].size() : 0;
+
+        if (!pattern.m_path.empty() && candidates_cost(subtree_files) < best.m_cost)
+            best = Plan{.m_access = Plan::Access::subtree,
+                        .m_files = subtree_files,
+                        .m_cost = candidates_cost(subtree_files)};
+
+        // Every match starts with the anchored name, so matches are one range of the name index.
+        std::vector<u32> prefix_ids;
+        if (m_name_index_enabled && pattern.m_anchored && !pattern.m_parts.empty() &&
+            !pattern.m_parts.front().empty()) {
+            prefix_ids = prefix_files(fold_case(pattern.m_parts.front()));
+            if (candidates_cost(prefix_ids.size()) < best.m_cost)
+                best = Plan{.m_access = Plan::Access::prefix,
+                            .m_files = prefix_ids.size(),
+                            .m_cost = candidates_cost(prefix_ids.size())};
+        }
+
+        pattern.m_plan = best;
+        pattern.m_candidates.reset();
+
+        if (best.m_access == Plan::Access::extension) {
+            pattern.m_candidates.emplace();
+            for (const Id_bitmap* files : bitmaps)
+                pattern.m_candidates->unite(*files);
+        }
+        else if (best.m_access == Plan::Access::subtree) {
+            pattern.m_candidates = files_of_dirs(pattern.m_dirs_on_path);
+        }
+        else if (best.m_access == Plan::Access::prefix) {
+            pattern.m_candidates.emplace();
+            for (const u32 id : prefix_ids)
+                pattern.m_candidates->insert(id);
+        }
+    }
+
+    /**
+     * Estimated cost of candidates: they are built once, then visited and matched by partial
+     * searches.
+     */
+    [[nodiscard]] f64 candidates_cost(usize files, u64 name_mask) const noexcept
+    {
+        return f64(files) * (build_cost + visit_cost + (mask_selectivity(name_mask) * match_cost));
+    }
+
+    /**
+     * Files of directories flagged in dirs (indexed by directory id).
+     */
+    Id_bitmap files_of_dirs(const std::vector<u8>& dirs) const
+    {
+        std::vector<u32> ids;
+        for (usize i = 0; i < dirs.size(); ++i) {
+            if (dirs[i] != 0) {
+                for (File_id id : m_dir_files[i])
+                    ids.push_back(u32(id.index()));
+            }
+        }
+
+        // Sorted inserts append to bitmap containers.
+        std::ranges::sort(ids);
+
+        Id_bitmap files;
+        for (u32 id : ids)
+            files.insert(id);
+
+        return files;
+    }
+
+    /**
+     * Bitset of files (indexed by file id) passing all metadata terms. Every term is a vectorized
+     * scan over its column. Bits past the last file are undefined.
+     */
+    std::vector<u64> metadata_filter(const std::vector<const Query_term*>& terms) const
+    {
+        assert(m_metadata_enabled);
+
+        // Values are clamped so bounds below can't overflow.
+        constexpr auto max_value = i64(1) << 62;
+        const i64 now = unix_time();
+
+        std::vector<u64> filter((m_files.size() + 63) / 64, ~u64(0));
+        std::vector<u64> bits(filter.size());
+
+        for (const Query_term* term : terms) {
+            const auto value = i64(std::min(term->m_value, u64(max_value)));
+            const bool greater = term->m_op == '>';
+
+            if (term->m_kind == Query_term::Kind::size) {
+                range_bits(m_sizes.data(), m_sizes.size(), greater ? value + 1 : -max_value,
+                           greater ? max_value : value - 1, bits.data());
+            }
+            else if (term->m_kind == Query_term::Kind::mtime) {
+                // Modified less than value ago is mtime after now - value, and vice versa.
+                range_bits(m_mtimes.data(), m_mtimes.size(), greater ? -max_value : now - value + 1,
+                           greater ? now - value - 1 : max_value, bits.data());
+            }
+            else {
+                const u32 type = term->m_text == "d" ? os::mode_dir : os::mode_file;
+                for (usize first = 0; first < m_modes.size(); first += 64) {
+                    u64 word = 0;
+                    for (usize i = first; i < std::min(m_modes.size(), first + 64); ++i)
+                        word |= u64((m_modes[i] & os::mode_type_mask) == type) << (i - first);
+
+                    bits[first / 64] = word;
+                }
+            }
+
+            for (usize i = 0; i < filter.size(); ++i)
+                filter[i] &= term->m_negated ? ~bits[i] : bits[i];
+        }
+
+        return filter;
+    }
+
+    /**
+     * Files with exactly the provided extension, ignoring case.
+     */
+    Id_bitmap extension_files(std::string_view ext) const
+    {
+        auto it = m_extensions.find(fold_case(ext));
+        return it != m_extensions.end() ? it->second : Id_bitmap{};
+    }
+
+    /**
+     * Files in directories whose name contains the text, at any depth. Text without uppercase
+     * ignores case.
+     */
+    Id_bitmap dir_files(std::string_view text) const
+    {
+        enum State : u8 { off, on, unknown };
+
+        const bool ignore_case = fold_case(text) == text;
+        const auto contains = [&](std::string_view name) {
+            return ignore_case ? fold_case(name).find(text) != std::string::npos :
+                                 name.find(text) != std::string_view::npos;
+        };
+
+        std::vector<u8> state(m_dirs.size(), unknown);
+        std::vector<Dir_id> stack;
+
+        for (usize i = 0; i < m_dirs.size(); ++i) {
+            if (state[i] != unknown || m_dirs[i].erased())
+                continue;
+
+            for (Dir_id id = Dir_id::from_index(i); id.valid() && state[id.index()] == unknown;
+                 id = m_dirs[id.index()].parent())
+                stack.push_back(id);
+
+            for (; !stack.empty(); stack.pop_back()) {
+                const DirInfo& dir = m_dirs[stack.back().index()];
+                const bool parent_on = dir.parent().valid() && state[dir.parent().index()] == on;
+                state[stack.back().index()] = parent_on || contains(dir.name()) ? on : off;
+            }
+        }
+
+        for (u8& s : state)
+            s = s == on ? 1 : 0;
+
+        return files_of_dirs(state);
+    }
+
+    /**
+     * Fraction of names whose mask has all classes of the query mask, estimated from evenly spaced
+     * samples.
+     */
+    [[nodiscard]] f64 mask_selectivity(u64 name_mask) const noexcept
+    {
+        if (name_mask == 0 || m_name_masks.empty())
+            return 1.0;
+
+        const usize step = std::max(usize(1), m_name_masks.size() / selectivity_samples);
+
+        usize sampled = 0;
+        usize passed = 0;
+        for (usize i = 0; i < m_name_masks.size(); i += step) {
+            ++sampled;
+            passed += (m_name_masks[i] & name_mask) == name_mask ? 1 : 0;
+        }
+
+        return f64(passed) / f64(sampled);
+    }
+
+    /**
+     * Extension bitmaps of files that can match name parts. A name containing a part with a dot
+     * (".cpp", "foo.h") has either an extension that starts with the text after the last dot of
+     * the part, or more than one dot. Returns bitmaps of the most selective part, or nothing when
+     * no part has such text.
+     */
+    std::vector<const Id_bitmap*> extension_bitmaps(const std::vector<std::string>& parts) const
+    {
+        std::vector<const Id_bitmap*> best;
+        usize best_count = std::numeric_limits<usize>::max();
+
+        for (const std::string& part : parts) {
+            const auto part_ext = extension(part);
+            if (!part_ext || part_ext->empty())
+                continue;
+
+            const std::string ext = fold_case(*part_ext);
+
+            std::vector<const Id_bitmap*> bitmaps{&m_multi_dot_files};
+            usize count = m_multi_dot_files.count();
+            for (const auto& [file_ext, files] : m_extensions) {
+                if (file_ext.starts_with(ext)) {
+                    bitmaps.push_back(&files);
+                    count += files.count();
+                }
+            }
+
+            if (count < best_count) {
+                best = std::move(bitmaps);
+                best_count = count;
+            }
+        }
+
+        return best;
+    }
+
+    /**
+     * Case folded name of the file. Most names are already folded, and only names that change are
+     * stored.
+     */
+    std::string_view folded_name(usize idx, std::string_view file_name) const noexcept
+    {
+        const char* folded = m_folded_names[idx];
+        return folded == nullptr ? file_name : std::string_view{folded};
+    }
+
+    FileInfo make_file(std::string_view file_name, Dir_id dir)
+    {
+        if (m_compressed_names)
+            return FileInfo{m_compressed_names->add(file_name), dir};
+
+        return FileInfo{m_names->local().store(file_name), dir};
+    }
+
+    std::string_view name(const FileInfo& file, Front_coded_names::Cursor& cursor) const
+    {
+        if (m_compressed_names)
+            return m_compressed_names->get(file.name_entry(), cursor);
+
+        return file.name();
+    }
+
+    /**
+     * Stores file info into the first free slot. Slots of erased files are reused.
+     */
+    File_id add_file(const FileInfo& file, u64 mask, const char* folded_name)
+    {
+        if (!m_free_files.empty()) {
+            const File_id id = m_free_files.back();
+            m_free_files.pop_back();
+            m_files[id.index()] = file;
+            m_name_masks[id.index()] = mask;
+            m_folded_names[id.index()] = folded_name;
+            if (m_metadata_enabled)
+                set_metadata(id, {});
+
+            return id;
+        }
+
+        m_files.push_back(file);
+        m_name_masks.push_back(mask);
+        m_folded_names.push_back(folded_name);
+        if (m_metadata_enabled) {
+            m_sizes.push_back(0);
+            m_mtimes.push_back(0);
+            m_modes.push_back(0);
+            m_devices.push_back(0);
+        }
+
+        return File_id::from_index(m_files.size() - 1);
+    }
+
+private:
+    // Memory resources are boxed so Files stays movable, and declared first so they outlive all
+    // containers.
+
+    // Counts all allocations of names and per directory file lists.
+    std::unique_ptr<Tracking_resource> m_memory = std::make_unique<Tracking_resource>();
+
+    // Per thread arenas holding file names. Names of erased files stay in the arena until Files is
+    // destroyed, when all memory is released at once.
+    std::unique_ptr<Arena_pool> m_names = std::make_unique<Arena_pool>(m_memory.get());
+
+    // Front coded file names, used instead of the arenas when names are compressed.
+    std::unique_ptr<Front_coded_names> m_compressed_names;
+
+    // Pools for per directory file lists, which grow and shrink, so they can't use the arena.
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> m_lists =
+        std::make_unique<std::pmr::unsynchronized_pool_resource>(m_memory.get());
+
+    // Planner costs in nanoseconds per file: mask check in a bulk scan, candidate bitmap visit
+    // (with its mask check), name match of a file that passed the mask, and candidate insert.
+    static constexpr f64 mask_cost = 0.5;
+    static constexpr f64 visit_cost = 3.0;
+    static constexpr f64 match_cost = 35.0;
+    static constexpr f64 build_cost = 5.0;
+    static constexpr usize selectivity_samples = 1024;
+
+    // Every name_sample_step-th name of the name index is sampled, and pending inserts are merged
+    // in batches of at least min_name_batch files.
+    static constexpr usize name_sample_step = 64;
+    static constexpr usize min_name_batch = 4096;
+
+    // Masks of erased files accept every query, so the scan reaches them and skips them as erased.
+    static constexpr u64 erased_mask = ~u64(0);
+
+    // File infos, name character masks and case folded names (null if name is already folded),
+    // indexed by file id. Folded names live in the names arena.
+    std::vector<FileInfo> m_files;
+    std::vector<u64> m_name_masks;
+    std::vector<const char*> m_folded_names;
+    std::vector<File_id> m_free_files; // Ids of erased files, reused by inserts.
+
+    // Ranking boosts, indexed by file id. Empty until a file is boosted, and files past its end
+    // have no boost.
+    std::vector<f32> m_boosts;
+
+    // Metadata columns, indexed by file id, kept only when metadata is enabled. Sizes are signed
+    // like mtimes, so filters compare both columns with the same vector compare.
+    bool m_metadata_enabled = false;
+    std::vector<i64> m_sizes;
+    std::vector<i64> m_mtimes;
+    std::vector<u32> m_modes;
+    std::vector<u64> m_devices;
+
+    // Name index, kept only when enabled: file ids sorted by folded name (invalid ids are erased
+    // files), sampled names of the sorted ids, and inserted files not merged yet.
+    bool m_name_index_enabled = false;
+    std::vector<File_id> m_sorted_names;
+    std::vector<std::string> m_name_samples;
+    std::vector<File_id> m_pending_names;
+    usize m_stale_names = 0; // Invalid ids in the sorted ids.
+
+    // Files per extension, and files with more than one dot in the name.
+    std::unordered_map<std::string, Id_bitmap> m_extensions;
+    Id_bitmap m_multi_dot_files;
+
+    // Directory table and per directory file lists, indexed by directory id.
+    std::vector<DirInfo> m_dirs;
+    std::vector<std::pmr::vector<File_id>> m_dir_files;
+    std::vector<Dir_id> m_free_dirs;
+
+    // Children lookup, (parent id, component name) -> directory id.
+    std::unordered_map<Dir_key, Dir_id, Dir_key_hash> m_children;
+
+    // Last looked up directory.
+    Dir_id m_last_dir;
+    std::string m_last_dir_path;
+
+    // Optional lookup accelerator, trie where key is the full directory path.
+    bool m_dir_index_enabled = false;
+    stl::ART<Dir_id> m_dir_index;
+
+    u64 m_generation = 0;
+    u64 m_erasures = 0;
 };
 
 // NOLINTEND(readability-implicit-bool-conversion, readability-redundant-access-specifiers,
@@ -19,17 +19,29 @@
 #define FINDER_HPP
 
 #include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <ranges>
+#include <shared_mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "crawl_queue.hpp"
 #include "files.hpp"
+#include "gitignore.hpp"
+#include "mounts.hpp"
+#include "path_rules.hpp"
+#include "perf.hpp"
 #include "symbols.hpp"
 #include "tokens.hpp"
 #include "util.hpp"
@@ -73,135 +85,540 @@ static constexpr bool is_cpp_keyword(const std::string& s)
     return std::ranges::find(cpp_keywords, s) != cpp_keywords.end();
 }
 
-class Options {
+/**
+ * Finder options, built with designated initializers. Fields left out keep their defaults.
+ */
+struct Options {
+    std::string m_root;
+    std::vector<std::string> m_ignore_list;
+    std::vector<std::string> m_include_list;
+    bool m_files = true;
+    bool m_symbols = false;
+    bool m_stat_only = false; // Prints stats and quits.
+    bool m_verbose = false;
+    u32 m_tasks_count = 1;
+    std::string m_stats_json; // Path for keystroke latency JSON report. Empty means no report.
+    std::string m_record;     // Path for session recording. Empty means no recording.
+    std::string m_replay;     // Path of a session to replay headlessly. Empty means interactive.
+    bool m_replay_realtime = false;
+    bool m_perf = false;            // Collect hardware counters per stage.
+    bool m_compress_names = false;  // Front code file names in the index.
+    bool m_metadata = false;        // Keep file metadata columns, filled while crawling.
+    bool m_name_index = false;      // Keep files sorted by name, for anchored (^name) queries.
+    bool m_gitignore = false;       // Skip entries ignored by .gitignore and .ignore files.
+    bool m_remote_mounts = false;   // Crawl remote and FUSE mounts, which are skipped by default.
+    bool m_one_file_system = false; // Don't crawl mounts of other devices than the root's.
+    bool m_rescan = false; // Keep directory mtimes, so a rescan reads only changed directories.
+    std::vector<std::string> m_hot_dirs;  // Crawled first, in this order.
+    std::vector<std::string> m_cold_dirs; // Crawled last.
+    std::string m_access_log; // Path of the access log. Empty means picks are not ranked.
+};
+
+class Finder {
 public:
-    explicit Options(std::string root, std::vector<std::string> ignore_list,
-                     std::vector<std::string> include_list, bool files, bool symbols,
-                     bool stat_only, bool verbose, u32 tasks_count)
-        : m_root{std::move(root)}
-        , m_ignore_list{std::move(ignore_list)}
-        , m_include_list{std::move(include_list)}
-        , m_files{files}
-        , m_symbols{symbols}
-        , m_stat_only{stat_only}
-        , m_verbose{verbose}
-        , m_tasks_count{tasks_count}
+    using dir_iter = fs::recursive_directory_iterator;
+    using Files_mutex = TSharedLockableBase(std::shared_mutex);
+
+    explicit Finder(const Options& opt)
+        : m_files{Files::Options{.m_compress_names = opt.m_compress_names,
+                                 .m_metadata = opt.m_metadata,
+                                 .m_name_index = opt.m_name_index}}
+        , m_root{opt.m_root}
+        , m_path_rules{opt.m_ignore_list, opt.m_include_list}
+        , m_crawl_queue{fs::path{m_root}.make_preferred().string()}
+        , m_remote_mounts(opt.m_remote_mounts)
+        , m_one_file_system(opt.m_one_file_system)
+        , m_gitignore_enabled(opt.m_gitignore)
+        , m_files_allowed(opt.m_files)
+        , m_symbols_allowed(opt.m_symbols)
+        , m_stat_only(opt.m_stat_only)
+        , m_verbose(opt.m_verbose)
+        , m_perf_enabled(opt.m_perf)
+        , m_background(!m_stat_only && opt.m_replay.empty() && opt.m_record.empty())
     {
+        if (const Mount_table::Mount* mount = m_mounts.mount_of(m_root.string()))
+            m_root_device = mount->m_device;
+
+        // Interactive finder searches files indexed so far while the crawl goes on. Stats, replays
+        // and recordings need the whole index, so they wait for the crawl. They also crawl in
+        // directory order, so file ids don't depend on where finder is started from.
+        if (m_background) {
+            m_verbose = false; // Crawl output would garble the console.
+            m_rescan_enabled = opt.m_rescan;
+            schedule(opt.m_hot_dirs, Crawl_queue::Priority::hot);
+            schedule(opt.m_cold_dirs, Crawl_queue::Priority::cold);
+
+            m_crawling = true;
+            m_crawler = std::thread{[this] {
+                Perf_scope perf{perf_stats(), "crawl"};
+                crawl();
+            }};
+
+            return;
+        }
+
+        {
+            Perf_scope perf{perf_stats(), "crawl"};
+            crawl();
+        }
+
+        print_stats();
+        if (m_stat_only)
+            std::exit(0); // NOLINT
     }
 
-    [[nodiscard]] const std::string& root() const noexcept { return m_root; }
+    Finder(const Finder&) = delete;
+    Finder& operator=(const Finder&) = delete;
 
-    [[nodiscard]] const std::vector<std::string>& ignore_list() const noexcept
+    ~Finder()
     {
-        return m_ignore_list;
+        m_stop = true;
+        if (m_crawler.joinable())
+            m_crawler.join();
     }
 
-    [[nodiscard]] const std::vector<std::string>& include_list() const noexcept
+    /**
+     * Directories checked by a rescan, and the changed ones among them, which were read again.
+     */
+    struct Rescan_stats {
+        usize m_dirs = 0;
+        usize m_changed = 0;
+    };
+
+    /**
+     * Starts a rescan in background, which reads again only directories whose mtime changed.
+     * Returns false if rescans are disabled or the crawl (or the last rescan) is still running.
+     */
+    bool rescan()
     {
-        return m_include_list;
+        if (!m_rescan_enabled || crawling())
+            return false;
+
+        if (m_crawler.joinable())
+            m_crawler.join();
+
+        m_crawling = true;
+        m_crawler = std::thread{[this] {
+            Perf_scope perf{perf_stats(), "rescan"};
+            rescan_changed();
+        }};
+
+        return true;
     }
 
-    [[nodiscard]] bool files_allowed() const noexcept { return m_files; }
+    /**
+     * Stats of the last finished rescan, if any. Read only while not crawling.
+     */
+    [[nodiscard]] const std::optional<Rescan_stats>& last_rescan() const noexcept
+    {
+        return m_last_rescan;
+    }
 
-    [[nodiscard]] bool symbols_allowed() const noexcept { return m_symbols; }
+    [[nodiscard]] Symbols& symbols() noexcept { return m_symbols; }
 
-    [[nodiscard]] bool stats_only() const noexcept { return m_stat_only; }
+    [[nodiscard]] Files& files() noexcept { return m_files; }
 
-    [[nodiscard]] bool verbose() const noexcept { return m_verbose; }
+    [[nodiscard]] const fs::path& dir() const noexcept { return m_root; }
 
-    [[nodiscard]] u32 tasks_count() const noexcept { return m_tasks_count; }
+    /**
+     * Mutex of files. Background crawl inserts batches of files under the exclusive lock, and
+     * everything else that reads files (searches, rendering) holds the shared lock, so it sees the
+     * index as of the last published batch. Ranking boosts of picks are written under the
+     * exclusive lock too, since searches read them.
+     */
+    [[nodiscard]] Files_mutex& files_mutex() const noexcept { return m_files_mutex; }
 
-private:
-    std::string m_root;
-    std::vector<std::string> m_ignore_list;
-    std::vector<std::string> m_include_list;
-    bool m_files;
-    bool m_symbols;
-    bool m_stat_only;
-    bool m_verbose;
-    u32 m_tasks_count;
-};
+    /**
+     * Whether the background crawl is still running. Once it returns false, all files are
+     * published.
+     */
+    [[nodiscard]] bool crawling() const noexcept
+    {
+        return m_crawling.load(std::memory_order_acquire);
+    }
 
-class Finder {
-public:
-    using dir_iter = fs::recursive_directory_iterator;
+    /**
+     * Files published by the crawl so far.
+     */
+    [[nodiscard]] usize crawled() const noexcept
+    {
+        return m_crawled.load(std::memory_order_relaxed);
+    }
 
-    explicit Finder(const Options& opt)
-        : m_root{opt.root()}
-        , m_ignore_list{opt.ignore_list()}
-        , m_include_list{opt.include_list()}
-        , m_files_allowed(opt.files_allowed())
-        , m_symbols_allowed(opt.symbols_allowed())
-        , m_stat_only(opt.stats_only())
-        , m_verbose(opt.verbose())
+    [[nodiscard]] Files::Matches find_files_partial(const std::string& regex, usize slice_count,
+                                                    usize slice_number) const noexcept
     {
-        constexpr auto it_opt = fs::directory_options::skip_permission_denied;
+        return m_files.partial_search(regex, slice_count, slice_number);
+    }
+
+    [[nodiscard]] Files::Matches find_files_partial(const Files::Pattern& pattern,
+                                                    usize slice_count,
+                                                    usize slice_number) const noexcept
+    {
+        return m_files.partial_search(pattern, slice_count, slice_number);
+    }
 
+    auto find_files(const std::string& regex) { return m_files.search(regex); }
+
+    Symbol* find_symbols(const std::string& symbol_name) { return m_symbols.search(symbol_name); }
+
+    /**
+     * Hardware counters stats, or null if hardware counters are disabled.
+     */
+    [[nodiscard]] Perf_stats* perf_stats() noexcept { return m_perf_enabled ? &m_perf : nullptr; }
+
+private:
+    // Crawled entries are published in batches of this many entries, or after this much time, so
+    // searches see new files soon and the exclusive lock is held only for a few milliseconds.
+    static constexpr usize crawl_batch_size = 4096;
+    static constexpr milliseconds crawl_batch_time = 50ms;
+
+    // Mtime of a directory modified in the second it was read. It can change again without
+    // changing its mtime, so every rescan reads it.
+    static constexpr i64 racy_mtime = std::numeric_limits<i64>::min();
+
+    /**
+     * Crawled entry, waiting in the batch to be published.
+     */
+    struct Crawled {
+        fs::path m_path;
+        os::File_stat m_stat;
+        bool m_stat_ok = false;
+        bool m_tokenize = false; // Symbols are tokenized from the file.
+    };
+
+    /**
+     * Schedules existing directories inside of the root. Directories are resolved (symbolic links,
+     * . and ..) and spelled as paths below the root, as the crawl meets them.
+     */
+    void schedule(const std::vector<std::string>& dirs, Crawl_queue::Priority priority)
+    {
         std::error_code ec;
-        dir_iter it{m_root, it_opt, ec};
+        const fs::path root = fs::weakly_canonical(m_root, ec);
+        if (ec)
+            return;
 
-        for (; it != dir_iter{}; it.increment(ec)) {
-            if (!check_iteration(it, ec))
+        for (const std::string& dir : dirs) {
+            const fs::path path = fs::weakly_canonical(dir, ec);
+            if (ec || !fs::is_directory(fs::symlink_status(path, ec)))
                 continue;
 
-            fs::path path = it->path(); // Need copy for make_prefrred.
+            const fs::path relative = path.lexically_relative(root);
+            if (relative.empty() || relative == "." || *relative.begin() == "..")
+                continue;
 
-            FileInfo* file = m_files.insert(path.make_preferred()).get();
+            m_crawl_queue.add((m_root / relative).make_preferred().string(), priority);
+        }
+    }
 
-            if (!m_symbols_allowed || !supported_file(it))
+    /**
+     * Crawls scheduled directories in priority order and inserts all files (and symbols if
+     * allowed) into the index. Slow work (directory reads and stats) is done without holding the
+     * files lock.
+     */
+    void crawl()
+    {
+        TZoneScopedN("crawl");
+
+        const Time_point crawl_start = now();
+        Time_point batch_start = crawl_start;
+        std::vector<Crawled> batch;
+
+        for (const Crawl_queue::Dir& dir : m_crawl_queue.dirs()) {
+            if (m_stop)
+                break;
+
+            if (!enter_dir(dir.m_path))
+                continue;
+
+            if (m_rescan_enabled)
+                record_dir(dir.m_path);
+
+            crawl_dir(dir.m_path, batch, batch_start, crawl_start);
+        }
+
+        publish(batch, crawl_start);
+        m_crawling.store(false, std::memory_order_release);
+    }
+
+    /**
+     * Reads again directories whose mtime changed since they were read. Their new entries are
+     * inserted (new directories are crawled whole), and entries that are gone are erased along
+     * with everything below them. Unchanged directories cost a single stat.
+     */
+    void rescan_changed()
+    {
+        TZoneScopedN("rescan");
+
+        // Map is ordered, so parents come before their children.
+        std::vector<std::string> changed;
+        for (const auto& [dir, mtime] : m_dir_mtimes) {
+            os::File_stat stat;
+            if (!os::file_stat(dir, stat) || stat.m_mtime != mtime)
+                changed.push_back(dir);
+        }
+
+        const Rescan_stats stats{.m_dirs = m_dir_mtimes.size(), .m_changed = changed.size()};
+
+        const Time_point crawl_start = now();
+        Time_point batch_start = crawl_start;
+        std::vector<Crawled> batch;
+
+        m_rescanning = true;
+        for (const std::string& dir : changed) {
+            if (m_stop)
+                break;
+
+            // Erased with its changed parent.
+            if (!m_dir_mtimes.contains(dir))
                 continue;
 
-            // TODO: Use file_to_string for quick file read.
-            std::ifstream ifs{it->path()};
-            if (!ifs.is_open()) {
-                std::cout << std::format("Problem with openning file {}.\n", it->path().string());
+            std::error_code ec;
+            if (!fs::is_directory(dir, ec) || !enter_dir(dir)) {
+                std::unique_lock lock{m_files_mutex};
+                erase_dir(dir);
                 continue;
             }
 
-            // Parse each line from file and save tokens.
-            NECTR_Tokenizer tokenizer;
-            Token token;
+            record_dir(dir);
+            std::vector<std::string> listed;
+            crawl_dir(dir, batch, batch_start, crawl_start, &listed);
+            std::ranges::sort(listed);
 
-            size_t line_num = 1;
-            for (std::string fline; std::getline(ifs, fline); ++line_num) {
-                tokenizer = fline;
-                while (tokenizer >> token) {
-                    if (token.type() != Token_t::word || is_cpp_keyword(token.str()))
-                        continue;
+            std::unique_lock lock{m_files_mutex};
+            for (const std::string& name : m_files.dir_file_names(dir)) {
+                if (std::ranges::binary_search(listed, name))
+                    continue;
 
-                    m_symbols.insert(token.str(), file, line_num, fline);
-                }
+                const std::string path = (fs::path{dir} / name).string();
+                erase_file(path);
+                erase_dir(path);
             }
         }
 
-        print_stats();
-        if (m_stat_only)
-            std::exit(0); // NOLINT
+        publish(batch, crawl_start);
+        m_rescanning = false;
+        m_last_rescan = stats;
+        m_crawling.store(false, std::memory_order_release);
     }
 
-    [[nodiscard]] Symbols& symbols() noexcept { return m_symbols; }
+    /**
+     * Stores mtime of the directory, before it is read.
+     */
+    void record_dir(const std::string& dir)
+    {
+        os::File_stat stat;
+        if (!os::file_stat(dir, stat))
+            return;
 
-    [[nodiscard]] Files& files() noexcept { return m_files; }
+        m_dir_mtimes[dir] = stat.m_mtime >= unix_time() - 1 ? racy_mtime : stat.m_mtime;
+    }
 
-    [[nodiscard]] const fs::path& dir() const noexcept { return m_root; }
+    /**
+     * Erases the file. Its id is reused by later inserts, so its symbols are erased on the next
+     * publish, before any insert. Files lock must be held.
+     */
+    void erase_file(const fs::path& path)
+    {
+        const File_id id = m_files.erase(path);
+        if (m_symbols_allowed && id.valid())
+            m_erased_files.push_back(id);
+    }
 
-    [[nodiscard]] Files::Matches find_files_partial(const std::string& regex, usize slice_count,
-                                                    usize slice_number) const noexcept
+    /**
+     * Erases files of the directory and of all directories below it, and forgets their mtimes.
+     * Files lock must be held.
+     */
+    void erase_dir(const std::string& dir)
     {
-        return m_files.partial_search(regex, slice_count, slice_number);
+        const auto erase_files = [&](auto it) {
+            for (const std::string& name : m_files.dir_file_names(it->first))
+                erase_file(fs::path{it->first} / name);
+
+            return m_dir_mtimes.erase(it);
+        };
+
+        if (const auto it = m_dir_mtimes.find(dir); it != m_dir_mtimes.end())
+            erase_files(it);
+
+        const std::string prefix = dir.ends_with(os::path_sep) ? dir : dir + os::path_sep;
+        for (auto it = m_dir_mtimes.lower_bound(prefix);
+             it != m_dir_mtimes.end() && it->first.starts_with(prefix);)
+            it = erase_files(it);
     }
 
-    auto find_files(const std::string& regex) { return m_files.search(regex); }
+    /**
+     * Crawls the directory, without entering other scheduled directories. Batch is published when
+     * it is full or old enough. Names of crawled entries directly in the directory are added to
+     * listed, if given.
+     */
+    void crawl_dir(const std::string& dir, std::vector<Crawled>& batch, Time_point& batch_start,
+                   Time_point crawl_start, std::vector<std::string>* listed = nullptr)
+    {
+        constexpr auto it_opt = fs::directory_options::skip_permission_denied;
 
-    Symbol* find_symbols(const std::string& symbol_name) { return m_symbols.search(symbol_name); }
+        std::error_code ec;
+        dir_iter it{dir, it_opt, ec};
+
+        for (; it != dir_iter{} && !m_stop; it.increment(ec)) {
+            if (!check_iteration(it, ec))
+                continue;
+
+            if (listed != nullptr && it.depth() == 0)
+                listed->push_back(it->path().filename().string());
+
+            Crawled entry{.m_path = it->path()}; // Need copy for make_prefrred.
+            entry.m_path.make_preferred();
+            entry.m_stat_ok =
+                m_files.metadata_enabled() && os::file_stat(entry.m_path.string(), entry.m_stat);
+            entry.m_tokenize = m_symbols_allowed && supported_file(it);
+            batch.push_back(std::move(entry));
+
+            if (batch.size() >= crawl_batch_size || now() - batch_start >= crawl_batch_time) {
+                publish(batch, crawl_start);
+                batch.clear();
+                batch_start = now();
+            }
+        }
+    }
+
+    /**
+     * Prepares crawl of the scheduled (or changed) directory. Directory below the root is crawled
+     * only if the crawl of the root would reach it, past ignore rules, skipped mounts and ignore
+     * files of the directories on the way, whose ignore files are pushed.
+     */
+    [[nodiscard]] bool enter_dir(const std::string& dir)
+    {
+        const std::string& root = m_crawl_queue.root();
+        if (dir != root && !m_path_rules.check(dir).m_recurse)
+            return false;
+
+        // Directories from the root down to the scheduled one.
+        std::vector<std::string> path{root};
+        for (usize pos = root.size() + (root.ends_with(os::path_sep) ? 0 : 1); pos < dir.size();
+             ++pos) {
+            pos = std::min(dir.find(os::path_sep, pos), dir.size());
+            path.push_back(dir.substr(0, pos));
+        }
+
+        m_gitignore = Gitignore{};
+        for (usize i = 0; i < path.size(); ++i) {
+            if (i != 0) {
+                const Mount_table::Mount* mount = m_mounts.mount_at(path[i]);
+                if (mount != nullptr && skipped_mount(*mount))
+                    return false;
+
+                if (m_gitignore_enabled && m_gitignore.ignored(path[i], true))
+                    return false;
+            }
+
+            // Scheduled directory is at depth -1, and the crawl inside of it starts at 0.
+            if (m_gitignore_enabled)
+                m_gitignore.enter(path[i], i64(i) - i64(path.size()));
+        }
+
+        return true;
+    }
+
+    /**
+     * Inserts the batch into files under the exclusive lock. Symbols are only touched by the
+     * crawl, so files are tokenized after the lock is released. Inserts reuse ids of erased
+     * files, so symbols of files erased since the last publish are erased first.
+     */
+    void publish(const std::vector<Crawled>& batch, Time_point crawl_start)
+    {
+        TZoneScopedN("publish");
+
+        if (!m_erased_files.empty()) {
+            std::ranges::sort(m_erased_files);
+            m_symbols.erase_files(m_erased_files);
+            m_erased_files.clear();
+        }
+
+        std::vector<File_id> ids; // Invalid for files that were already indexed.
+        ids.reserve(batch.size());
+        {
+            std::unique_lock lock{m_files_mutex};
+            for (const Crawled& entry : batch) {
+                const Files::result inserted = m_files.insert(entry.m_path);
+                if (entry.m_stat_ok)
+                    m_files.set_metadata(inserted.get(), entry.m_stat);
+
+                ids.push_back(inserted ? inserted.get() : File_id{});
+            }
+
+            m_crawled.store(m_files.files_count(), std::memory_order_relaxed);
+            plot_crawl(m_files.files_count(), crawl_start);
+        }
+
+        for (usize i = 0; i < batch.size(); ++i) {
+            if (batch[i].m_tokenize && ids[i].valid())
+                tokenize(batch[i].m_path, ids[i]);
+        }
+    }
+
+    /**
+     * Inserts symbols of the source file.
+     */
+    void tokenize(const fs::path& path, File_id file)
+    {
+        TZoneScopedN("tokenize");
+        Perf_scope perf{perf_stats(), "crawl: tokenize"};
+
+        // TODO: Use file_to_string for quick file read.
+        std::ifstream ifs{path};
+        if (!ifs.is_open()) {
+            if (!m_background)
+                std::cout << std::format("Problem with openning file {}.\n", path.string());
+
+            return;
+        }
+
+        // Parse each line from file and save tokens.
+        NECTR_Tokenizer tokenizer;
+        Token token;
+
+        size_t line_num = 1;
+        for (std::string fline; std::getline(ifs, fline); ++line_num) {
+            tokenizer = fline;
+            while (tokenizer >> token) {
+                if (token.type() != Token_t::word || is_cpp_keyword(token.str()))
+                    continue;
+
+                m_symbols.insert(token.str(), file, line_num, fline);
+            }
+        }
+    }
+
+    /**
+     * Feeds crawl progress into tracy plots. Compiles to nothing without tracy.
+     */
+    void plot_crawl([[maybe_unused]] usize crawled, [[maybe_unused]] Time_point crawl_start)
+    {
+        [[maybe_unused]] const f64 secs = duration_cast<duration<f64>>(now() - crawl_start).count();
+
+        TTracyPlot("files", i64(crawled));
+        TTracyPlot("files/s", secs > 0 ? f64(crawled) / secs : 0.0);
+        TTracyPlot("files memory", i64(m_files.files_size()));
+    }
 
-private:
     void print_stats()
     {
         m_files.print_stats();
 
         if (m_symbols_allowed)
             m_symbols.print_stats();
+
+        if (m_mounts.size() != 0)
+            std::cout << std::format("Mounts: {}, skipped {}\n", m_mounts.size(), m_skipped_mounts);
+
+        if (m_gitignore_enabled)
+            std::cout << std::format("Ignored by ignore files: {} directories (not read), {} "
+                                     "files\n",
+                                     m_ignored_dirs, m_ignored_files);
+
+        if (m_perf_enabled)
+            std::cout << m_perf.report();
     }
 
     // For symbol finder, we only support cpp files.
@@ -212,31 +629,63 @@ private:
     }
 
     /**
-     * Checks whether provided path is supported for finder.
-     * We will skip some OS specific paths to save space.
-     * If user provided ignore list, we will ignore path if it is contained in ignore list and
-     * it is not contained in include list.
-     * Note that if include list contains path, we must not break iterations on that path, hence we
-     * check whether ignore list paths starts with provided path.
+     * Checks whether the crawl crosses into the mount at the path. Pseudo filesystems are never
+     * crawled, remote and FUSE mounts only when allowed, and overlays below the root are views of
+     * directories crawled anyway. Mount is skipped before it is read, so a stalled remote mount
+     * doesn't stall the crawl.
      */
-    [[nodiscard]] constexpr bool check_path(const std::string& path) const noexcept
+    [[nodiscard]] bool check_mount(dir_iter& it, const std::string& path)
     {
-        /* Iterating over /mnt always get stuck for some reason. */
-        if (path.starts_with("/mnt"))
-            return false;
-
-        const auto ignore_pred = [&](const std::string& s) { return path.starts_with(s); };
-        if (std::ranges::find_if(m_ignore_list, ignore_pred) == m_ignore_list.end())
+        const Mount_table::Mount* mount = m_mounts.size() != 0 ? m_mounts.mount_at(path) : nullptr;
+        if (mount == nullptr || !skipped_mount(*mount))
             return true;
 
-        const auto include_pred = [&](const std::string& s) {
-            return s.size() >= path.size() ? s.starts_with(path) : path.starts_with(s);
-        };
+        if (!m_background)
+            std::cout << std::format("Skipping mount: {} ({})\n", path, mount->m_type);
 
-        return std::ranges::find_if(m_include_list, include_pred) != m_include_list.end();
+        it.disable_recursion_pending();
+        ++m_skipped_mounts;
+        return false;
     }
 
-    [[nodiscard]] bool check_iteration(dir_iter& it, std::error_code& ec) const noexcept
+    [[nodiscard]] bool skipped_mount(const Mount_table::Mount& mount) const noexcept
+    {
+        using Kind = Mount_table::Kind;
+        return mount.m_kind == Kind::pseudo || mount.m_kind == Kind::overlay ||
+               ((mount.m_kind == Kind::remote || mount.m_kind == Kind::fuse) &&
+                !m_remote_mounts) ||
+               (m_one_file_system && mount.m_device != m_root_device);
+    }
+
+    /**
+     * Checks the entry against ignore files of its parent directories. Ignored directory is pruned
+     * before it is read, and directory that is entered pushes its own ignore files.
+     */
+    [[nodiscard]] bool check_ignore_files(dir_iter& it, const std::string& path)
+    {
+        const auto depth = i64(it.depth());
+        m_gitignore.leave(depth);
+
+        const bool is_dir = it->is_directory();
+        if (m_gitignore.ignored(path, is_dir)) {
+            if (is_dir) {
+                it.disable_recursion_pending();
+                ++m_ignored_dirs;
+            }
+            else {
+                ++m_ignored_files;
+            }
+
+            return false;
+        }
+
+        if (is_dir)
+            m_gitignore.enter(path, depth);
+
+        return true;
+    }
+
+    [[nodiscard]] bool check_iteration(dir_iter& it, std::error_code& ec) noexcept
     {
         try {
             fs::path path_copy = it->path();
@@ -250,17 +699,40 @@ private:
                 return false;
             }
 
-            if (!check_path(path)) {
-                std::cout << std::format("Skipping: {}\n", path);
+            // Ignored directory is still entered if some included path is inside of it.
+            const Path_rules::Verdict verdict = m_path_rules.check(path);
+            if (!verdict.m_recurse) {
+                if (!m_background)
+                    std::cout << std::format("Skipping: {}\n", path);
+
                 it.disable_recursion_pending();
                 return false;
             }
 
-            if (it->is_directory() && it.depth() == 0)
+            if (!verdict.m_index)
+                return false;
+
+            if (!check_mount(it, path))
+                return false;
+
+            if (m_gitignore_enabled && !check_ignore_files(it, path))
+                return false;
+
+            if (it->is_directory() && it.depth() == 0 && !m_background)
                 std::cout << std::format("Scanning: {}\n", path);
 
+            // Scheduled directory is indexed here, but crawled in its own turn. So is indexed
+            // directory while changed ones are read again, since it is read only if it changed.
+            if (it->is_directory() && (m_crawl_queue.scheduled(path) ||
+                                       (m_rescanning && m_dir_mtimes.contains(path))))
+                it.disable_recursion_pending();
+
             if (!it->is_regular_file() && !it->is_directory())
                 return false;
+
+            if (m_rescan_enabled && it.recursion_pending() && it->is_directory() &&
+                !it->is_symlink())
+                record_dir(path);
         }
         catch (const std::filesystem::filesystem_error& err) {
             if (m_verbose)
@@ -281,13 +753,39 @@ private:
 private: // NOLINT
     Files m_files;
     Symbols m_symbols;
+    std::vector<File_id> m_erased_files; // Erased since the last publish, their symbols not yet.
     fs::path m_root;
-    std::vector<std::string> m_ignore_list;
-    std::vector<std::string> m_include_list;
+    Path_rules m_path_rules; // Ignore and include lists.
+    Crawl_queue m_crawl_queue;
+    Mount_table m_mounts = Mount_table::read();
+    bool m_remote_mounts;
+    bool m_one_file_system;
+    u64 m_root_device = 0; // Device of the mount that contains the root.
+    usize m_skipped_mounts = 0;
+    bool m_gitignore_enabled;
+    Gitignore m_gitignore; // Frames of the crawled directory and its parents.
+    usize m_ignored_dirs = 0;
+    usize m_ignored_files = 0;
     bool m_files_allowed;
     bool m_symbols_allowed;
     bool m_stat_only;
     bool m_verbose;
+    bool m_perf_enabled;
+    Perf_stats m_perf;
+
+    // Background crawl, its stop request and progress.
+    bool m_background;
+    mutable TTracySharedLockableN(std::shared_mutex, m_files_mutex, "Files");
+    std::atomic<bool> m_crawling = false;
+    std::atomic<bool> m_stop = false;
+    std::atomic<usize> m_crawled = 0;
+    std::thread m_crawler;
+
+    // Directory mtimes as of their last read, touched only by the crawl and rescans.
+    bool m_rescan_enabled = false;
+    bool m_rescanning = false;
+    std::map<std::string, i64> m_dir_mtimes;
+    std::optional<Rescan_stats> m_last_rescan;
 };
 
 #endif // FINDER_HPP
@@ -0,0 +1,103 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_FUZZY_HPP
+#define FINDER_FUZZY_HPP
+
+#include <array>
+#include <cassert>
+#include <string_view>
+
+#include "types.hpp"
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+
+/**
+ * Approximate substring matching with Myers' bit-parallel algorithm.
+ * Finds the smallest edit distance (insertions, deletions and substitutions) between the pattern
+ * and any substring of the text. Each column of the dynamic programming matrix is kept as bit
+ * vectors of vertical deltas, so one text character costs a handful of word operations for
+ * patterns of up to 64 bytes.
+ */
+class Fuzzy_pattern {
+public:
+    static constexpr usize max_size = 64;
+
+    struct Result {
+        usize m_distance;
+        usize m_end; // One past the last byte of the best matching substring.
+    };
+
+    explicit Fuzzy_pattern(std::string_view pattern) noexcept : m_size{pattern.size()}
+    {
+        assert(!pattern.empty() && pattern.size() <= max_size);
+
+        for (usize i = 0; i < pattern.size(); ++i)
+            m_peq[static_cast<u8>(pattern[i])] |= u64(1) << i;
+    }
+
+    [[nodiscard]] usize size() const noexcept { return m_size; }
+
+    /**
+     * Best match of the pattern in the text. Search stops at the first exact match.
+     */
+    [[nodiscard]] Result search(std::string_view text) const noexcept
+    {
+        const u64 high = u64(1) << (m_size - 1);
+
+        u64 pv = ~u64(0);
+        u64 mv = 0;
+        usize score = m_size;
+        Result best{.m_distance = m_size, .m_end = 0};
+
+        for (usize i = 0; i < text.size(); ++i) {
+            const u64 eq = m_peq[static_cast<u8>(text[i])];
+            const u64 xv = eq | mv;
+            const u64 xh = (((eq & pv) + pv) ^ pv) | eq;
+
+            u64 ph = mv | ~(xh | pv);
+            u64 mh = pv & xh;
+
+            if ((ph & high) != 0)
+                ++score;
+            else if ((mh & high) != 0)
+                --score;
+
+            // Matches can start anywhere in the text, so the top row stays 0 (nothing shifted in).
+            ph <<= 1U;
+            mh <<= 1U;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+
+            if (score < best.m_distance) {
+                best = Result{.m_distance = score, .m_end = i + 1};
+                if (score == 0)
+                    break;
+            }
+        }
+
+        return best;
+    }
+
+private:
+    std::array<u64, 256> m_peq{}; // Bit i is set for every byte equal to pattern[i].
+    usize m_size;
+};
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
+
+#endif // FINDER_FUZZY_HPP
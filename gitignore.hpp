@@ -0,0 +1,326 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_GITIGNORE_HPP
+#define FINDER_GITIGNORE_HPP
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "os.hpp"
+#include "types.hpp"
+#include "util.hpp"
+
+/**
+ * Glob of a gitignore pattern: * and ? don't match /, ** matches any number of directories, and
+ * [a-z] (or [!a-z]) matches a character class. Common shapes (plain names, *.ext and name*) are
+ * compiled into string compares, and only the rest are matched by the memoized matcher, which is
+ * quadratic at worst instead of exponential.
+ */
+class Glob {
+public:
+    explicit Glob(std::string pattern) : m_pattern{std::move(pattern)}
+    {
+        const auto special = [](std::string_view text) {
+            return text.find_first_of("*?[\\") != std::string_view::npos;
+        };
+
+        const std::string_view text = m_pattern;
+        if (!special(text))
+            m_kind = Kind::literal;
+        else if (text.starts_with('*') && !special(text.substr(1)))
+            m_kind = Kind::suffix;
+        else if (text.ends_with('*') && !special(text.substr(0, text.size() - 1)))
+            m_kind = Kind::prefix;
+    }
+
+    [[nodiscard]] bool match(std::string_view text) const
+    {
+        const std::string_view pattern = m_pattern;
+        switch (m_kind) {
+        case Kind::literal:
+            return text == pattern;
+        case Kind::suffix:
+            return text.ends_with(pattern.substr(1)) &&
+                   text.substr(0, text.size() - (pattern.size() - 1)).find('/') ==
+                       std::string_view::npos;
+        case Kind::prefix:
+            return text.starts_with(pattern.substr(0, pattern.size() - 1)) &&
+                   text.find('/', pattern.size() - 1) == std::string_view::npos;
+        case Kind::generic:
+            break;
+        }
+
+        std::vector<i8> memo((pattern.size() + 1) * (text.size() + 1), -1);
+        return match(text, 0, 0, memo);
+    }
+
+private:
+    enum class Kind : u8 { literal, suffix, prefix, generic };
+
+    bool match(std::string_view text, usize p, usize t, std::vector<i8>& memo) const
+    {
+        const std::string_view pattern = m_pattern;
+        i8& result = memo[(p * (text.size() + 1)) + t];
+        if (result >= 0)
+            return result != 0;
+
+        const auto done = [&](bool matched) {
+            result = matched ? 1 : 0;
+            return matched;
+        };
+
+        if (p == pattern.size())
+            return done(t == text.size());
+
+        if (pattern.substr(p).starts_with("**")) {
+            // **/ matches no directories, or any path ending with a separator.
+            if (pattern.substr(p).starts_with("**/")) {
+                if (match(text, p + 3, t, memo))
+                    return done(true);
+
+                for (usize i = t; i < text.size(); ++i) {
+                    if (text[i] == '/' && match(text, p + 3, i + 1, memo))
+                        return done(true);
+                }
+
+                return done(false);
+            }
+
+            for (usize i = t; i <= text.size(); ++i) {
+                if (match(text, p + 2, i, memo))
+                    return done(true);
+            }
+
+            return done(false);
+        }
+
+        if (pattern[p] == '*') {
+            for (usize i = t; i <= text.size(); ++i) {
+                if (match(text, p + 1, i, memo))
+                    return done(true);
+
+                if (i < text.size() && text[i] == '/')
+                    break;
+            }
+
+            return done(false);
+        }
+
+        if (t == text.size())
+            return done(false);
+
+        if (pattern[p] == '?')
+            return done(text[t] != '/' && match(text, p + 1, t + 1, memo));
+
+        if (pattern[p] == '[') {
+            usize end = 0;
+            const bool in_class = match_class(text[t], p, end);
+            if (end != 0)
+                return done(in_class && match(text, end, t + 1, memo));
+        }
+
+        // Literal character, possibly escaped, and [ without closing ].
+        if (pattern[p] == '\\' && p + 1 < pattern.size())
+            ++p;
+
+        return done(pattern[p] == text[t] && match(text, p + 1, t + 1, memo));
+    }
+
+    /**
+     * Matches character against the class starting at pattern[p]. End is set past the closing ],
+     * or to 0 if class is not closed.
+     */
+    bool match_class(char c, usize p, usize& end) const noexcept
+    {
+        const std::string_view pattern = m_pattern;
+        usize i = p + 1;
+        const bool negated = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+        i += negated ? 1 : 0;
+
+        bool found = false;
+        for (bool first = true; i < pattern.size(); first = false) {
+            if (pattern[i] == ']' && !first) {
+                end = i + 1;
+                return c != '/' && found != negated;
+            }
+
+            const char lo = pattern[i];
+            if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+                found = found || (lo <= c && c <= pattern[i + 2]);
+                i += 3;
+            }
+            else {
+                found = found || lo == c;
+                ++i;
+            }
+        }
+
+        end = 0;
+        return false;
+    }
+
+    std::string m_pattern;
+    Kind m_kind = Kind::generic;
+};
+
+/**
+ * Stack of ignore files (.gitignore and .ignore) of the directories on the crawled path. Every
+ * directory that has ignore files pushes a frame of compiled rules when it is entered, and the
+ * frame is popped when the crawl leaves it. Ignored directories are pruned before they are read.
+ *
+ * Rules follow gitignore: the last matching rule of the innermost frame with a match decides, !
+ * negates, trailing / matches only directories, and patterns with a / (other than a trailing one)
+ * are matched against the path relative to the directory of the ignore file, others against the
+ * name. .git directories are always ignored.
+ */
+class Gitignore {
+public:
+    struct Rule {
+        Glob m_glob;
+        bool m_negated = false;
+        bool m_dir_only = false;
+        bool m_anchored = false; // Matched against the relative path, not the name.
+    };
+
+    /**
+     * Parses ignore file text into rules. Blank lines and # comments are skipped.
+     */
+    static std::vector<Rule> parse(std::string_view text)
+    {
+        std::vector<Rule> rules;
+        for (const std::string& raw_line : string_split(std::string{text}, "\n")) {
+            std::string line = raw_line;
+            if (line.ends_with('\r'))
+                line.pop_back();
+
+            // Trailing spaces are ignored, unless escaped.
+            while (line.ends_with(' ') && !line.ends_with("\\ "))
+                line.pop_back();
+
+            if (line.empty() || line.starts_with('#'))
+                continue;
+
+            Rule rule{.m_glob = Glob{""}};
+            if (line.starts_with('!')) {
+                rule.m_negated = true;
+                line.erase(0, 1);
+            }
+            else if (line.starts_with("\\#") || line.starts_with("\\!")) {
+                line.erase(0, 1);
+            }
+
+            if (line.ends_with('/')) {
+                rule.m_dir_only = true;
+                line.pop_back();
+            }
+
+            rule.m_anchored = line.find('/') != std::string::npos;
+            if (line.starts_with('/'))
+                line.erase(0, 1);
+
+            if (line.empty())
+                continue;
+
+            rule.m_glob = Glob{std::move(line)};
+            rules.push_back(std::move(rule));
+        }
+
+        return rules;
+    }
+
+    /**
+     * Reads ignore files of the directory at the crawl depth, and pushes their rules if any.
+     * Frames of directories at the same or greater depth are popped first.
+     */
+    void enter(std::string dir, i64 depth)
+    {
+        leave(depth);
+
+        while (dir.ends_with(os::path_sep))
+            dir.pop_back();
+
+        std::vector<Rule> rules;
+        for (const char* file : {".gitignore", ".ignore"}) {
+            std::vector<Rule> file_rules =
+                parse(file_to_string(dir + os::path_sep_str + file));
+            rules.insert(rules.end(), std::make_move_iterator(file_rules.begin()),
+                         std::make_move_iterator(file_rules.end()));
+        }
+
+        if (!rules.empty())
+            m_frames.push_back(
+                Frame{.m_dir = std::move(dir), .m_depth = depth, .m_rules = std::move(rules)});
+    }
+
+    /**
+     * Pops frames of directories at the depth or deeper, which the crawl left.
+     */
+    void leave(i64 depth)
+    {
+        while (!m_frames.empty() && m_frames.back().m_depth >= depth)
+            m_frames.pop_back();
+    }
+
+    /**
+     * Whether the entry is ignored by the frames on the stack, which must belong to its parent
+     * directories.
+     */
+    [[nodiscard]] bool ignored(std::string_view path, bool is_dir) const
+    {
+        const usize sep = path.find_last_of(os::path_sep);
+        const std::string_view name = sep == std::string_view::npos ? path : path.substr(sep + 1);
+        if (is_dir && name == ".git")
+            return true;
+
+        for (auto frame = m_frames.rbegin(); frame != m_frames.rend(); ++frame) {
+            if (!path.starts_with(frame->m_dir) || path.size() <= frame->m_dir.size() + 1)
+                continue;
+
+            // Frame directories are parents, so the path continues with a separator.
+
+            std::string relative{path.substr(frame->m_dir.size() + 1)};
+            if constexpr (os::path_sep != '/')
+                std::ranges::replace(relative, os::path_sep, '/');
+
+            for (auto rule = frame->m_rules.rbegin(); rule != frame->m_rules.rend(); ++rule) {
+                if (rule->m_dir_only && !is_dir)
+                    continue;
+
+                if (rule->m_glob.match(rule->m_anchored ? std::string_view{relative} : name))
+                    return !rule->m_negated;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    struct Frame {
+        std::string m_dir; // Directory of the ignore files, without trailing separator.
+        i64 m_depth = 0;   // Crawl depth of the directory, -1 for the root.
+        std::vector<Rule> m_rules;
+    };
+
+    std::vector<Frame> m_frames;
+};
+
+#endif // FINDER_GITIGNORE_HPP
@@ -0,0 +1,66 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_ID_HPP
+#define FINDER_ID_HPP
+
+#include <cassert>
+#include <compare>
+#include <limits>
+
+#include "types.hpp"
+
+/**
+ * Strongly typed 32 bit index into a dense table.
+ * Tag makes ids of different tables different types, so file id can't be used to index
+ * directories by accident. We have less than 4 billion files, and 32 bit ids halve the size of
+ * every structure that references files, compared to pointers or usize guids.
+ */
+template<class Tag>
+class Id {
+public:
+    static constexpr u32 invalid_value = std::numeric_limits<u32>::max();
+
+    constexpr Id() noexcept = default;
+
+    constexpr explicit Id(u32 value) noexcept : m_value{value} {}
+
+    /**
+     * Creates id from a table index. Index must fit into 32 bits.
+     */
+    static constexpr Id from_index(usize index) noexcept
+    {
+        assert(index < invalid_value);
+        return Id{static_cast<u32>(index)};
+    }
+
+    [[nodiscard]] constexpr u32 value() const noexcept { return m_value; }
+
+    [[nodiscard]] constexpr usize index() const noexcept { return m_value; }
+
+    [[nodiscard]] constexpr bool valid() const noexcept { return m_value != invalid_value; }
+
+    constexpr auto operator<=>(const Id&) const noexcept = default;
+
+private:
+    u32 m_value = invalid_value;
+};
+
+using File_id = Id<struct File_tag>;
+using Dir_id = Id<struct Dir_tag>;
+
+#endif // FINDER_ID_HPP
@@ -0,0 +1,374 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_INSTRUMENTATION_HPP
+#define FINDER_INSTRUMENTATION_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perf.hpp"
+#include "types.hpp"
+#include "util.hpp"
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+
+/**
+ * HDR style histogram with log-linear buckets.
+ * Every power of two range is split into sub_bucket_count linear buckets, so relative error of
+ * every recorded value is bounded by 1 / sub_bucket_count (~3%), regardless of value magnitude.
+ * Recording is a bit scan and an increment, so it is cheap enough to be called on every keystroke
+ * for every stage.
+ */
+class Histogram {
+public:
+    static constexpr u32 sub_bucket_bits = 5U;
+    static constexpr u32 sub_bucket_count = 1U << sub_bucket_bits;
+    static constexpr u32 bucket_count = (64U - sub_bucket_bits + 1U) * sub_bucket_count;
+
+    void record(u64 value) noexcept
+    {
+        ++m_buckets[bucket_index(value)];
+        ++m_count;
+        m_sum += value;
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+    }
+
+    /**
+     * Returns value at provided percentile (0 - 100). Returned value is the highest value that is
+     * equivalent to the bucket that holds requested percentile, limited with max recorded value.
+     */
+    [[nodiscard]] u64 percentile(f64 p) const noexcept
+    {
+        if (m_count == 0)
+            return 0;
+
+        p = std::clamp(p, 0.0, 100.0);
+        u64 target = std::max(u64(1), static_cast<u64>(p / 100.0 * f64(m_count) + 0.5));
+
+        u64 seen = 0;
+        for (u32 i = 0; i < bucket_count; ++i) {
+            seen += m_buckets[i];
+            if (seen >= target)
+                return std::min(bucket_upper(i), m_max);
+        }
+
+        return m_max;
+    }
+
+    void merge(const Histogram& other) noexcept
+    {
+        for (u32 i = 0; i < bucket_count; ++i)
+            m_buckets[i] += other.m_buckets[i];
+
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    void clear() noexcept { *this = Histogram{}; }
+
+    [[nodiscard]] u64 count() const noexcept { return m_count; }
+
+    [[nodiscard]] u64 min() const noexcept { return m_count == 0 ? 0 : m_min; }
+
+    [[nodiscard]] u64 max() const noexcept { return m_max; }
+
+    [[nodiscard]] f64 mean() const noexcept
+    {
+        return m_count == 0 ? 0.0 : f64(m_sum) / f64(m_count);
+    }
+
+private:
+    static constexpr u32 bucket_index(u64 value) noexcept
+    {
+        if (value < sub_bucket_count)
+            return static_cast<u32>(value);
+
+        u32 shift = static_cast<u32>(std::bit_width(value)) - 1 - sub_bucket_bits;
+        u32 sub = static_cast<u32>(value >> shift) - sub_bucket_count;
+        return (shift + 1) * sub_bucket_count + sub;
+    }
+
+    static constexpr u64 bucket_upper(u32 index) noexcept
+    {
+        if (index < sub_bucket_count)
+            return index;
+
+        u32 shift = index / sub_bucket_count - 1;
+        u64 sub = index % sub_bucket_count + sub_bucket_count;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::array<u64, bucket_count> m_buckets{};
+    u64 m_count = 0;
+    u64 m_sum = 0;
+    u64 m_min = std::numeric_limits<u64>::max();
+    u64 m_max = 0;
+};
+
+/**
+ * Stages of a single keystroke, from query parsing to the terminal flush.
+ */
+enum class Stage : u8 { query_parse, dispatch, scan, merge, render, flush, count };
+
+/**
+ * Search counters, accumulated over the whole session.
+ */
+enum class Counter : u8 { files_scanned, prefilter_rejects, matches, count };
+
+static constexpr usize stages_count = static_cast<usize>(Stage::count);
+static constexpr usize counters_count = static_cast<usize>(Counter::count);
+
+static constexpr std::string_view stage_name(Stage stage)
+{
+    constexpr std::array<std::string_view, stages_count> names{"query_parse", "dispatch", "scan",
+                                                               "merge",       "render",   "flush"};
+    return names[static_cast<usize>(stage)];
+}
+
+static constexpr std::string_view counter_name(Counter counter)
+{
+    constexpr std::array<std::string_view, counters_count> names{"files_scanned",
+                                                                 "prefilter_rejects", "matches"};
+    return names[static_cast<usize>(counter)];
+}
+
+/**
+ * Access path chosen by the query planner for one search, with its estimated and actual cost.
+ */
+struct Plan_record {
+    std::string m_access;
+    u64 m_estimated_files = 0;
+    u64 m_files = 0;
+    u64 m_estimated_ns = 0;
+    u64 m_ns = 0;
+    u64 m_count = 0; // Number of searches, when records are summed per access path.
+};
+
+/**
+ * Per keystroke instrumentation. Holds latency histograms for every stage and for the whole
+ * keystroke (input to flushed output), and session counters.
+ * All durations are recorded in nanoseconds and reported in microseconds.
+ *
+ * Instrumentation is not thread safe. Search tasks report their numbers through Matches, and only
+ * the main loop records them.
+ */
+class Instrumentation {
+public:
+    void record(Stage stage, nanoseconds time) noexcept
+    {
+        u64 ns = static_cast<u64>(time.count());
+        m_stages[static_cast<usize>(stage)].record(ns);
+        m_last[static_cast<usize>(stage)] = ns;
+    }
+
+    void record_keystroke(nanoseconds time) noexcept
+    {
+        m_keystroke.record(static_cast<u64>(time.count()));
+    }
+
+    void add(Counter counter, u64 value) noexcept
+    {
+        m_counters[static_cast<usize>(counter)] += value;
+        m_last_counters[static_cast<usize>(counter)] = value;
+    }
+
+    /**
+     * Records the plan of a search. Totals are kept per access path, so the report shows how often
+     * every path was chosen and how close its estimates were.
+     */
+    void record_plan(const Plan_record& plan)
+    {
+        auto it = std::ranges::find(m_plans, plan.m_access, &Plan_record::m_access);
+        if (it == m_plans.end())
+            it = m_plans.insert(m_plans.end(), Plan_record{.m_access = plan.m_access});
+
+        it->m_estimated_files += plan.m_estimated_files;
+        it->m_files += plan.m_files;
+        it->m_estimated_ns += plan.m_estimated_ns;
+        it->m_ns += plan.m_ns;
+        it->m_count += 1;
+
+        m_last_plan = plan;
+    }
+
+    [[nodiscard]] const std::vector<Plan_record>& plans() const noexcept { return m_plans; }
+
+    [[nodiscard]] const Histogram& histogram(Stage stage) const noexcept
+    {
+        return m_stages[static_cast<usize>(stage)];
+    }
+
+    [[nodiscard]] const Histogram& keystroke() const noexcept { return m_keystroke; }
+
+    [[nodiscard]] u64 counter(Counter counter) const noexcept
+    {
+        return m_counters[static_cast<usize>(counter)];
+    }
+
+    /**
+     * Attaches hardware counters stats which will be included in JSON report.
+     */
+    void attach(const Perf_stats* perf) noexcept { m_perf = perf; }
+
+    void toggle_status_line() noexcept { m_status_line = !m_status_line; }
+
+    [[nodiscard]] bool status_line_enabled() const noexcept { return m_status_line; }
+
+    /**
+     * One line summary for the console. Shows keystroke percentiles, and stages and counters of the
+     * last keystroke.
+     */
+    [[nodiscard]] std::string status_line() const
+    {
+        std::string line = std::format("keystroke p50: {:.2f}ms p99: {:.2f}ms |",
+                                       to_ms(m_keystroke.percentile(50)),
+                                       to_ms(m_keystroke.percentile(99)));
+
+        for (usize i = 0; i < stages_count; ++i)
+            line += std::format(" {}: {:.2f}ms", stage_name(Stage(i)), to_ms(m_last[i]));
+
+        line += std::format(" | scanned: {}, rejected: {}, matches: {}",
+                            last(Counter::files_scanned), last(Counter::prefilter_rejects),
+                            last(Counter::matches));
+
+        if (!m_last_plan.m_access.empty())
+            line += std::format(" | plan: {} est {} files {:.2f}ms, actual {} files {:.2f}ms",
+                                m_last_plan.m_access, m_last_plan.m_estimated_files,
+                                to_ms(m_last_plan.m_estimated_ns), m_last_plan.m_files,
+                                to_ms(m_last_plan.m_ns));
+        return line;
+    }
+
+    [[nodiscard]] std::string to_json() const
+    {
+        std::string json = "{\n";
+        json += std::format("  \"keystroke\": {},\n", histogram_json(m_keystroke));
+
+        json += "  \"stages\": {\n";
+        for (usize i = 0; i < stages_count; ++i)
+            json += std::format("    \"{}\": {}{}\n", stage_name(Stage(i)),
+                                histogram_json(m_stages[i]), i + 1 < stages_count ? "," : "");
+        json += "  },\n";
+
+        json += "  \"counters\": {\n";
+        for (usize i = 0; i < counters_count; ++i)
+            json += std::format("    \"{}\": {}{}\n", counter_name(Counter(i)), m_counters[i],
+                                i + 1 < counters_count ? "," : "");
+        json += "  },\n";
+
+        json += "  \"plans\": {\n";
+        for (usize i = 0; i < m_plans.size(); ++i) {
+            const Plan_record& p = m_plans[i];
+            json += std::format("    \"{}\": {{\"count\": {}, \"estimated_files\": {}, "
+                                "\"files\": {}, \"estimated_us\": {:.3f}, \"us\": {:.3f}}}{}\n",
+                                p.m_access, p.m_count, p.m_estimated_files, p.m_files,
+                                to_us(p.m_estimated_ns), to_us(p.m_ns),
+                                i + 1 < m_plans.size() ? "," : "");
+        }
+        json += m_perf != nullptr ? "  },\n" : "  }\n";
+
+        if (m_perf != nullptr)
+            json += std::format("  \"perf\": {}\n", m_perf->to_json());
+
+        json += "}\n";
+        return json;
+    }
+
+    /**
+     * Writes JSON report into the provided file. Returns false if file could not be written.
+     */
+    bool dump_json(const std::string& path) const
+    {
+        std::ofstream out{path, std::ios_base::trunc};
+        if (!out.is_open())
+            return false;
+
+        out << to_json();
+        return out.good();
+    }
+
+private:
+    [[nodiscard]] u64 last(Counter counter) const noexcept
+    {
+        return m_last_counters[static_cast<usize>(counter)];
+    }
+
+    static f64 to_ms(u64 ns) noexcept { return f64(ns) / 1'000'000.0; }
+
+    static f64 to_us(u64 ns) noexcept { return f64(ns) / 1'000.0; }
+
+    static std::string histogram_json(const Histogram& h)
+    {
+        return std::format("{{\"count\": {}, \"min_us\": {:.3f}, \"mean_us\": {:.3f}, "
+                           "\"p50_us\": {:.3f}, \"p90_us\": {:.3f}, \"p99_us\": {:.3f}, "
+                           "\"p999_us\": {:.3f}, \"max_us\": {:.3f}}}",
+                           h.count(), to_us(h.min()), h.mean() / 1'000.0, to_us(h.percentile(50)),
+                           to_us(h.percentile(90)), to_us(h.percentile(99)),
+                           to_us(h.percentile(99.9)), to_us(h.max()));
+    }
+
+    std::array<Histogram, stages_count> m_stages{};
+    std::array<u64, stages_count> m_last{}; // Last recorded value per stage, for the status line.
+    std::array<u64, counters_count> m_counters{};
+    std::array<u64, counters_count> m_last_counters{};
+    Histogram m_keystroke;
+    std::vector<Plan_record> m_plans; // Totals per access path.
+    Plan_record m_last_plan;
+    const Perf_stats* m_perf = nullptr;
+    bool m_status_line = false;
+};
+
+/**
+ * Records elapsed time of a scope into the provided stage. Similar to Stopwatch, just put it at
+ * the beginning of the scope that should be measured.
+ */
+class Stage_timer {
+public:
+    Stage_timer(Instrumentation& instr, Stage stage) noexcept
+        : m_instr{instr}
+        , m_stage{stage}
+        , m_start{now()}
+    {
+    }
+
+    ~Stage_timer() noexcept { m_instr.record(m_stage, now() - m_start); }
+
+    Stage_timer(const Stage_timer&) = delete;
+    Stage_timer& operator=(const Stage_timer&) = delete;
+    Stage_timer(Stage_timer&&) = delete;
+    Stage_timer& operator=(Stage_timer&&) = delete;
+
+private:
+    Instrumentation& m_instr;
+    Stage m_stage;
+    Time_point m_start;
+};
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
+
+#endif // FINDER_INSTRUMENTATION_HPP
@@ -13,19 +13,29 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
 #include <cctype>
 #include <chrono>
+#include <filesystem>
+#include <iterator>
 #include <memory>
+#include <optional>
+#include <shared_mutex>
 #include <string>
 #include <thread>
 #include <variant>
+#include <vector>
 
+#include "access_log.hpp"
 #include "cli11/CLI11.hpp"
 #include "console.hpp"
 #include "files.hpp"
 #include "finder.hpp"
+#include "instrumentation.hpp"
 #include "os.hpp"
+#include "perf.hpp"
 #include "query.hpp"
+#include "session.hpp"
 #include "ums/async.hpp"
 #include "ums/options.hpp"
 #include "ums/scheduler.hpp"
@@ -35,15 +45,64 @@
 // NOLINTBEGIN(misc-use-anonymous-namespace, readability-implicit-bool-conversion,
 // readability-function-cognitive-complexity)
 
-enum class Command { normal, consol_resize, exit }; // NOLINT
+enum class Command { normal, refresh, consol_resize, redraw, rescan, exit }; // NOLINT
 
-static Command handle_command(Console& console, Query& query, const Files::Matches& results)
+// While files are crawled, input waits time out this often, and results are refreshed.
+static constexpr milliseconds crawl_refresh = 250ms;
+
+static Command handle_command(Console& console, Query& query, const Files::Matches& results,
+                              u64 results_erasures, Instrumentation& instr, Files& files,
+                              Access_log* access_log,
+                              std::shared_lock<Finder::Files_mutex>& files_lock, bool crawling,
+                              std::optional<os::ConsoleInput>& pending)
 {
     os::ConsoleInput input;
     i32 input_ch = 0;
 
+    // Copied files are the ones user will want again, so they are ranked first from now on.
+    const auto record_pick = [&] {
+        if (access_log == nullptr)
+            return;
+
+        const Files::Match_view pick = console.pick_result(results);
+        const File_id id = pick.id();
+        const f32 boost = f32(access_log->record(pick.full_path(), unix_time()));
+
+        // Boosts are read by searches, so they are written under the exclusive lock.
+        files_lock.unlock();
+        {
+            std::unique_lock lock{*files_lock.mutex()};
+            files.set_boost(id, boost);
+        }
+        files_lock.lock();
+    };
+
     while (true) {
-        console >> input;
+        if (pending) {
+            // Received before results were refreshed.
+            input = *pending;
+            pending.reset();
+        }
+        else {
+            // Crawl publishes files while input is awaited. Timeout searches them.
+            files_lock.unlock();
+            bool received = true;
+            if (crawling)
+                received = console.read(input, crawl_refresh);
+            else
+                console >> input;
+
+            files_lock.lock();
+            if (!received)
+                return Command::refresh;
+
+            // Rescan erased files meanwhile, so results can refer to other files, or to none.
+            // Input is handled once they are refreshed.
+            if (files.erasures() != results_erasures) {
+                pending = input;
+                return Command::refresh;
+            }
+        }
 
         if (std::holds_alternative<os::Coordinates>(input)) {
             console.resize(std::get<os::Coordinates>(input));
@@ -80,29 +139,48 @@ static Command handle_command(Console& console, Query& query, const Files::Match
                 break;
         }
         else if (os::is_ctrl_f(input_ch)) {
-            if (!results.empty())
+            if (!results.empty()) {
                 console.copy_result_to_clipboard<CopyOpt::file_name>(results);
+                record_pick();
+            }
         }
         else if (os::is_ctrl_i(input_ch)) {
-            if (!results.empty())
+            if (!results.empty()) {
                 console.copy_result_to_clipboard<CopyOpt::file_path>(results);
+                record_pick();
+            }
         }
         else if (os::is_ctrl_y(input_ch)) {
-            if (!results.empty())
+            if (!results.empty()) {
                 console.copy_result_to_clipboard<CopyOpt::full>(results);
+                record_pick();
+            }
         }
         else if (os::is_ctrl_u(input_ch)) {
-            if (!results.empty())
+            if (!results.empty()) {
                 console.copy_result_to_clipboard<CopyOpt::full_quoted>(results);
+                record_pick();
+            }
         }
         else if (os::is_ctrl_d(input_ch)) {
             query.query().clear();
             break;
         }
+        else if (os::is_ctrl_e(input_ch)) {
+            return Command::rescan;
+        }
         else if (os::is_ctrl_g(input_ch)) {
             query.pinned().clear();
             break;
         }
+        else if (os::is_ctrl_t(input_ch)) {
+            instr.toggle_status_line();
+            return Command::redraw;
+        }
+        else if (os::is_ctrl_r(input_ch)) {
+            query.toggle_regex();
+            break;
+        }
         else if (os::is_ctrl_p(input_ch)) {
             if (!results.empty()) {
                 query.pin_path(console.pick_result(results));
@@ -126,58 +204,231 @@ static Command handle_command(Console& console, Query& query, const Files::Match
 
 int finder_main(const Options& opt) // NOLINT
 {
+    std::optional<Session> replay;
+    if (!opt.m_replay.empty())
+        replay = Session::load(opt.m_replay);
+
     Finder finder{opt};
+    Files& files = finder.files();
+    std::shared_lock files_lock{finder.files_mutex()};
+
+    if (replay && (replay->m_files_count != files.files_count() ||
+                   replay->m_generation != files.generation()))
+        std::cerr << std::format("Warning: replaying session recorded on a different index "
+                                 "(files: {} vs {}, generation: {} vs {}).\n",
+                                 replay->m_files_count, files.files_count(), replay->m_generation,
+                                 files.generation());
+
+    // Replay must not depend on (or change) user's picks.
+    std::unique_ptr<Access_log> access_log;
+    bool crawling = finder.crawling();
+
+    // Boosts are read by searches, so they are written under the exclusive lock.
+    const auto apply_access_log = [&] {
+        files_lock.unlock();
+        {
+            std::unique_lock lock{finder.files_mutex()};
+            access_log->apply(files, unix_time());
+        }
+        files_lock.lock();
+    };
+
+    if (!replay && !opt.m_access_log.empty()) {
+        try {
+            access_log = std::make_unique<Access_log>(opt.m_access_log);
+            if (!crawling)
+                apply_access_log();
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << std::format("Warning: {} Picks are not ranked.\n", e.what());
+        }
+    }
 
     /* Search results related. */
     Query query;
     Files::Matches results;
+    u64 results_erasures = 0; // Erasures of files when results were taken.
     milliseconds time = 0ms;
     usize objects_count = 0;
 
     /* Console related. */
-    Console console;
+    Console console = replay ? Console{*replay, opt.m_replay_realtime} : Console{};
+
+    std::unique_ptr<Session_recorder> recorder;
+    if (!opt.m_record.empty()) {
+        recorder = std::make_unique<Session_recorder>(opt.m_record, finder.dir().string(),
+                                                      files.files_count(), files.generation(),
+                                                      console.size());
+        console.set_recorder(recorder.get());
+    }
 
     /* Tasks related. */
     u32 cpus_count = ums::schedulers->cpus_count();
     u32 workers_count = ums::schedulers->workers_count();
     u32 task_id = 0;
-    u32 tasks_count = opt.tasks_count();
+    u32 tasks_count = opt.m_tasks_count;
     std::vector<ums::Task<Files::Matches>> tasks;
     tasks.reserve(tasks_count);
 
+    /* Instrumentation related. */
+    Instrumentation instr;
+    bool keystroke = false; // First search is not triggered by a keystroke.
+
+    // Searches repeated while crawling are not triggered by the user either. They run against a
+    // growing index, so their numbers go to a scratch instrumentation, which is never reported.
+    Instrumentation refresh_instr;
+    bool refresh = false;
+    std::optional<os::ConsoleInput> pending; // Input awaiting refreshed results.
+
+    Perf_stats* perf = finder.perf_stats();
+    instr.attach(perf);
+
+    const auto status_line = [&] {
+        std::string status = instr.status_line_enabled() ? instr.status_line() : std::string{};
+        if (crawling)
+            status = std::format("Indexing: {} files{}{}", finder.crawled(),
+                                 status.empty() ? "" : " | ", status);
+        else if (const auto& rescan = finder.last_rescan(); rescan)
+            status = std::format("Rescanned: {} of {} directories changed{}{}", rescan->m_changed,
+                                 rescan->m_dirs, status.empty() ? "" : " | ", status);
+
+        return status;
+    };
+
     while (true) {
+        const Time_point keystroke_start = now();
+        Instrumentation& search_instr = refresh ? refresh_instr : instr;
+        Perf_stats* search_perf = refresh ? nullptr : perf;
+
+        // Picks of files crawled in background are ranked once all of them are indexed.
+        if (crawling && !finder.crawling()) {
+            crawling = false;
+            if (access_log)
+                apply_access_log();
+        }
+
         results.clear();
+        results_erasures = files.erasures();
         tasks.clear();
 
         {
             Stopwatch<false, milliseconds> sw;
 
-            for (task_id = 0; task_id < tasks_count; ++task_id) {
-                tasks.emplace_back(ums::async([&, tasks_count, task_id] {
-                    return finder.find_files_partial(query.full(), tasks_count, task_id);
-                }));
+            Files::Pattern pattern;
+            {
+                Stage_timer st{search_instr, Stage::query_parse};
+                pattern = query.regex() ? files.compile_regex(query.query(), query.pinned()) :
+                                          files.compile(query.terms());
             }
 
-            for (auto& task : tasks) {
-                const Files::Matches matches = task->get();
-                results.insert(matches);
+            nanoseconds merge_time = 0ns;
+            const auto search = [&](const Files::Pattern& p) {
+                {
+                    Stage_timer st{search_instr, Stage::dispatch};
+                    for (task_id = 0; task_id < tasks_count; ++task_id) {
+                        tasks.emplace_back(ums::async([&, tasks_count, task_id] {
+                            Perf_scope ps{search_perf, "partial_search"};
+                            return finder.find_files_partial(p, tasks_count, task_id);
+                        }));
+                    }
+                }
+
+                for ([[maybe_unused]] usize pending = tasks.size(); auto& task : tasks) {
+                    TTracyPlot("pending tasks", i64(pending--));
+                    const Files::Matches matches = task->get();
+
+                    const Time_point merge_start = now();
+                    results.insert(matches);
+                    merge_time += now() - merge_start;
+                }
+            };
+
+            const auto record_plan = [&](const Files::Pattern& p) {
+                const Files::Matches::Search_stats& stats = results.stats();
+                search_instr.record_plan(
+                    Plan_record{.m_access = std::string{p.m_plan.name()},
+                                .m_estimated_files = p.m_plan.m_files,
+                                .m_files = stats.m_scanned,
+                                .m_estimated_ns = u64(p.m_plan.m_cost),
+                                .m_ns = u64(stats.m_work_time.count())});
+            };
+
+            search(pattern);
+            record_plan(pattern);
+
+            // Typo tolerance, when exact search finds almost nothing. Fuzzy results include the
+            // exact ones, so they replace them.
+            if (results.objects_count() < Files::fuzzy_min_results) {
+                if (const auto fuzzy = files.fuzzy(pattern); fuzzy) {
+                    const Files::Matches::Search_stats exact_stats = results.stats();
+                    results.clear();
+                    tasks.clear();
+                    search(*fuzzy);
+                    record_plan(*fuzzy);
+
+                    Files::Matches::Search_stats& stats = results.stats();
+                    stats.m_scanned += exact_stats.m_scanned;
+                    stats.m_rejected += exact_stats.m_rejected;
+                    stats.m_scan_time += exact_stats.m_scan_time; // Passes run one after another.
+                    stats.m_work_time += exact_stats.m_work_time;
+                }
             }
 
             time = sw.elapsed_units();
             objects_count = results.objects_count();
+
+            search_instr.record(Stage::scan, results.stats().m_scan_time);
+            search_instr.record(Stage::merge, merge_time);
+            search_instr.add(Counter::files_scanned, results.stats().m_scanned);
+            search_instr.add(Counter::prefilter_rejects, results.stats().m_rejected);
+            search_instr.add(Counter::matches, objects_count);
         }
 
-        console.render_main(query, cpus_count, workers_count, tasks_count, objects_count, results,
-                            time);
+        {
+            Stage_timer st{search_instr, Stage::render};
+            console.render_main(query, cpus_count, workers_count, tasks_count, objects_count,
+                                results, time, status_line());
+        }
+
+        {
+            Stage_timer st{search_instr, Stage::flush};
+            console.flush();
+        }
+
+        TFrameMark; // Every keystroke is a frame.
+
+        if (keystroke && !refresh)
+            instr.record_keystroke(now() - keystroke_start);
+
+        keystroke = true;
+        refresh = false;
 
         Command c;
-        while ((c = handle_command(console, query, results)) != Command::normal) {
+        while ((c = handle_command(console, query, results, results_erasures, instr, files,
+                                   access_log.get(), files_lock, crawling, pending)) !=
+               Command::normal) {
+            if (c == Command::refresh) {
+                refresh = true;
+                break;
+            }
+
             switch (c) {
+            case Command::rescan:
+                crawling = finder.rescan() || crawling;
+                [[fallthrough]];
             case Command::consol_resize:
+            case Command::redraw:
                 console.render_main(query, cpus_count, workers_count, tasks_count, objects_count,
-                                    results, time);
+                                    results, time, status_line());
+                console.flush();
                 break; // breaks from switch;
             case Command::exit:
+                if (!opt.m_stats_json.empty() && !instr.dump_json(opt.m_stats_json))
+                    std::cerr << std::format("Failed to write stats into {}.\n", opt.m_stats_json);
+
+                if (replay)
+                    std::cout << instr.to_json();
+
                 return 0;
             default:
                 assert(!"Invalid scan result.");
@@ -202,6 +453,23 @@ int main(int argc, char* argv[])
     u32 wps = 2;
     u32 cpus = std::thread::hardware_concurrency();
     u32 tasks_count = cpus;
+    std::string stats_json;
+    std::string record;
+    std::string replay;
+    bool replay_realtime = false;
+    bool perf = false;
+    bool compress_names = false;
+    bool metadata = false;
+    bool name_index = false;
+    bool gitignore = false;
+    bool remote_mounts = false;
+    bool one_file_system = false;
+    bool rescan = false;
+    std::vector<std::string> hot_dirs;
+    std::vector<std::string> cold_dirs;
+    std::string access_log;
+    if (const std::string home = os::home_dir(); !home.empty())
+        access_log = home + os::path_sep_str + ".finder_access_log";
 
     // clang-format off
     app.add_option("-r,--root",        root,         "Root directory for files/symbols. Default is OS root directory.");
@@ -214,14 +482,70 @@ int main(int argc, char* argv[])
     app.add_option("-w,--workers",     wps,          "Number of workers per scheduler.");
     app.add_option("-c,--cpus",        cpus,         "Number of CPUs to be used. Default is all available CPUs.");
     app.add_option("-t,--tasks-count", tasks_count,  "Number of search tasks. Default is number of CPUs.");
+    app.add_option("-j,--stats-json",  stats_json,   "Writes keystroke latency histograms and counters as JSON into provided file on exit.");
+    app.add_option("--record",         record,       "Records session (index info, terminal size, inputs and their timings) into provided file.");
+    app.add_option("--replay",         replay,       "Replays recorded session headlessly and prints keystroke latency report.");
+    app.add_flag  ("--replay-realtime", replay_realtime, "Respects recorded delays between inputs while replaying. Default is false.");
+    app.add_flag  ("-p,--perf",        perf,         "Collects hardware counters (cycles, IPC, cache and branch misses) per stage. Linux only. Default is false.");
+    app.add_flag  ("--compress-names", compress_names, "Stores file names front coded, which takes less memory but makes search slower. Default is false.");
+    app.add_option("--access-log",     access_log,   "File that keeps picked (copied) files across sessions, so they are ranked first. Empty disables ranking. Default is ~/.finder_access_log.");
+    app.add_flag  ("--metadata",       metadata,     "Stats files while crawling and keeps size, mtime, mode and device, for size>, mtime< and type: query terms. Default is false.");
+    app.add_flag  ("--name-index",     name_index,   "Keeps files sorted by name, so anchored queries (^name) are a binary search instead of a scan. Default is false.");
+    app.add_flag  ("--gitignore",      gitignore,    "Skips files and directories ignored by .gitignore and .ignore files (and .git directories) while crawling. Default is false.");
+    app.add_flag  ("--remote-mounts",  remote_mounts, "Crawls remote (nfs, cifs, ...) and FUSE mounts. Pseudo filesystems (proc, sysfs, ...) are never crawled. Linux only. Default is false.");
+    app.add_flag  ("-x,--one-file-system", one_file_system, "Doesn't crawl mounts of other devices than the root directory's. Linux only. Default is false.");
+    app.add_flag  ("--rescan",         rescan,       "Keeps directory mtimes, so ctrl + e rescan reads again only directories that changed since they were read. Default is false.");
+    app.add_option("--hot",            hot_dirs,     "Directories crawled first, before working and home directory and directories of recent picks. Paths should be separated by space.");
+    app.add_option("--cold",           cold_dirs,    "Directories crawled last, along with system directories (/usr, /var, ...). Paths should be separated by space.");
     // clang-format on
 
     CLI11_PARSE(app, argc, argv);
 
+    // Working directory, recent picks and home are where files are searched for, so they are
+    // indexed first.
+    std::error_code ec;
+    if (const std::filesystem::path cwd = std::filesystem::current_path(ec); !ec)
+        hot_dirs.push_back(cwd.string());
+
+    if (!access_log.empty() && !stats_only && replay.empty()) {
+        try {
+            std::ranges::copy(Access_log{access_log}.recent_dirs(), std::back_inserter(hot_dirs));
+        }
+        catch (const std::runtime_error&) { // NOLINT(bugprone-empty-catch)
+            // Reported when access log is opened for ranking.
+        }
+    }
+
+    if (const std::string home = os::home_dir(); !home.empty())
+        hot_dirs.push_back(home);
+
+    std::ranges::copy(os::system_dirs(), std::back_inserter(cold_dirs));
+
     ums::Options ums_opt{ums::Options::Schedulers_count{cpus},
                          ums::Options::Workers_per_scheduler{wps}};
-    Options finder_opt{root,    ignore_list, include_list, files,
-                       symbols, stats_only,  verbose,      tasks_count};
+    const Options finder_opt{.m_root = root,
+                             .m_ignore_list = ignore_list,
+                             .m_include_list = include_list,
+                             .m_files = files,
+                             .m_symbols = symbols,
+                             .m_stat_only = stats_only,
+                             .m_verbose = verbose,
+                             .m_tasks_count = tasks_count,
+                             .m_stats_json = stats_json,
+                             .m_record = record,
+                             .m_replay = replay,
+                             .m_replay_realtime = replay_realtime,
+                             .m_perf = perf,
+                             .m_compress_names = compress_names,
+                             .m_metadata = metadata,
+                             .m_name_index = name_index,
+                             .m_gitignore = gitignore,
+                             .m_remote_mounts = remote_mounts,
+                             .m_one_file_system = one_file_system,
+                             .m_rescan = rescan,
+                             .m_hot_dirs = hot_dirs,
+                             .m_cold_dirs = cold_dirs,
+                             .m_access_log = access_log};
 
     ums::init_ums([&] { finder_main(finder_opt); }, ums_opt);
 }
@@ -0,0 +1,471 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_MEMORY_HPP
+#define FINDER_MEMORY_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "os.hpp"
+#include "types.hpp"
+#include "util.hpp"
+
+#if defined(OS_LINUX) || defined(OS_WINDOWS)
+#include <malloc.h>
+#endif
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index, cppcoreguidelines-no-malloc)
+
+/**
+ * Allocation statistics of a single memory resource.
+ * Allocations are split into power of two size classes (class N holds sizes in [2^(N-1), 2^N)),
+ * so we can see which allocations dominate the structure.
+ * Requested bytes are what containers asked for. Usable bytes are what the allocator actually
+ * reserved for them, and the difference between the two is the allocator slack (fragmentation).
+ */
+class Memory_stats {
+public:
+    static constexpr usize size_classes_count = 64;
+
+    struct Size_class {
+        u64 m_allocations = 0; // Total number of allocations.
+        u64 m_live = 0;        // Number of currently live allocations.
+        u64 m_requested = 0;   // Currently live requested bytes.
+        u64 m_usable = 0;      // Currently live usable bytes.
+    };
+
+    void allocated(usize requested, usize usable) noexcept
+    {
+        Size_class& sc = m_classes[size_class(requested)];
+        ++sc.m_allocations;
+        ++sc.m_live;
+        sc.m_requested += requested;
+        sc.m_usable += usable;
+
+        ++m_allocations;
+        m_requested += requested;
+        m_usable += usable;
+        m_peak = std::max(m_peak, m_usable);
+    }
+
+    void deallocated(usize requested, usize usable) noexcept
+    {
+        Size_class& sc = m_classes[size_class(requested)];
+        --sc.m_live;
+        sc.m_requested -= requested;
+        sc.m_usable -= usable;
+
+        ++m_deallocations;
+        m_requested -= requested;
+        m_usable -= usable;
+    }
+
+    [[nodiscard]] u64 allocations() const noexcept { return m_allocations; }
+
+    [[nodiscard]] u64 deallocations() const noexcept { return m_deallocations; }
+
+    [[nodiscard]] u64 live() const noexcept { return m_allocations - m_deallocations; }
+
+    [[nodiscard]] u64 requested() const noexcept { return m_requested; }
+
+    [[nodiscard]] u64 usable() const noexcept { return m_usable; }
+
+    [[nodiscard]] u64 peak() const noexcept { return m_peak; }
+
+    /**
+     * Part of the live memory lost to allocator slack, in range [0, 1].
+     */
+    [[nodiscard]] f64 fragmentation() const noexcept
+    {
+        return m_usable == 0 ? 0.0 : f64(m_usable - m_requested) / f64(m_usable);
+    }
+
+    [[nodiscard]] const Size_class& size_class_stats(usize idx) const noexcept
+    {
+        return m_classes[idx];
+    }
+
+    static constexpr usize size_class(usize bytes) noexcept
+    {
+        return std::min(usize(std::bit_width(bytes)), size_classes_count - 1);
+    }
+
+    /**
+     * Human readable report, used by stats print. Only non empty size classes are printed.
+     */
+    [[nodiscard]] std::string report() const
+    {
+        std::string out = std::format(
+            "  live: {} bytes ({} usable, {:.1f}% fragmentation), peak: {} bytes, "
+            "allocations: {}, deallocations: {}\n",
+            m_requested, m_usable, fragmentation() * 100.0, m_peak, m_allocations,
+            m_deallocations);
+
+        for (usize i = 0; i < size_classes_count; ++i) {
+            const Size_class& sc = m_classes[i];
+            if (sc.m_allocations == 0)
+                continue;
+
+            out += std::format("    <{:>8}: allocations: {}, live: {}, bytes: {} ({} usable)\n",
+                               usize(1) << i, sc.m_allocations, sc.m_live, sc.m_requested,
+                               sc.m_usable);
+        }
+
+        return out;
+    }
+
+private:
+    std::array<Size_class, size_classes_count> m_classes{};
+    u64 m_allocations = 0;
+    u64 m_deallocations = 0;
+    u64 m_requested = 0;
+    u64 m_usable = 0;
+    u64 m_peak = 0;
+};
+
+/**
+ * Polymorphic memory resource that counts every allocation of the structure that owns it.
+ * Memory is allocated with malloc, so we can ask the allocator for the real (usable) size of
+ * each block. Over aligned allocations go to the upstream resource and are counted as exact.
+ *
+ * Resource is not thread safe, same as index structures which are built from a single thread.
+ */
+class Tracking_resource : public std::pmr::memory_resource {
+public:
+    explicit Tracking_resource(
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) noexcept
+        : m_upstream{upstream}
+    {
+    }
+
+    Tracking_resource(const Tracking_resource&) = delete;
+    Tracking_resource& operator=(const Tracking_resource&) = delete;
+    Tracking_resource(Tracking_resource&&) = delete;
+    Tracking_resource& operator=(Tracking_resource&&) = delete;
+    ~Tracking_resource() override = default;
+
+    [[nodiscard]] const Memory_stats& stats() const noexcept { return m_stats; }
+
+protected:
+    void* do_allocate(usize bytes, usize alignment) override
+    {
+        if (alignment > alignof(std::max_align_t)) {
+            void* ptr = m_upstream->allocate(bytes, alignment);
+            m_stats.allocated(bytes, bytes);
+            return ptr;
+        }
+
+        void* ptr = std::malloc(std::max(bytes, usize(1)));
+        if (ptr == nullptr)
+            throw std::bad_alloc{};
+
+        m_stats.allocated(bytes, usable_size(ptr, bytes));
+        return ptr;
+    }
+
+    void do_deallocate(void* ptr, usize bytes, usize alignment) override
+    {
+        if (alignment > alignof(std::max_align_t)) {
+            m_stats.deallocated(bytes, bytes);
+            m_upstream->deallocate(ptr, bytes, alignment);
+            return;
+        }
+
+        m_stats.deallocated(bytes, usable_size(ptr, bytes));
+        std::free(ptr);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    static usize usable_size([[maybe_unused]] void* ptr, [[maybe_unused]] usize bytes) noexcept
+    {
+#if defined(OS_LINUX)
+        return malloc_usable_size(ptr);
+#elif defined(OS_WINDOWS)
+        return _msize(ptr);
+#else
+        return bytes;
+#endif
+    }
+
+    std::pmr::memory_resource* m_upstream;
+    Memory_stats m_stats;
+};
+
+/**
+ * Chunked monotonic (bump) allocator.
+ * Memory is taken from the upstream resource in chunks, and every allocation is just a pointer
+ * bump. Deallocation is a no-op, and all memory is released at once with release() or when arena
+ * is destroyed. That is a perfect fit for index construction, which does millions of small
+ * allocations that live as long as the index.
+ * Allocations bigger than a quarter of the chunk get their own chunk, so they don't waste the
+ * rest of the current chunk.
+ *
+ * Arena is not thread safe. Use Arena_pool to get an arena per thread.
+ */
+class Arena : public std::pmr::memory_resource {
+public:
+    static constexpr usize default_chunk_size = usize(64) * 1024;
+
+    explicit Arena(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource(),
+                   usize chunk_size = default_chunk_size) noexcept
+        : m_upstream{upstream}
+        , m_chunk_size{chunk_size}
+    {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) = delete;
+    Arena& operator=(Arena&&) = delete;
+
+    ~Arena() override { release(); }
+
+    /**
+     * Copies string into the arena. Stored string is null terminated, so data() of the returned
+     * view can be used as a C string.
+     */
+    std::string_view store(std::string_view str)
+    {
+        char* data = static_cast<char*>(allocate(str.size() + 1, 1));
+        std::memcpy(data, str.data(), str.size());
+        data[str.size()] = '\0';
+        return {data, str.size()};
+    }
+
+    /**
+     * Releases all chunks. All memory allocated from the arena becomes invalid.
+     */
+    void release() noexcept
+    {
+        while (m_chunks != nullptr) {
+            Chunk* next = m_chunks->m_next;
+            m_upstream->deallocate(m_chunks, m_chunks->m_size, alignof(Chunk));
+            m_chunks = next;
+        }
+
+        m_cur = nullptr;
+        m_end = nullptr;
+        m_used = 0;
+        m_reserved = 0;
+    }
+
+    [[nodiscard]] usize used() const noexcept { return m_used; }
+
+    [[nodiscard]] usize reserved() const noexcept { return m_reserved; }
+
+    /**
+     * Free bytes left in the current chunk. Allocations with alignment 1 that fit into the
+     * remaining bytes are placed right after the previous allocation.
+     */
+    [[nodiscard]] usize remaining() const noexcept { return usize(m_end - m_cur); }
+
+protected:
+    void* do_allocate(usize bytes, usize alignment) override
+    {
+        m_used += bytes;
+
+        if (bytes + alignment > m_chunk_size / 4)
+            return align(add_chunk(bytes + alignment, false), alignment);
+
+        auto* ptr = align(m_cur, alignment);
+        if (m_cur == nullptr || ptr + bytes > m_end)
+            ptr = align(add_chunk(m_chunk_size, true), alignment);
+
+        m_cur = ptr + bytes;
+        return ptr;
+    }
+
+    void do_deallocate(void* /*ptr*/, usize /*bytes*/, usize /*alignment*/) override
+    {
+        // Memory is released with the whole arena.
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    struct Chunk {
+        Chunk* m_next;
+        usize m_size;
+    };
+
+    static std::byte* align(std::byte* ptr, usize alignment) noexcept
+    {
+        const auto p = reinterpret_cast<uptr>(ptr);
+        return reinterpret_cast<std::byte*>((p + alignment - 1) & ~(uptr(alignment) - 1));
+    }
+
+    /**
+     * Allocates a new chunk and returns its first usable byte. Current chunk becomes the new chunk
+     * only if requested, dedicated chunks of big allocations are linked behind the current one.
+     */
+    std::byte* add_chunk(usize bytes, bool make_current)
+    {
+        const usize size = bytes + sizeof(Chunk);
+        auto* chunk = static_cast<Chunk*>(m_upstream->allocate(size, alignof(Chunk)));
+        chunk->m_size = size;
+        m_reserved += size;
+
+        auto* data = reinterpret_cast<std::byte*>(chunk + 1);
+
+        if (make_current || m_chunks == nullptr) {
+            chunk->m_next = m_chunks;
+            m_chunks = chunk;
+        }
+        else {
+            chunk->m_next = m_chunks->m_next;
+            m_chunks->m_next = chunk;
+        }
+
+        if (make_current) {
+            m_cur = data;
+            m_end = data + bytes;
+        }
+
+        return data;
+    }
+
+    std::pmr::memory_resource* m_upstream;
+    usize m_chunk_size;
+    Chunk* m_chunks = nullptr;
+    std::byte* m_cur = nullptr;
+    std::byte* m_end = nullptr;
+    usize m_used = 0;
+    usize m_reserved = 0;
+};
+
+/**
+ * Pool of arenas, one per thread, so parallel builders allocate without any contention. Lock is
+ * taken only the first time a thread asks for its arena.
+ * All arenas share the same upstream resource, which must be thread safe if arenas are used from
+ * multiple threads (Tracking_resource is not).
+ */
+class Arena_pool {
+public:
+    explicit Arena_pool(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource(),
+                        usize chunk_size = Arena::default_chunk_size) noexcept
+        : m_upstream{upstream}
+        , m_chunk_size{chunk_size}
+    {
+    }
+
+    /**
+     * Arena of the calling thread. Created on first use.
+     */
+    Arena& local()
+    {
+        struct Cached {
+            u64 m_pool_id = 0;
+            Arena* m_arena = nullptr;
+        };
+
+        // Thread usually builds a few structures at once (files and symbols), so we cache a few
+        // arenas per thread.
+        thread_local std::array<Cached, 4> cache{};
+        thread_local usize cache_next = 0;
+
+        for (const Cached& c : cache)
+            if (c.m_pool_id == m_id)
+                return *c.m_arena;
+
+        Arena* arena = nullptr;
+        {
+            std::lock_guard<TLockableBase(std::mutex)> lock{m_lock};
+
+            const auto tid = std::this_thread::get_id();
+            auto it = std::ranges::find_if(m_arenas, [&](const auto& a) { return a.first == tid; });
+            if (it == m_arenas.end()) {
+                m_arenas.emplace_back(tid, std::make_unique<Arena>(m_upstream, m_chunk_size));
+                it = m_arenas.end() - 1;
+            }
+
+            arena = it->second.get();
+        }
+
+        cache[cache_next++ % cache.size()] = Cached{.m_pool_id = m_id, .m_arena = arena};
+        return *arena;
+    }
+
+    /**
+     * Releases memory of all arenas at once. Must not race with allocations from other threads.
+     */
+    void release() noexcept
+    {
+        std::lock_guard<TLockableBase(std::mutex)> lock{m_lock};
+        for (auto& [tid, arena] : m_arenas)
+            arena->release();
+    }
+
+    [[nodiscard]] usize used() const noexcept
+    {
+        std::lock_guard<TLockableBase(std::mutex)> lock{m_lock};
+        usize used = 0;
+        for (const auto& [tid, arena] : m_arenas)
+            used += arena->used();
+
+        return used;
+    }
+
+    [[nodiscard]] usize reserved() const noexcept
+    {
+        std::lock_guard<TLockableBase(std::mutex)> lock{m_lock};
+        usize reserved = 0;
+        for (const auto& [tid, arena] : m_arenas)
+            reserved += arena->reserved();
+
+        return reserved;
+    }
+
+private:
+    static u64 next_id() noexcept
+    {
+        static std::atomic<u64> id{1};
+        return id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::pmr::memory_resource* m_upstream;
+    usize m_chunk_size;
+    u64 m_id = next_id(); // Unique per pool, so thread local caches never outlive their pool.
+    mutable TTracyLockableN(std::mutex, m_lock, "Arena_pool");
+    std::vector<std::pair<std::thread::id, std::unique_ptr<Arena>>> m_arenas;
+};
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index, cppcoreguidelines-no-malloc)
+
+#endif // FINDER_MEMORY_HPP
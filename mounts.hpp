@@ -0,0 +1,195 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_MOUNTS_HPP
+#define FINDER_MOUNTS_HPP
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "types.hpp"
+#include "util.hpp"
+
+/**
+ * Mounted filesystems, read from /proc/self/mountinfo and classified by filesystem type, so the
+ * crawl can skip pseudo filesystems (proc, sysfs, cgroup, ...) and remote or FUSE mounts, which
+ * are slow or hang. Table is empty on other platforms (and without procfs), and then every
+ * directory is crawled.
+ */
+class Mount_table {
+public:
+    enum class Kind : u8 {
+        local,   // Disk and memory filesystems (ext4, xfs, btrfs, tmpfs, ...).
+        pseudo,  // Kernel interfaces, whose files are not files (proc, sysfs, cgroup, ...).
+        remote,  // Network filesystems (nfs, cifs, ...), which can stall.
+        fuse,    // User space filesystems, which can be remote or stall too.
+        overlay, // Union of other directories, a container root or a view of one.
+    };
+
+    struct Mount {
+        std::string m_point; // Mount point path, unescaped.
+        std::string m_type;  // Filesystem type, with subtype for FUSE (fuse.sshfs).
+        u64 m_device = 0;    // Major and minor device number, (major << 32) | minor.
+        Kind m_kind = Kind::local;
+    };
+
+    Mount_table() = default;
+
+    /**
+     * Parses mountinfo text. Malformed lines are skipped.
+     */
+    explicit Mount_table(std::string_view mountinfo)
+    {
+        for (const std::string& line : string_split(std::string{mountinfo}, "\n")) {
+            if (auto mount = parse_line(line))
+                add(std::move(*mount));
+        }
+    }
+
+    /**
+     * Mounts of the current process, empty if /proc/self/mountinfo can't be read.
+     */
+    static Mount_table read() { return Mount_table{file_to_string("/proc/self/mountinfo")}; }
+
+    static Kind classify(std::string_view type) noexcept
+    {
+        static constexpr std::array<std::string_view, 21> pseudo{
+            "proc",     "sysfs",    "cgroup",  "cgroup2",    "devtmpfs", "devpts",
+            "debugfs",  "tracefs",  "pstore",  "securityfs", "bpf",      "configfs",
+            "mqueue",   "fusectl",  "autofs",  "hugetlbfs",  "nsfs",     "binfmt_misc",
+            "efivarfs", "selinuxfs", "rpc_pipefs"};
+        static constexpr std::array<std::string_view, 10> remote{
+            "nfs", "nfs4", "cifs", "smb3", "smbfs", "ceph", "glusterfs", "afs", "9p", "lustre"};
+
+        if (std::ranges::find(pseudo, type) != pseudo.end())
+            return Kind::pseudo;
+
+        if (std::ranges::find(remote, type) != remote.end())
+            return Kind::remote;
+
+        if (type == "fuse" || type == "fuseblk" || type.starts_with("fuse."))
+            return Kind::fuse;
+
+        return type == "overlay" ? Kind::overlay : Kind::local;
+    }
+
+    /**
+     * Mount whose mount point is exactly the path, or null. Crawled directories are looked up
+     * with a single hash lookup, which finds every mount boundary on the way.
+     */
+    [[nodiscard]] const Mount* mount_at(std::string_view path) const
+    {
+        const auto it = m_points.find(std::string{path});
+        return it != m_points.end() ? &m_mounts[it->second] : nullptr;
+    }
+
+    /**
+     * Mount that contains the path, the one with the longest mount point that is its prefix.
+     */
+    [[nodiscard]] const Mount* mount_of(std::string_view path) const
+    {
+        const Mount* result = nullptr;
+        for (const auto& [point, idx] : m_points) {
+            const bool contains = path.starts_with(point) &&
+                                  (path.size() == point.size() || point.ends_with('/') ||
+                                   path[point.size()] == '/');
+            if (contains && (result == nullptr || point.size() > result->m_point.size()))
+                result = &m_mounts[idx];
+        }
+
+        return result;
+    }
+
+    [[nodiscard]] usize size() const noexcept { return m_points.size(); }
+
+private:
+    /**
+     * Parses a mountinfo line:
+     *   36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+     * Fields are mount id, parent id, major:minor, root, mount point and options, then optional
+     * fields up to the - separator, then filesystem type, source and super options.
+     */
+    static std::optional<Mount> parse_line(const std::string& line)
+    {
+        const std::vector<std::string> fields = string_split(line, " ");
+        const auto separator = std::ranges::find(fields, "-");
+        if (fields.size() < 7 || separator == fields.end() || separator + 1 == fields.end())
+            return std::nullopt;
+
+        Mount mount{.m_point = unescape(fields[4]), .m_type = *(separator + 1)};
+        mount.m_kind = classify(mount.m_type);
+
+        const std::string& device = fields[2];
+        const usize colon = device.find(':');
+        u64 major = 0;
+        u64 minor = 0;
+        if (colon == std::string::npos ||
+            std::from_chars(device.data(), device.data() + colon, major).ec != std::errc{} ||
+            std::from_chars(device.data() + colon + 1, device.data() + device.size(), minor).ec !=
+                std::errc{})
+            return std::nullopt;
+
+        mount.m_device = (major << 32) | minor;
+        return mount;
+    }
+
+    /**
+     * Decodes octal escapes of spaces, tabs, newlines and backslashes (\040) in mount points.
+     */
+    static std::string unescape(std::string_view text)
+    {
+        std::string result;
+        for (usize i = 0; i < text.size(); ++i) {
+            if (text[i] == '\\' && i + 3 < text.size() && text[i + 1] >= '0' &&
+                text[i + 1] <= '3') {
+                result += char(((text[i + 1] - '0') << 6) | ((text[i + 2] - '0') << 3) |
+                               (text[i + 3] - '0'));
+                i += 3;
+            }
+            else {
+                result += text[i];
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * Adds the mount. Mount stacked on the same mount point hides the earlier one.
+     */
+    void add(Mount mount)
+    {
+        if (const auto it = m_points.find(mount.m_point); it != m_points.end()) {
+            m_mounts[it->second] = std::move(mount);
+            return;
+        }
+
+        m_points.emplace(mount.m_point, m_mounts.size());
+        m_mounts.push_back(std::move(mount));
+    }
+
+    std::vector<Mount> m_mounts;
+    std::unordered_map<std::string, usize> m_points; // Mount point -> index in mounts.
+};
+
+#endif // FINDER_MOUNTS_HPP
@@ -0,0 +1,278 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_NAMES_HPP
+#define FINDER_NAMES_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#include "memory.hpp"
+#include "types.hpp"
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+/**
+ * Front coded name store.
+ * Names are stored in blocks of up to block_entries names. First name of a block is stored as is,
+ * and every other name as the sizes of the prefix and the suffix it shares with the previous name,
+ * plus the rest of the name in between. Crawler inserts names of a directory one after another, so
+ * neighbours share prefixes (libfoo.so.1, libfoo.so.1.2) and, even more often in readdir order,
+ * extensions (.h, .so, .py).
+ *
+ * Entry layout:
+ *   [shared prefix size (4 bits) | shared suffix size (4 bits)]
+ *   [prefix size - 15, if prefix nibble is 15][suffix size - 15, if suffix nibble is 15]
+ *   [middle size][middle]
+ * where all sizes except the nibbles are LEB128 varints.
+ *
+ * Entry is identified by the pointer to its first byte, which is stable for the lifetime of the
+ * store, and by its offset from the block head, which callers keep next to the pointer, so entries
+ * don't have to store it. Names are decoded into a Cursor. Cursor remembers the last decoded entry,
+ * so decoding entries in insertion order (partial search scan) costs one small copy per name.
+ *
+ * Store is not thread safe for inserts. Decoding is thread safe, with a cursor per thread.
+ */
+class Front_coded_names {
+public:
+    static constexpr usize block_entries = 16;
+    static constexpr usize max_contiguous_entry = Arena::default_chunk_size / 8;
+
+    struct Entry {
+        const char* m_data;
+        u32 m_offset; // Offset from the block head.
+    };
+
+    /**
+     * Decoding state. Name view returned by get() is valid until the cursor is used again.
+     */
+    struct Cursor {
+        u64 m_store_id = 0;
+        const char* m_entry = nullptr; // Last decoded entry.
+        const char* m_next = nullptr;  // Entry after the last decoded one.
+        std::string m_name;            // Name of the last decoded entry.
+        std::string m_scratch;
+    };
+
+    explicit Front_coded_names(
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : m_arena{upstream}
+    {
+    }
+
+    /**
+     * Appends name to the store and returns its entry.
+     */
+    Entry add(std::string_view name)
+    {
+        if (m_block_size > 0 && m_block_size < block_entries) {
+            const usize prefix = shared_prefix(m_last, name);
+            const usize suffix = shared_suffix(std::string_view{m_last}.substr(prefix),
+                                               name.substr(prefix));
+            const usize bytes = entry_size(prefix, suffix, name.size() - prefix - suffix);
+
+            // Block must be contiguous, so a new block starts when the arena chunk is full.
+            if (bytes <= max_contiguous_entry && m_arena.remaining() >= bytes)
+                return append(name, prefix, suffix, bytes);
+        }
+
+        m_block_size = 0;
+        return append(name, 0, 0, entry_size(0, 0, name.size()));
+    }
+
+    /**
+     * Decodes name of the entry.
+     */
+    std::string_view get(Entry entry, Cursor& cursor) const
+    {
+        if (cursor.m_store_id == m_id && cursor.m_entry == entry.m_data)
+            return cursor.m_name;
+
+        const char* head = entry.m_data - entry.m_offset;
+
+        // Continue from the last decoded entry if it is before this one in the same block.
+        const bool same_block = cursor.m_store_id == m_id && cursor.m_next != nullptr &&
+                                cursor.m_next > head && cursor.m_next <= entry.m_data;
+
+        const char* p = same_block ? cursor.m_next : head;
+        if (!same_block)
+            cursor.m_name.clear();
+
+        for (;;) {
+            const char* cur = p;
+            const auto nibbles = static_cast<u8>(*p++);
+
+            usize prefix = nibbles >> 4U;
+            if (prefix == 15)
+                prefix += read_varint(p);
+
+            usize suffix = nibbles & 15U;
+            if (suffix == 15)
+                suffix += read_varint(p);
+
+            const usize middle = read_varint(p);
+
+            if (suffix == 0) {
+                cursor.m_name.resize(prefix);
+                cursor.m_name.append(p, middle);
+            }
+            else {
+                const std::string& prev = cursor.m_name;
+                cursor.m_scratch.assign(prev, 0, prefix);
+                cursor.m_scratch.append(p, middle);
+                cursor.m_scratch.append(prev, prev.size() - suffix, suffix);
+                cursor.m_name.swap(cursor.m_scratch);
+            }
+
+            p += middle;
+
+            if (cur == entry.m_data)
+                break;
+        }
+
+        cursor.m_store_id = m_id;
+        cursor.m_entry = entry.m_data;
+        cursor.m_next = p;
+        return cursor.m_name;
+    }
+
+    [[nodiscard]] usize count() const noexcept { return m_count; }
+
+    /**
+     * Size of all stored names, as if they were stored uncompressed.
+     */
+    [[nodiscard]] usize raw_size() const noexcept { return m_raw_size; }
+
+    [[nodiscard]] usize used() const noexcept { return m_arena.used(); }
+
+    [[nodiscard]] usize reserved() const noexcept { return m_arena.reserved(); }
+
+private:
+    Entry append(std::string_view name, usize prefix, usize suffix, usize bytes)
+    {
+        const std::string_view middle = name.substr(prefix, name.size() - prefix - suffix);
+
+        char* data = static_cast<char*>(m_arena.allocate(bytes, 1));
+        assert(m_block_size == 0 || data == m_block_end);
+
+        if (m_block_size == 0)
+            m_block_head = data;
+
+        char* p = data;
+        *p++ = static_cast<char>((std::min(prefix, usize(15)) << 4U) | std::min(suffix, usize(15)));
+        if (prefix >= 15)
+            write_varint(p, prefix - 15);
+
+        if (suffix >= 15)
+            write_varint(p, suffix - 15);
+
+        write_varint(p, middle.size());
+        std::memcpy(p, middle.data(), middle.size());
+
+        m_last = name;
+        m_block_end = data + bytes;
+        m_block_size += 1;
+        m_count += 1;
+        m_raw_size += name.size();
+
+        // Huge names get their own arena chunk, so nothing can be appended after them.
+        if (bytes > max_contiguous_entry)
+            m_block_size = block_entries;
+
+        return Entry{.m_data = data, .m_offset = static_cast<u32>(data - m_block_head)};
+    }
+
+    static constexpr usize entry_size(usize prefix, usize suffix, usize middle) noexcept
+    {
+        return 1 + (prefix >= 15 ? varint_size(prefix - 15) : 0) +
+               (suffix >= 15 ? varint_size(suffix - 15) : 0) + varint_size(middle) + middle;
+    }
+
+    static usize shared_prefix(std::string_view a, std::string_view b) noexcept
+    {
+        const usize size = std::min(a.size(), b.size());
+        usize i = 0;
+        while (i < size && a[i] == b[i])
+            ++i;
+
+        return i;
+    }
+
+    static usize shared_suffix(std::string_view a, std::string_view b) noexcept
+    {
+        const usize size = std::min(a.size(), b.size());
+        usize i = 0;
+        while (i < size && a[a.size() - 1 - i] == b[b.size() - 1 - i])
+            ++i;
+
+        return i;
+    }
+
+    static constexpr usize varint_size(usize value) noexcept
+    {
+        usize size = 1;
+        for (; value >= 0x80; value >>= 7)
+            ++size;
+
+        return size;
+    }
+
+    static void write_varint(char*& p, usize value) noexcept
+    {
+        for (; value >= 0x80; value >>= 7)
+            *p++ = static_cast<char>((value & 0x7F) | 0x80);
+
+        *p++ = static_cast<char>(value);
+    }
+
+    static usize read_varint(const char*& p) noexcept
+    {
+        usize value = 0;
+        for (u32 shift = 0;; shift += 7) {
+            const auto byte = static_cast<u8>(*p++);
+            value |= usize(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+    }
+
+    static u64 next_id() noexcept
+    {
+        static std::atomic<u64> id{1};
+        return id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Arena m_arena;
+    u64 m_id = next_id(); // Unique per store, so cursors never decode entries of another store.
+
+    const char* m_block_head = nullptr;
+    const char* m_block_end = nullptr;
+    usize m_block_size = 0; // Number of entries in the current block.
+    std::string m_last;     // Last stored name, the base of the next entry.
+
+    usize m_count = 0;
+    usize m_raw_size = 0;
+};
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+#endif // FINDER_NAMES_HPP
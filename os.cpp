@@ -17,6 +17,7 @@
 
 #include <cerrno>
 #include <csignal>
+#include <cstdlib>
 #include <exception>
 #include <format>
 #include <iostream>
@@ -40,6 +41,8 @@ namespace os {
 #undef max
 
 #include <conio.h>
+#include <sys/types.h> // Must precede sys/stat.h on Windows.
+#include <sys/stat.h>
 
 // NOLINTEND
 COORD to_win_coord(Coordinates coord)
@@ -117,11 +120,26 @@ bool is_ctrl_d(i32 input)
     return input == 4;
 }
 
+bool is_ctrl_e(i32 input)
+{
+    return input == 5;
+}
+
 bool is_ctrl_g(i32 input)
 {
     return input == 7;
 }
 
+bool is_ctrl_t(i32 input)
+{
+    return input == 20;
+}
+
+bool is_ctrl_r(i32 input)
+{
+    return input == 18;
+}
+
 /**
  * Used for settings restoration.
  */
@@ -179,12 +197,15 @@ Coordinates console_window_size(void* out_handle)
     return Coordinates{csbi.dwMaximumWindowSize.X, csbi.dwMaximumWindowSize.Y};
 }
 
-void console_scan(void* in_handle, ConsoleInput& input)
+bool console_scan(void* in_handle, ConsoleInput& input, i32 timeout_ms)
 {
     while (true) {
         INPUT_RECORD record;
         DWORD count = 0;
 
+        if (timeout_ms >= 0 && WaitForSingleObject(in_handle, DWORD(timeout_ms)) == WAIT_TIMEOUT)
+            return false;
+
         if (!ReadConsoleInput(in_handle, &record, 1, &count))
             throw std::exception{"Failed to read input."};
 
@@ -195,16 +216,16 @@ void console_scan(void* in_handle, ConsoleInput& input)
 
             if (record.Event.KeyEvent.wVirtualKeyCode == VK_BACK) {
                 input = 127;
-                return;
+                return true;
             }
 
             input = record.Event.KeyEvent.uChar.AsciiChar;
-            return;
+            return true;
         }
         case WINDOW_BUFFER_SIZE_EVENT: {
             const auto& e = record.Event.WindowBufferSizeEvent;
             input = Coordinates{e.dwSize.X, e.dwSize.Y};
-            return;
+            return true;
         }
         default: {
             continue;
@@ -218,6 +239,56 @@ std::string root_dir()
     return "C:\\";
 }
 
+std::vector<std::string> system_dirs()
+{
+    return {R"(C:\Windows)", R"(C:\Program Files)", R"(C:\Program Files (x86))",
+            R"(C:\ProgramData)"};
+}
+
+bool file_stat(const std::string& path, File_stat& result)
+{
+    struct _stat64 st {};
+    if (_stat64(path.c_str(), &st) != 0)
+        return false;
+
+    result = File_stat{.m_size = u64(st.st_size),
+                       .m_mtime = i64(st.st_mtime),
+                       .m_mode = u32(st.st_mode),
+                       .m_device = u64(st.st_dev)};
+    return true;
+}
+
+std::string home_dir()
+{
+    const char* home = std::getenv("USERPROFILE"); // NOLINT(concurrency-mt-unsafe)
+    return home != nullptr ? home : "";
+}
+
+void* map_file(const std::string& path, usize size)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    // Mapping larger than the file extends it with zeros. View keeps the mapping alive.
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, DWORD(u64(size) >> 32),
+                                        DWORD(size & 0xFFFFFFFF), nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr)
+        return nullptr;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(mapping);
+    return data;
+}
+
+void unmap_file(void* data, [[maybe_unused]] usize size)
+{
+    UnmapViewOfFile(data);
+}
+
 template<bool throws>
 i32 exec_cmd_internal(const std::string& cmd)
 {
@@ -271,9 +342,12 @@ i32 copy_to_clipboard(const std::string& str)
 
 // NOLINTBEGIN
 
+#include <fcntl.h>
 #include <signal.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
+#include <sys/stat.h>
 #include <termios.h>
 #include <unistd.h>
 
@@ -342,6 +416,11 @@ bool is_ctrl_d(i32 input)
     return input == 4;
 }
 
+bool is_ctrl_e(i32 input)
+{
+    return input == 5;
+}
+
 bool is_ctrl_g(i32 input)
 {
     return input == 7;
@@ -352,6 +431,16 @@ bool is_ctrl_p(i32 input)
     return input == 16;
 }
 
+bool is_ctrl_t(i32 input)
+{
+    return input == 20;
+}
+
+bool is_ctrl_r(i32 input)
+{
+    return input == 18;
+}
+
 /**
  * Poller class user for receiving user commands.
  *
@@ -389,7 +478,7 @@ public:
         fds[1].events = POLLIN;
     }
 
-    void poll_events() { poll(fds, 2, inf); }
+    bool poll_events(i32 timeout_ms = inf) { return poll(fds, 2, timeout_ms) > 0; }
 
     bool stdin_received() { return fds[0].revents & POLLIN; }
 
@@ -456,9 +545,10 @@ Coordinates console_window_size([[maybe_unused]] void* handle)
     return Coordinates{static_cast<i16>(w.ws_col), static_cast<i16>(w.ws_row)};
 }
 
-void console_scan([[maybe_unused]] void* in_handle, ConsoleInput& input)
+bool console_scan([[maybe_unused]] void* in_handle, ConsoleInput& input, i32 timeout_ms)
 {
-    poller.poll_events();
+    if (!poller.poll_events(timeout_ms))
+        return false;
 
     if (poller.stdin_received()) {
         i32 in = 0;
@@ -468,7 +558,7 @@ void console_scan([[maybe_unused]] void* in_handle, ConsoleInput& input)
         }
 
         input = in;
-        return;
+        return true;
     }
 
     if (poller.signal_received()) {
@@ -479,8 +569,10 @@ void console_scan([[maybe_unused]] void* in_handle, ConsoleInput& input)
         }
 
         input = c;
-        return;
+        return true;
     }
+
+    return false;
 }
 
 std::string root_dir()
@@ -488,6 +580,52 @@ std::string root_dir()
     return "/";
 }
 
+std::vector<std::string> system_dirs()
+{
+    return {"/usr", "/var", "/opt", "/snap", "/nix", "/lib", "/lib64", "/boot"};
+}
+
+bool file_stat(const std::string& path, File_stat& result)
+{
+    struct stat st {};
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+
+    result = File_stat{.m_size = u64(st.st_size),
+                       .m_mtime = i64(st.st_mtim.tv_sec),
+                       .m_mode = u32(st.st_mode),
+                       .m_device = u64(st.st_dev)};
+    return true;
+}
+
+std::string home_dir()
+{
+    const char* home = std::getenv("HOME"); // NOLINT(concurrency-mt-unsafe)
+    return home != nullptr ? home : "";
+}
+
+void* map_file(const std::string& path, usize size)
+{
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return nullptr;
+
+    // Extending the file fills it with zeros. Mapping stays valid after the descriptor is closed.
+    struct stat st {};
+    const bool sized =
+        fstat(fd, &st) == 0 && (usize(st.st_size) >= size || ftruncate(fd, off_t(size)) == 0);
+
+    void* data =
+        sized ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    return data == MAP_FAILED ? nullptr : data;
+}
+
+void unmap_file(void* data, usize size)
+{
+    munmap(data, size);
+}
+
 template<bool throws>
 i32 exec_cmd_internal(const std::string& cmd)
 {
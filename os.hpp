@@ -20,7 +20,9 @@
 
 #include <filesystem>
 #include <format>
+#include <string>
 #include <variant>
+#include <vector>
 
 #include "types.hpp"
 
@@ -45,6 +47,21 @@ struct Coordinates {
 
 using ConsoleInput = std::variant<os::Coordinates, i32>;
 
+/**
+ * File metadata, as reported by stat (symlinks are followed).
+ */
+struct File_stat {
+    u64 m_size = 0;
+    i64 m_mtime = 0; // Last modification, in seconds since epoch.
+    u32 m_mode = 0;  // File type and permission bits.
+    u64 m_device = 0;
+};
+
+// File type bits of File_stat::m_mode, same on all supported systems.
+constexpr u32 mode_type_mask = 0170000;
+constexpr u32 mode_dir = 0040000;
+constexpr u32 mode_file = 0100000;
+
 bool is_esc(i32 input);
 bool is_term(i32 input);
 bool is_backspace(i32 input);
@@ -59,16 +76,43 @@ bool is_ctrl_y(i32 input);
 bool is_ctrl_q(i32 input);
 bool is_ctrl_u(i32 input);
 bool is_ctrl_d(i32 input);
+bool is_ctrl_e(i32 input);
 bool is_ctrl_g(i32 input);
+bool is_ctrl_t(i32 input);
+bool is_ctrl_r(i32 input);
 
 void* init_console_in_handle();
 void* init_console_out_handle();
 void close_console(void* in_handle, void* out_handle);
 Coordinates console_window_size(void* out_handle);
-void console_scan(void* in_handle, ConsoleInput& input);
+bool console_scan(void* in_handle, ConsoleInput& input, i32 timeout_ms = -1);
 
 std::string root_dir();
 
+/**
+ * System directories (programs, libraries and variable data), which are rarely searched, so the
+ * crawl leaves them for last.
+ */
+std::vector<std::string> system_dirs();
+
+/**
+ * Reads metadata of the file. Returns false if file can't be stat-ed.
+ */
+bool file_stat(const std::string& path, File_stat& result);
+
+/**
+ * User's home directory, or empty string if it is unknown.
+ */
+std::string home_dir();
+
+/**
+ * Maps file into memory for reading and writing, so writes go to the file. File is created, and
+ * extended with zeros, if it is smaller than size. Returns null on failure.
+ */
+void* map_file(const std::string& path, usize size);
+
+void unmap_file(void* data, usize size);
+
 template<bool throws = true>
 i32 copy_to_clipboard(const std::string& str);
 
@@ -0,0 +1,141 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_PATH_RULES_HPP
+#define FINDER_PATH_RULES_HPP
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+
+/**
+ * Ignore and include path prefixes of the crawl, compiled into a byte trie. Path is ignored if it
+ * starts with an ignore rule and doesn't start with an include rule, as before, but every check is
+ * a single walk of the path instead of a loop over all rules.
+ *
+ * The walk also tells whether an include rule lies below the path, so an ignored directory is
+ * still entered when something inside it is included, and skipped whole otherwise.
+ */
+class Path_rules {
+public:
+    /**
+     * Verdict of a path: whether the entry itself is indexed, and whether the crawl enters it.
+     */
+    struct Verdict {
+        bool m_index = true;
+        bool m_recurse = true;
+    };
+
+    Path_rules() { m_nodes.emplace_back(); }
+
+    Path_rules(const std::vector<std::string>& ignore_list,
+               const std::vector<std::string>& include_list)
+        : Path_rules{}
+    {
+        for (const std::string& path : ignore_list)
+            ignore(path);
+
+        for (const std::string& path : include_list)
+            include(path);
+    }
+
+    void ignore(std::string_view path) { m_nodes[add(path)].m_ignore = true; }
+
+    void include(std::string_view path)
+    {
+        // Every node on the path has the include rule below it.
+        u32 node = 0;
+        m_nodes[node].m_include_below = true;
+        for (const char c : path) {
+            node = child_or_add(node, c);
+            m_nodes[node].m_include_below = true;
+        }
+
+        m_nodes[node].m_include = true;
+    }
+
+    [[nodiscard]] Verdict check(std::string_view path) const noexcept
+    {
+        bool ignored = m_nodes[0].m_ignore;
+        bool included = m_nodes[0].m_include;
+
+        u32 node = 0;
+        for (const char c : path) {
+            node = child(node, c);
+            if (node == no_node)
+                break;
+
+            ignored = ignored || m_nodes[node].m_ignore;
+            included = included || m_nodes[node].m_include;
+        }
+
+        if (!ignored || included)
+            return {};
+
+        // Ignored, but some included path is inside of it (or is the path itself).
+        const bool include_below = node != no_node && m_nodes[node].m_include_below;
+        return {.m_index = false, .m_recurse = include_below};
+    }
+
+private:
+    static constexpr u32 no_node = ~u32(0);
+
+    struct Node {
+        std::vector<std::pair<char, u32>> m_children; // Sorted by byte.
+        bool m_ignore = false;                        // Ignore rule ends here.
+        bool m_include = false;                       // Include rule ends here.
+        bool m_include_below = false;                 // Include rule ends here or below.
+    };
+
+    [[nodiscard]] u32 child(u32 node, char c) const noexcept
+    {
+        const auto& children = m_nodes[node].m_children;
+        const auto it = std::ranges::lower_bound(children, c, {}, &std::pair<char, u32>::first);
+        return it != children.end() && it->first == c ? it->second : no_node;
+    }
+
+    u32 child_or_add(u32 node, char c)
+    {
+        if (const u32 next = child(node, c); next != no_node)
+            return next;
+
+        const auto next = u32(m_nodes.size());
+        m_nodes.emplace_back();
+
+        auto& children = m_nodes[node].m_children;
+        children.insert(std::ranges::lower_bound(children, c, {}, &std::pair<char, u32>::first),
+                        {c, next});
+        return next;
+    }
+
+    u32 add(std::string_view path)
+    {
+        u32 node = 0;
+        for (const char c : path)
+            node = child_or_add(node, c);
+
+        return node;
+    }
+
+    std::vector<Node> m_nodes; // Root is the first node.
+};
+
+#endif // FINDER_PATH_RULES_HPP
@@ -0,0 +1,323 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_PERF_HPP
+#define FINDER_PERF_HPP
+
+#include <array>
+#include <format>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "os.hpp"
+#include "types.hpp"
+#include "util.hpp"
+
+#if defined(OS_LINUX)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index, cppcoreguidelines-pro-type-vararg)
+
+/**
+ * Hardware events counted by Perf_counters.
+ */
+enum class Perf_event : u8 { cycles, instructions, cache_misses, branches, branch_misses, count };
+
+static constexpr usize perf_events_count = static_cast<usize>(Perf_event::count);
+
+static constexpr std::string_view perf_event_name(Perf_event event)
+{
+    constexpr std::array<std::string_view, perf_events_count> names{
+        "cycles", "instructions", "cache_misses", "branches", "branch_misses"};
+    return names[static_cast<usize>(event)];
+}
+
+/**
+ * Single measurement (or a sum of measurements) of all hardware events.
+ */
+struct Perf_sample {
+    std::array<u64, perf_events_count> m_values{};
+
+    [[nodiscard]] u64 operator[](Perf_event event) const noexcept
+    {
+        return m_values[static_cast<usize>(event)];
+    }
+
+    [[nodiscard]] f64 ipc() const noexcept
+    {
+        u64 cycles = (*this)[Perf_event::cycles];
+        return cycles == 0 ? 0.0 : f64((*this)[Perf_event::instructions]) / f64(cycles);
+    }
+
+    Perf_sample& operator+=(const Perf_sample& other) noexcept
+    {
+        for (usize i = 0; i < perf_events_count; ++i)
+            m_values[i] += other.m_values[i];
+
+        return *this;
+    }
+
+    /**
+     * Difference of two reads. Saturates at 0, since multiplexing scale can make later reads
+     * slightly smaller.
+     */
+    Perf_sample operator-(const Perf_sample& other) const noexcept
+    {
+        Perf_sample r;
+        for (usize i = 0; i < perf_events_count; ++i)
+            r.m_values[i] = m_values[i] > other.m_values[i] ? m_values[i] - other.m_values[i] : 0;
+
+        return r;
+    }
+};
+
+/**
+ * Returns value of /proc/sys/kernel/perf_event_paranoid, or -1 if it can't be read.
+ * Counting user space events of own threads (which is all we do) works without root for values
+ * up to 2.
+ */
+inline i32 perf_event_paranoid()
+{
+    std::ifstream in{"/proc/sys/kernel/perf_event_paranoid"};
+    i32 value = -1;
+    in >> value;
+    return in.fail() ? -1 : value;
+}
+
+/**
+ * Hardware performance counters of the calling thread, opened as a single perf_event_open group
+ * so all events are scheduled (and multiplexed) together.
+ * Counters are enabled once and never reset. Measurements are differences of two reads, which
+ * makes nested measurements on the same thread possible.
+ * Kernel and hypervisor are excluded, which makes counters available to non root users when
+ * perf_event_paranoid allows it. If counters can't be opened (no PMU, paranoid too high,
+ * non linux OS...), ok() returns false and all samples are zeros.
+ */
+class Perf_counters {
+public:
+#if defined(OS_LINUX)
+    Perf_counters() noexcept
+    {
+        constexpr std::array<u64, perf_events_count> configs{
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+
+        m_fds.fill(-1);
+
+        for (usize i = 0; i < perf_events_count; ++i) {
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(perf_event_attr);
+            attr.config = configs[i];
+            attr.disabled = i == 0 ? 1 : 0; // Only group leader controls the group.
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            m_fds[i] = static_cast<i32>(syscall(SYS_perf_event_open, &attr, 0, -1, m_fds[0], 0));
+            if (m_fds[i] == -1) {
+                close_all();
+                return;
+            }
+        }
+
+        m_ok = ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == 0;
+    }
+
+    ~Perf_counters() noexcept { close_all(); }
+
+    /**
+     * Reads current counter values. Values are scaled if kernel had to multiplex the group with
+     * other events.
+     */
+    Perf_sample read_sample() noexcept
+    {
+        Perf_sample sample;
+        if (!m_ok)
+            return sample;
+
+        struct {
+            u64 m_nr;
+            u64 m_time_enabled;
+            u64 m_time_running;
+            std::array<u64, perf_events_count> m_values;
+        } data{};
+
+        if (read(m_fds[0], &data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) ||
+            data.m_time_running == 0)
+            return sample;
+
+        const f64 scale = f64(data.m_time_enabled) / f64(data.m_time_running);
+        for (usize i = 0; i < perf_events_count; ++i)
+            sample.m_values[i] = static_cast<u64>(f64(data.m_values[i]) * scale);
+
+        return sample;
+    }
+#else
+    Perf_sample read_sample() noexcept { return {}; }
+#endif
+
+    Perf_counters(const Perf_counters&) = delete;
+    Perf_counters& operator=(const Perf_counters&) = delete;
+    Perf_counters(Perf_counters&&) = delete;
+    Perf_counters& operator=(Perf_counters&&) = delete;
+
+    [[nodiscard]] bool ok() const noexcept { return m_ok; }
+
+    /**
+     * Counters of the calling thread. Opened lazily, once per thread, so measured scopes only
+     * pay for two reads.
+     */
+    static Perf_counters& local()
+    {
+        thread_local Perf_counters counters;
+        return counters;
+    }
+
+private:
+#if defined(OS_LINUX)
+    void close_all() noexcept
+    {
+        for (i32& fd : m_fds) {
+            if (fd != -1)
+                close(fd);
+
+            fd = -1;
+        }
+    }
+
+    std::array<i32, perf_events_count> m_fds{};
+#endif
+    bool m_ok = false;
+};
+
+/**
+ * Hardware counters aggregated per stage (crawl, partial_search...). Thread safe, since search
+ * tasks report from worker threads.
+ */
+class Perf_stats {
+public:
+    struct Stage_sample {
+        Perf_sample m_sample;
+        u64 m_count = 0;
+    };
+
+    void add(std::string_view stage, const Perf_sample& sample)
+    {
+        std::lock_guard<TLockableBase(std::mutex)> lock{m_lock};
+
+        auto it = m_stages.find(stage);
+        if (it == m_stages.end())
+            it = m_stages.emplace(std::string{stage}, Stage_sample{}).first;
+
+        it->second.m_sample += sample;
+        ++it->second.m_count;
+    }
+
+    [[nodiscard]] std::map<std::string, Stage_sample, std::less<>> stages() const
+    {
+        std::lock_guard<TLockableBase(std::mutex)> lock{m_lock};
+        return m_stages;
+    }
+
+    /**
+     * Human readable report, used by stats print.
+     */
+    [[nodiscard]] std::string report() const
+    {
+        if (!Perf_counters::local().ok())
+            return std::format("Hardware counters unavailable (perf_event_paranoid: {}).\n",
+                               perf_event_paranoid());
+
+        std::string out = "Hardware counters:\n";
+        for (const auto& [stage, s] : stages()) {
+            out += std::format("  {} (x{}): IPC: {:.2f}", stage, s.m_count, s.m_sample.ipc());
+            for (usize i = 0; i < perf_events_count; ++i)
+                out += std::format(", {}: {}", perf_event_name(Perf_event(i)),
+                                   s.m_sample.m_values[i]);
+
+            out += "\n";
+        }
+
+        return out;
+    }
+
+    [[nodiscard]] std::string to_json() const
+    {
+        std::string json = "{";
+        bool first = true;
+
+        for (const auto& [stage, s] : stages()) {
+            json += std::format("{}\n    \"{}\": {{\"count\": {}, \"ipc\": {:.3f}",
+                                first ? "" : ",", stage, s.m_count, s.m_sample.ipc());
+            for (usize i = 0; i < perf_events_count; ++i)
+                json += std::format(", \"{}\": {}", perf_event_name(Perf_event(i)),
+                                    s.m_sample.m_values[i]);
+
+            json += "}";
+            first = false;
+        }
+
+        json += first ? "}" : "\n  }";
+        return json;
+    }
+
+private:
+    mutable TTracyLockableN(std::mutex, m_lock, "Perf_stats");
+    std::map<std::string, Stage_sample, std::less<>> m_stages;
+};
+
+/**
+ * Counts hardware events of a scope on the calling thread and adds them into provided stage.
+ * Null stats disables counting, so scope can be left in hot paths when profiling is off.
+ */
+class Perf_scope {
+public:
+    Perf_scope(Perf_stats* stats, std::string_view stage) : m_stats{stats}, m_stage{stage}
+    {
+        if (m_stats != nullptr)
+            m_start = Perf_counters::local().read_sample();
+    }
+
+    ~Perf_scope()
+    {
+        if (m_stats != nullptr)
+            m_stats->add(m_stage, Perf_counters::local().read_sample() - m_start);
+    }
+
+    Perf_scope(const Perf_scope&) = delete;
+    Perf_scope& operator=(const Perf_scope&) = delete;
+    Perf_scope(Perf_scope&&) = delete;
+    Perf_scope& operator=(Perf_scope&&) = delete;
+
+private:
+    Perf_stats* m_stats;
+    std::string_view m_stage;
+    Perf_sample m_start;
+};
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index, cppcoreguidelines-pro-type-vararg)
+
+#endif // FINDER_PERF_HPP
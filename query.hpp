@@ -15,10 +15,13 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "files.hpp"
 #include "os.hpp"
+#include "terms.hpp"
 
 #ifndef FINDER_QUERY_HPP
 #define FINDER_QUERY_HPP
@@ -57,7 +60,7 @@ public:
      * We will try to go level up "smartly", meaning that we will remove part of path from user
      * query that will be pinned.
      */
-    bool level_up(const Files::Match& match)
+    bool level_up(const Files::Match_view& match)
     {
         usize slash_pos = m_query.find_last_of(os::path_sep);
         std::string query_name{slash_pos != std::string::npos ? m_query.substr(slash_pos + 1) :
@@ -65,9 +68,9 @@ public:
         std::string query_path{slash_pos != std::string::npos ? m_query.substr(0, slash_pos + 1) :
                                                                 ""};
 
-        const std::string full_path = match.m_file->full_path().substr();
+        const std::string full_path = match.full_path();
 
-        if (m_pinned == match.m_file->path())
+        if (m_pinned == match.path())
             query_name.clear();
 
         for (auto it = full_path.begin() + m_pinned.size(); it != full_path.end(); ++it) { // NOLINT
@@ -93,9 +96,9 @@ public:
     /**
      * Pins path from picker position and removes path from name.
      */
-    void pin_path(const Files::Match& match)
+    void pin_path(const Files::Match_view& match)
     {
-        m_pinned = match.m_file->full_path();
+        m_pinned = match.full_path();
         if (!m_pinned.ends_with(os::path_sep))
             m_pinned.append(1, os::path_sep);
 
@@ -112,9 +115,39 @@ public:
 
     [[nodiscard]] std::string full() const { return m_pinned + m_query; }
 
+    /**
+     * Query terms. Pinned path is the path of the first name term, so pinned directories are
+     * searched the same way as with a path typed into the query.
+     */
+    [[nodiscard]] std::vector<Query_term> terms() const
+    {
+        std::vector<Query_term> terms = parse_terms(m_query);
+        if (m_pinned.empty())
+            return terms;
+
+        const auto first_name = std::ranges::find_if(terms, [](const Query_term& term) {
+            return term.m_kind == Query_term::Kind::name && !term.m_negated;
+        });
+
+        if (first_name != terms.end())
+            first_name->m_text = m_pinned + first_name->m_text;
+        else
+            terms.push_back(Query_term{.m_text = m_pinned});
+
+        return terms;
+    }
+
+    /**
+     * Toggles between wildcard (*) and regex query syntax.
+     */
+    void toggle_regex() noexcept { m_regex = !m_regex; }
+
+    [[nodiscard]] bool regex() const noexcept { return m_regex; }
+
 private:
     std::string m_pinned;
     std::string m_query;
+    bool m_regex = false;
 };
 
 #endif // FINDER_QUERY_HPP
@@ -0,0 +1,860 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_REGEX_HPP
+#define FINDER_REGEX_HPP
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+#include "util.hpp"
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index, misc-no-recursion)
+
+/**
+ * Regular expression compiled into a Thompson NFA and matched with a lazily built DFA.
+ *
+ * Supported syntax: literals, ., [] classes with ranges and negation, \d \w \s and their negations,
+ * (groups), (?:groups), |, *, +, ?, {m}, {m,}, {m,n} and ^, $ anchors. Lazy quantifiers are
+ * accepted, but only whether and where text matches is reported, so they behave as greedy ones.
+ * There are no backreferences and no backtracking, so Dfa::search() is linear in the text size for
+ * any pattern. Dfa::find() is not, see there. Pattern size, nesting and NFA size are bounded, so adversarial patterns are rejected
+ * instead of taking unbounded memory.
+ *
+ * Matching is done on bytes. . and negated classes match whole UTF-8 sequences, other classes
+ * match ASCII characters only. Invalid patterns throw std::runtime_error.
+ */
+class Regex {
+public:
+    static constexpr usize max_pattern_size = 1024;
+    static constexpr usize max_depth = 64;     // Nested groups and quantifiers.
+    static constexpr u32 max_repeat = 1000;    // Bound of {m,n} quantifiers.
+    static constexpr usize max_states = 4096;  // NFA states.
+
+    explicit Regex(std::string_view pattern)
+    {
+        const Node root = Parser{pattern}.parse();
+        m_literals = required_literals(root);
+
+        const u32 match = add_state(State{.m_kind = Kind::match});
+        m_start = compile(root, match);
+
+        // Unanchored search skips any number of bytes before the match starts.
+        m_search_start = add_state(State{.m_kind = Kind::split, .m_next = m_start});
+        const u32 any = add_state(State{.m_kind = Kind::bytes, .m_next = m_search_start});
+        m_states[any].m_bytes.set();
+        m_states[m_search_start].m_alt = any;
+
+        build_byte_classes();
+    }
+
+    /**
+     * Literals that every match contains, in order and without overlaps. Text that doesn't contain
+     * them can be rejected with substring search, before running the DFA.
+     */
+    [[nodiscard]] const std::vector<std::string>& literals() const noexcept { return m_literals; }
+
+    [[nodiscard]] usize states_count() const noexcept { return m_states.size(); }
+
+    /**
+     * Lazily built DFA. DFA states are sets of NFA states and they are built only when a search
+     * first steps into them, so a search never pays for states that the text doesn't reach.
+     * Cache is not thread safe, so every search thread has its own. Cache is cleared when it grows
+     * over max_cache_size, which keeps memory bounded and search() linear, since every byte costs
+     * at most one NFA step.
+     */
+    class Dfa {
+    public:
+        static constexpr usize max_cache_size = usize(1) << 20U;
+
+        explicit Dfa(const Regex& regex) : m_regex{&regex}, m_marks(regex.m_states.size(), 0)
+        {
+            reset();
+        }
+
+        /**
+         * Whether any substring of the text matches.
+         */
+        [[nodiscard]] bool search(std::string_view text)
+        {
+            u32 s = start(Start::search);
+            for (const char c : text) {
+                if (m_states[s].m_match)
+                    return true;
+
+                s = next(s, static_cast<u8>(c));
+            }
+
+            return m_states[s].m_match || m_states[s].m_match_at_end;
+        }
+
+        /**
+         * Leftmost longest match, as [begin, end) offsets into the text. Anchored match is tried
+         * from every offset until one matches, so it is quadratic in the text size in the worst
+         * case. It is meant for short texts that are known to match, like names to highlight.
+         */
+        [[nodiscard]] std::optional<std::pair<usize, usize>> find(std::string_view text)
+        {
+            for (usize begin = 0; begin <= text.size(); ++begin) {
+                std::optional<usize> end;
+
+                u32 s = start(begin == 0 ? Start::text_begin : Start::anchored);
+                for (usize i = begin; s != dead; ++i) {
+                    if (m_states[s].m_match || (i == text.size() && m_states[s].m_match_at_end))
+                        end = i;
+
+                    if (i == text.size())
+                        break;
+
+                    s = next(s, static_cast<u8>(text[i]));
+                }
+
+                if (end)
+                    return std::pair{begin, *end};
+            }
+
+            return std::nullopt;
+        }
+
+        [[nodiscard]] usize states_count() const noexcept { return m_states.size(); }
+
+        [[nodiscard]] usize cache_size() const noexcept { return m_cache_size; }
+
+    private:
+        static constexpr u32 dead = 0;
+        static constexpr u32 unknown = std::numeric_limits<u32>::max();
+
+        enum class Start : u8 { search, text_begin, anchored, count };
+
+        struct State {
+            std::vector<u32> m_set; // Sorted NFA states.
+            bool m_match;           // Match ends at this position.
+            bool m_match_at_end;    // Match ends at this position, if it is the end of the text.
+        };
+
+        void reset()
+        {
+            m_states.clear();
+            m_transitions.clear();
+            m_ids.clear();
+            m_starts.fill(unknown);
+            m_cache_size = 0;
+
+            add({}); // Dead state.
+        }
+
+        u32 start(Start kind)
+        {
+            u32& id = m_starts[usize(kind)];
+            if (id == unknown) {
+                const u32 nfa = kind == Start::search ? m_regex->m_search_start : m_regex->m_start;
+                id = add(closure({&nfa, 1}, kind != Start::anchored, false));
+            }
+
+            return id;
+        }
+
+        u32 next(u32 s, u8 byte)
+        {
+            const usize classes = m_regex->m_classes_count;
+            const usize slot = (s * classes) + m_regex->m_byte_classes[byte];
+            if (m_transitions[slot] != unknown)
+                return m_transitions[slot];
+
+            std::vector<u32> targets;
+            for (const u32 nfa : m_states[s].m_set) {
+                const auto& state = m_regex->m_states[nfa];
+                if (state.m_kind == Kind::bytes && state.m_bytes.test(byte))
+                    targets.push_back(state.m_next);
+            }
+
+            std::vector<u32> set = closure(targets, false, false);
+
+            // Transition is cached only if the cache (and with it s) survived.
+            if (m_cache_size >= max_cache_size) {
+                reset();
+                return add(std::move(set));
+            }
+
+            const u32 id = add(std::move(set));
+            m_transitions[slot] = id;
+            return id;
+        }
+
+        u32 add(std::vector<u32> set)
+        {
+            if (auto it = m_ids.find(set); it != m_ids.end())
+                return it->second;
+
+            bool match = false;
+            std::vector<u32> ends;
+            for (const u32 nfa : set) {
+                match = match || m_regex->m_states[nfa].m_kind == Kind::match;
+                if (m_regex->m_states[nfa].m_kind == Kind::end)
+                    ends.push_back(nfa);
+            }
+
+            bool match_at_end = false;
+            for (const u32 nfa : closure(ends, false, true))
+                match_at_end = match_at_end || m_regex->m_states[nfa].m_kind == Kind::match;
+
+            const auto id = u32(m_states.size());
+            m_cache_size += (set.size() * sizeof(u32) * 2) + sizeof(State) +
+                            (m_regex->m_classes_count * sizeof(u32));
+
+            m_ids.emplace(set, id);
+            m_states.push_back(State{.m_set = std::move(set),
+                                     .m_match = match,
+                                     .m_match_at_end = match_at_end});
+            m_transitions.resize(m_transitions.size() + m_regex->m_classes_count, unknown);
+            return id;
+        }
+
+        /**
+         * NFA states reachable from seeds without consuming a byte. Only states that consume
+         * bytes, wait for the end of the text or match are kept, the rest are just passed through.
+         */
+        std::vector<u32> closure(std::span<const u32> seeds, bool at_begin, bool at_end)
+        {
+            if (++m_mark == 0) {
+                std::ranges::fill(m_marks, 0);
+                m_mark = 1;
+            }
+
+            std::vector<u32> set;
+            std::vector<u32> stack{seeds.begin(), seeds.end()};
+            while (!stack.empty()) {
+                const u32 nfa = stack.back();
+                stack.pop_back();
+
+                if (m_marks[nfa] == m_mark)
+                    continue;
+
+                m_marks[nfa] = m_mark;
+
+                const auto& state = m_regex->m_states[nfa];
+                switch (state.m_kind) {
+                case Kind::split:
+                    stack.push_back(state.m_alt);
+                    stack.push_back(state.m_next);
+                    break;
+                case Kind::epsilon:
+                    stack.push_back(state.m_next);
+                    break;
+                case Kind::begin:
+                    if (at_begin)
+                        stack.push_back(state.m_next);
+                    break;
+                case Kind::end:
+                    if (at_end)
+                        stack.push_back(state.m_next);
+                    else
+                        set.push_back(nfa);
+                    break;
+                case Kind::bytes:
+                case Kind::match:
+                    set.push_back(nfa);
+                    break;
+                }
+            }
+
+            std::ranges::sort(set);
+            return set;
+        }
+
+        const Regex* m_regex;
+        std::vector<State> m_states;
+        std::vector<u32> m_transitions; // Per state and byte class, target state or unknown.
+        std::map<std::vector<u32>, u32> m_ids;
+        std::array<u32, usize(Start::count)> m_starts{};
+        usize m_cache_size = 0;
+
+        std::vector<u32> m_marks; // Per NFA state, last closure that visited it.
+        u32 m_mark = 0;
+    };
+
+private:
+    static constexpr u32 unbounded = std::numeric_limits<u32>::max();
+
+    enum class Kind : u8 { bytes, split, epsilon, begin, end, match };
+
+    struct State {
+        Kind m_kind;
+        u32 m_next = 0;
+        u32 m_alt = 0; // Second target of split.
+        std::bitset<256> m_bytes{};
+    };
+
+    struct Node {
+        enum class Type : u8 { empty, bytes, concat, alternate, repeat, begin, end };
+
+        Type m_type = Type::empty;
+        std::bitset<256> m_bytes{};
+        std::vector<Node> m_children;
+        u32 m_min = 0;
+        u32 m_max = 0;
+    };
+
+    /**
+     * Recursive descent parser of the pattern into a syntax tree.
+     */
+    class Parser {
+    public:
+        explicit Parser(std::string_view pattern) : m_pattern{pattern}
+        {
+            if (pattern.size() > max_pattern_size)
+                throw std::runtime_error("Regex is too long.");
+        }
+
+        Node parse()
+        {
+            Node node = alternate();
+            if (m_pos != m_pattern.size())
+                throw std::runtime_error("Unmatched ).");
+
+            return node;
+        }
+
+    private:
+        Node alternate()
+        {
+            Node node{.m_type = Node::Type::alternate};
+            node.m_children.push_back(concat());
+            while (consume('|'))
+                node.m_children.push_back(concat());
+
+            return node.m_children.size() == 1 ? std::move(node.m_children[0]) : node;
+        }
+
+        Node concat()
+        {
+            Node node{.m_type = Node::Type::concat};
+            while (!done() && peek() != '|' && peek() != ')') {
+                Node child = repeat();
+                if (child.m_type == Node::Type::concat)
+                    std::ranges::move(child.m_children, std::back_inserter(node.m_children));
+                else if (child.m_type != Node::Type::empty)
+                    node.m_children.push_back(std::move(child));
+            }
+
+            if (node.m_children.empty())
+                return Node{};
+
+            return node.m_children.size() == 1 ? std::move(node.m_children[0]) : node;
+        }
+
+        Node repeat()
+        {
+            Node node = atom();
+            usize depth = 0;
+
+            for (;;) {
+                u32 min = 0;
+                u32 max = 0;
+                if (consume('*'))
+                    max = unbounded;
+                else if (consume('+')) {
+                    min = 1;
+                    max = unbounded;
+                }
+                else if (consume('?'))
+                    max = 1;
+                else if (!counted(min, max))
+                    break;
+
+                consume('?'); // Lazy quantifier.
+
+                if (++depth + m_depth > max_depth)
+                    throw std::runtime_error("Regex is nested too deep.");
+
+                Node repeated{.m_type = Node::Type::repeat, .m_min = min, .m_max = max};
+                repeated.m_children.push_back(std::move(node));
+                node = std::move(repeated);
+            }
+
+            return node;
+        }
+
+        /**
+         * Parses {m}, {m,} or {m,n}. Braces that don't form a quantifier are left as literals.
+         */
+        bool counted(u32& min, u32& max)
+        {
+            if (done() || peek() != '{')
+                return false;
+
+            const usize start = m_pos++;
+            const auto number = [&]() -> std::optional<u32> {
+                if (done() || !is_digit(peek()))
+                    return std::nullopt;
+
+                u32 value = 0;
+                while (!done() && is_digit(peek())) {
+                    value = (value * 10) + u32(next() - '0');
+                    if (value > max_repeat)
+                        throw std::runtime_error("Regex repetition count is too big.");
+                }
+
+                return value;
+            };
+
+            const auto lower = number();
+            std::optional<u32> upper = lower;
+            if (lower && consume(','))
+                upper = done() || peek() == '}' ? std::optional{unbounded} : number();
+
+            if (!lower || !upper || !consume('}')) {
+                m_pos = start;
+                return false;
+            }
+
+            if (*upper < *lower)
+                throw std::runtime_error("Invalid regex repetition range.");
+
+            min = *lower;
+            max = *upper;
+            return true;
+        }
+
+        Node atom()
+        {
+            const char c = next();
+            switch (c) {
+            case '(': {
+                if (++m_depth > max_depth)
+                    throw std::runtime_error("Regex is nested too deep.");
+
+                if (consume('?') && !consume(':'))
+                    throw std::runtime_error("Unsupported regex group.");
+
+                Node node = alternate();
+                if (!consume(')'))
+                    throw std::runtime_error("Missing ).");
+
+                --m_depth;
+                return node;
+            }
+            case '[':
+                return char_class();
+            case '.':
+                return negated({});
+            case '^':
+                return Node{.m_type = Node::Type::begin};
+            case '$':
+                return Node{.m_type = Node::Type::end};
+            case '\\':
+                return escape();
+            case '*':
+            case '+':
+            case '?':
+                throw std::runtime_error("Nothing to repeat.");
+            default:
+                return literal(c);
+            }
+        }
+
+        Node escape()
+        {
+            if (done())
+                throw std::runtime_error("Trailing \\.");
+
+            const char c = next();
+            if (std::bitset<256> bytes; escape_class(c, bytes))
+                return is_upper(c) ? negated(bytes) : bytes_node(bytes);
+
+            return literal(escaped(c));
+        }
+
+        /**
+         * Literal character, with all bytes of its UTF-8 sequence.
+         */
+        Node literal(char c)
+        {
+            Node node{.m_type = Node::Type::concat};
+            node.m_children.push_back(byte_node(c));
+
+            const auto lead = static_cast<u8>(c);
+            const usize size = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+            for (usize i = 1; i < size && !done() && (static_cast<u8>(peek()) & 0xC0U) == 0x80;
+                 ++i)
+                node.m_children.push_back(byte_node(next()));
+
+            return node.m_children.size() == 1 ? std::move(node.m_children[0]) : node;
+        }
+
+        Node char_class()
+        {
+            const bool negate = consume('^');
+            std::bitset<256> bytes;
+
+            for (bool first = true; first || done() || peek() != ']'; first = false) {
+                if (done())
+                    throw std::runtime_error("Missing ].");
+
+                char from = next();
+                if (from == '\\') {
+                    if (done())
+                        throw std::runtime_error("Missing ].");
+
+                    from = next();
+                    if (std::bitset<256> escaped_bytes; escape_class(from, escaped_bytes)) {
+                        bytes |= is_upper(from) ? ~escaped_bytes & ascii() : escaped_bytes;
+                        continue;
+                    }
+
+                    from = escaped(from);
+                }
+
+                char to = from;
+                if (m_pos + 1 < m_pattern.size() && peek() == '-' && m_pattern[m_pos + 1] != ']') {
+                    ++m_pos;
+                    to = next();
+                    if (to == '\\' && !done())
+                        to = escaped(next());
+                }
+
+                if (static_cast<u8>(from) >= 0x80 || static_cast<u8>(to) >= 0x80)
+                    throw std::runtime_error("Only ASCII characters are supported in [].");
+
+                if (to < from)
+                    throw std::runtime_error("Invalid regex range.");
+
+                for (auto b = static_cast<usize>(from); b <= static_cast<usize>(to); ++b)
+                    bytes.set(b);
+            }
+
+            ++m_pos; // ]
+            return negate ? negated(bytes) : bytes_node(bytes);
+        }
+
+        static bool escape_class(char c, std::bitset<256>& bytes)
+        {
+            const auto range = [&](char from, char to) {
+                for (auto b = static_cast<usize>(from); b <= static_cast<usize>(to); ++b)
+                    bytes.set(b);
+            };
+
+            switch (c) {
+            case 'd':
+            case 'D':
+                range('0', '9');
+                return true;
+            case 'w':
+            case 'W':
+                range('0', '9');
+                range('a', 'z');
+                range('A', 'Z');
+                bytes.set('_');
+                return true;
+            case 's':
+            case 'S':
+                for (const char space : std::string_view{" \t\n\r\f\v"})
+                    bytes.set(static_cast<u8>(space));
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        static char escaped(char c)
+        {
+            switch (c) {
+            case 't':
+                return '\t';
+            case 'n':
+                return '\n';
+            case 'r':
+                return '\r';
+            default:
+                if (is_digit(c) || is_upper(c) || (c >= 'a' && c <= 'z'))
+                    throw std::runtime_error("Unknown regex escape.");
+
+                return c;
+            }
+        }
+
+        /**
+         * Any character (UTF-8 sequence) that is not in the ASCII bytes.
+         */
+        static Node negated(const std::bitset<256>& bytes)
+        {
+            const auto sequence = [](u8 lead_from, u8 lead_to, usize continuation) {
+                Node node{.m_type = Node::Type::concat};
+                node.m_children.push_back(range_node(lead_from, lead_to));
+                for (usize i = 0; i < continuation; ++i)
+                    node.m_children.push_back(range_node(0x80, 0xBF));
+
+                return node;
+            };
+
+            Node node{.m_type = Node::Type::alternate};
+            node.m_children.push_back(bytes_node(~bytes & ascii()));
+            node.m_children.push_back(sequence(0xC0, 0xDF, 1));
+            node.m_children.push_back(sequence(0xE0, 0xEF, 2));
+            node.m_children.push_back(sequence(0xF0, 0xF7, 3));
+            return node;
+        }
+
+        static std::bitset<256> ascii()
+        {
+            std::bitset<256> bytes;
+            for (usize b = 0; b < 0x80; ++b)
+                bytes.set(b);
+
+            return bytes;
+        }
+
+        static Node bytes_node(const std::bitset<256>& bytes)
+        {
+            return Node{.m_type = Node::Type::bytes, .m_bytes = bytes};
+        }
+
+        static Node byte_node(char c)
+        {
+            std::bitset<256> bytes;
+            bytes.set(static_cast<u8>(c));
+            return bytes_node(bytes);
+        }
+
+        static Node range_node(u8 from, u8 to)
+        {
+            std::bitset<256> bytes;
+            for (usize b = from; b <= to; ++b)
+                bytes.set(b);
+
+            return bytes_node(bytes);
+        }
+
+        static bool is_digit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+        static bool is_upper(char c) noexcept { return c >= 'A' && c <= 'Z'; }
+
+        [[nodiscard]] bool done() const noexcept { return m_pos == m_pattern.size(); }
+
+        [[nodiscard]] char peek() const noexcept { return m_pattern[m_pos]; }
+
+        char next()
+        {
+            if (done())
+                throw std::runtime_error("Unexpected end of regex.");
+
+            return m_pattern[m_pos++];
+        }
+
+        bool consume(char c) noexcept
+        {
+            if (done() || peek() != c)
+                return false;
+
+            ++m_pos;
+            return true;
+        }
+
+        std::string_view m_pattern;
+        usize m_pos = 0;
+        usize m_depth = 0;
+    };
+
+    u32 add_state(const State& state)
+    {
+        if (m_states.size() == max_states)
+            throw std::runtime_error("Regex is too big.");
+
+        m_states.push_back(state);
+        return u32(m_states.size() - 1);
+    }
+
+    /**
+     * Compiles node into NFA states that continue to next, and returns the first of them. Every
+     * node adds at least one state, so compile time is bounded by max_states too.
+     */
+    u32 compile(const Node& node, u32 next)
+    {
+        switch (node.m_type) {
+        case Node::Type::empty:
+            return add_state(State{.m_kind = Kind::epsilon, .m_next = next});
+        case Node::Type::bytes:
+            return add_state(State{.m_kind = Kind::bytes, .m_next = next, .m_bytes = node.m_bytes});
+        case Node::Type::begin:
+            return add_state(State{.m_kind = Kind::begin, .m_next = next});
+        case Node::Type::end:
+            return add_state(State{.m_kind = Kind::end, .m_next = next});
+        case Node::Type::concat:
+            for (const Node& child : node.m_children | std::views::reverse)
+                next = compile(child, next);
+
+            return next;
+        case Node::Type::alternate: {
+            u32 first = compile(node.m_children.back(), next);
+            for (usize i = node.m_children.size() - 1; i-- > 0;) {
+                const u32 alt = compile(node.m_children[i], next);
+                first = add_state(State{.m_kind = Kind::split, .m_next = alt, .m_alt = first});
+            }
+
+            return first;
+        }
+        case Node::Type::repeat: {
+            const Node& child = node.m_children[0];
+            u32 first = next;
+
+            if (node.m_max == unbounded) {
+                first = add_state(State{.m_kind = Kind::split, .m_alt = next});
+                const u32 body = compile(child, first);
+                m_states[first].m_next = body;
+            }
+            else {
+                for (u32 i = node.m_min; i < node.m_max; ++i) {
+                    const u32 body = compile(child, first);
+                    first = add_state(State{.m_kind = Kind::split, .m_next = body, .m_alt = next});
+                }
+            }
+
+            for (u32 i = 0; i < node.m_min; ++i)
+                first = compile(child, first);
+
+            if (first == next)
+                first = add_state(State{.m_kind = Kind::epsilon, .m_next = next}); // x{0}
+
+            return first;
+        }
+        }
+
+        unreachable();
+    }
+
+    /**
+     * Literal runs of the top level concatenation. Anchors don't break runs, and a repeated
+     * literal is required once, but it can't be extended by the node that follows it.
+     */
+    static std::vector<std::string> required_literals(const Node& root)
+    {
+        const std::span<const Node> nodes = root.m_type == Node::Type::concat ?
+                                                std::span<const Node>{root.m_children} :
+                                                std::span<const Node>{&root, 1};
+
+        std::vector<std::string> literals;
+        std::string run;
+        const auto flush = [&] {
+            if (!run.empty())
+                literals.push_back(std::move(run));
+
+            run.clear();
+        };
+
+        for (const Node& node : nodes) {
+            if (node.m_type == Node::Type::begin || node.m_type == Node::Type::end)
+                continue;
+
+            if (const auto l = literal(node); l) {
+                run += *l;
+                continue;
+            }
+
+            if (node.m_type == Node::Type::repeat && node.m_min > 0) {
+                if (const auto l = literal(node.m_children[0]); l)
+                    run += *l;
+            }
+
+            flush();
+        }
+
+        flush();
+        return literals;
+    }
+
+    static std::optional<std::string> literal(const Node& node)
+    {
+        if (node.m_type == Node::Type::bytes && node.m_bytes.count() == 1) {
+            for (usize b = 0;; ++b)
+                if (node.m_bytes.test(b))
+                    return std::string(1, static_cast<char>(b));
+        }
+
+        if (node.m_type != Node::Type::concat)
+            return std::nullopt;
+
+        std::string result;
+        for (const Node& child : node.m_children) {
+            const auto l = literal(child);
+            if (!l)
+                return std::nullopt;
+
+            result += *l;
+        }
+
+        return result;
+    }
+
+    /**
+     * Splits bytes into classes of bytes that no NFA state tells apart, so DFA states store a
+     * transition per class instead of per byte.
+     */
+    void build_byte_classes()
+    {
+        m_byte_classes.fill(0);
+        m_classes_count = 1;
+
+        std::vector<std::bitset<256>> seen;
+        for (const State& state : m_states) {
+            if (state.m_kind != Kind::bytes || std::ranges::find(seen, state.m_bytes) != seen.end())
+                continue;
+
+            seen.push_back(state.m_bytes);
+
+            // New class per (old class, in set) pair.
+            std::array<std::array<u32, 2>, 256> split{};
+            for (auto& s : split)
+                s.fill(std::numeric_limits<u32>::max());
+
+            u32 count = 0;
+            for (usize b = 0; b < 256; ++b) {
+                u32& id = split[m_byte_classes[b]][state.m_bytes.test(b) ? 1 : 0];
+                if (id == std::numeric_limits<u32>::max())
+                    id = count++;
+
+                m_byte_classes[b] = u8(id);
+            }
+
+            m_classes_count = count;
+        }
+    }
+
+    std::vector<State> m_states;
+    u32 m_start = 0;        // Anchored start, match must start at the current position.
+    u32 m_search_start = 0; // Unanchored start, match can start anywhere.
+    std::vector<std::string> m_literals;
+
+    std::array<u8, 256> m_byte_classes{};
+    usize m_classes_count = 1;
+};
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index, misc-no-recursion)
+
+#endif // FINDER_REGEX_HPP
@@ -0,0 +1,167 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_SESSION_HPP
+#define FINDER_SESSION_HPP
+
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "os.hpp"
+#include "types.hpp"
+#include "util.hpp"
+
+/**
+ * Recorded interactive session. It holds everything needed to replay user input against a new
+ * build: index info (so we can detect that replay runs on a different index), terminal size and
+ * all console inputs with delays between them.
+ *
+ * Session is stored as a simple line based text file:
+ *
+ * finder-session 1
+ * root /
+ * files 1234567
+ * generation 1234567
+ * terminal 120 40
+ * key 153000 102        <- delay in microseconds, input character
+ * resize 2000 100 30    <- delay in microseconds, new terminal size
+ */
+class Session {
+public:
+    static constexpr u32 version = 1;
+
+    struct Event {
+        microseconds m_delay;
+        os::ConsoleInput m_input;
+    };
+
+    std::string m_root;
+    usize m_files_count = 0;
+    u64 m_generation = 0;
+    os::Coordinates m_terminal{.x = 0, .y = 0};
+    std::vector<Event> m_events;
+
+    /**
+     * Loads session from file. Throws if file can't be opened or it is not a valid session file.
+     */
+    static Session load(const std::string& path)
+    {
+        std::ifstream in{path};
+        if (!in.is_open())
+            throw std::runtime_error{std::format("Failed to open session file {}.", path)};
+
+        Session session;
+        std::string line;
+
+        if (!std::getline(in, line) || line != std::format("finder-session {}", version))
+            throw std::runtime_error{std::format("Invalid session file {}.", path)};
+
+        for (usize line_num = 2; std::getline(in, line); ++line_num) {
+            std::istringstream ls{line};
+            std::string tag;
+            if (!(ls >> tag))
+                continue; // Blank line.
+
+            if (tag == "root") {
+                std::getline(ls >> std::ws, session.m_root);
+            }
+            else if (tag == "files") {
+                ls >> session.m_files_count;
+            }
+            else if (tag == "generation") {
+                ls >> session.m_generation;
+            }
+            else if (tag == "terminal") {
+                ls >> session.m_terminal.x >> session.m_terminal.y;
+            }
+            else if (tag == "key") {
+                i64 delay = 0;
+                i32 ch = 0;
+                ls >> delay >> ch;
+                session.m_events.push_back(Event{microseconds{delay}, ch});
+            }
+            else if (tag == "resize") {
+                i64 delay = 0;
+                os::Coordinates c{};
+                ls >> delay >> c.x >> c.y;
+                session.m_events.push_back(Event{microseconds{delay}, c});
+            }
+            else {
+                throw std::runtime_error{
+                    std::format("Invalid session file {}, line {}.", path, line_num)};
+            }
+
+            if (ls.fail())
+                throw std::runtime_error{
+                    std::format("Invalid session file {}, line {}.", path, line_num)};
+        }
+
+        return session;
+    }
+};
+
+/**
+ * Records console inputs of an interactive session into a session file.
+ * Every event is flushed immediately, so session survives crashes, which are exactly the
+ * sessions we want to replay.
+ */
+class Session_recorder {
+public:
+    Session_recorder(const std::string& path, const std::string& root, usize files_count,
+                     u64 generation, os::Coordinates terminal)
+        : m_out{path, std::ios_base::trunc}
+        , m_last{now()}
+    {
+        if (!m_out.is_open())
+            throw std::runtime_error{std::format("Failed to create session file {}.", path)};
+
+        m_out << std::format("finder-session {}\n", Session::version);
+        m_out << std::format("root {}\n", root);
+        m_out << std::format("files {}\n", files_count);
+        m_out << std::format("generation {}\n", generation);
+        m_out << std::format("terminal {} {}\n", terminal.x, terminal.y);
+        m_out.flush();
+    }
+
+    void record(const os::ConsoleInput& input)
+    {
+        const Time_point t = now();
+        const i64 delay = duration_cast<microseconds>(t - m_last).count();
+        m_last = t;
+
+        if (std::holds_alternative<os::Coordinates>(input)) {
+            const auto& c = std::get<os::Coordinates>(input);
+            m_out << std::format("resize {} {} {}\n", delay, c.x, c.y);
+        }
+        else {
+            m_out << std::format("key {} {}\n", delay, std::get<i32>(input));
+        }
+
+        m_out.flush();
+    }
+
+private:
+    std::ofstream m_out;
+    Time_point m_last;
+};
+
+#endif // FINDER_SESSION_HPP
@@ -20,66 +20,84 @@
 
 #include <filesystem>
 #include <memory>
+#include <memory_resource>
 #include <ranges>
+#include <string>
 #include <vector>
 
 #include "files.hpp"
-#include "small_string.hpp"
+#include "memory.hpp"
 #include "util.hpp"
 
 // NOLINTBEGIN
 
+/**
+ * All symbol structures allocate from the memory resources of Symbols that owns them. Strings and
+ * symbols live in the Symbols arena, and vectors in the Symbols pool, so they are never freed one
+ * by one.
+ */
 class Line {
 public:
-    Line(usize line_number, const std::string& preview) : m_number{line_number}, m_preview{preview}
+    Line(usize line_number, std::string_view preview) : m_number{line_number}, m_preview{preview}
     {
     }
 
     usize number() const noexcept { return m_number; }
 
-    const char* preview() const noexcept { return m_preview; }
+    const char* preview() const noexcept { return m_preview.data(); }
 
 private:
     usize m_number;
-    stl::SmallString m_preview; // Line preview which will be displayed with symbol in print.
+    std::string_view m_preview; // Line preview which will be displayed with symbol in print.
 };
 
 class Symbol_file_refs {
 public:
-    Symbol_file_refs(FileInfo* file, usize line, const std::string& preview)
+    Symbol_file_refs(File_id file, usize line, std::string_view preview,
+                     std::pmr::memory_resource* memory)
         : m_file{file}
-        , m_lines{Line{line, preview}}
+        , m_lines{memory}
     {
+        m_lines.emplace_back(line, preview);
     }
 
-    const FileInfo* file() const noexcept { return m_file; }
+    File_id file() const noexcept { return m_file; }
 
-    const std::vector<Line>& lines() const noexcept { return m_lines; }
+    const std::pmr::vector<Line>& lines() const noexcept { return m_lines; }
 
-    std::vector<Line>& lines() noexcept { return m_lines; }
+    std::pmr::vector<Line>& lines() noexcept { return m_lines; }
 
 private:
-    FileInfo* m_file;
-    std::vector<Line> m_lines;
+    File_id m_file;
+    std::pmr::vector<Line> m_lines;
 };
 
 class Symbol {
 public:
-    Symbol(const std::string& name, FileInfo* file, usize line_number, const std::string& preview)
+    Symbol(std::string_view name, File_id file, usize line_number, std::string_view preview,
+           std::pmr::memory_resource* memory)
         : m_name{name}
-        , m_refs{Symbol_file_refs{file, line_number, preview}}
+        , m_refs{memory}
     {
+        m_refs.emplace_back(file, line_number, preview, memory);
     }
 
-    [[nodiscard]] const char* name() const noexcept { return m_name; }
+    [[nodiscard]] const char* name() const noexcept { return m_name.data(); }
 
     [[nodiscard]] const auto& refs() const noexcept { return m_refs; }
 
     auto& refs() noexcept { return m_refs; }
 
 private:
-    stl::SmallString m_name;
-    std::vector<Symbol_file_refs> m_refs;
+    std::string_view m_name; // Null terminated, stored in the Symbols arena.
+    std::pmr::vector<Symbol_file_refs> m_refs;
+};
+
+/**
+ * Destroys symbol allocated from the Symbols arena. Memory itself is released with the arena.
+ */
+struct Symbol_deleter {
+    void operator()(Symbol* symbol) const noexcept { std::destroy_at(symbol); }
 };
 
 /**
@@ -110,7 +128,7 @@ private:
 
 class Symbols {
 public:
-    result insert(const std::string& symbol_name, FileInfo* file, usize line_number,
+    result insert(const std::string& symbol_name, File_id file, usize line_number,
                   const std::string& line_preview)
     {
         auto* r = m_symbol_finder.search(symbol_name);
@@ -126,23 +144,27 @@ public:
             sym_refs, [&](Symbol_file_refs& ref) { return ref.file() == file; });
 
         if (files_it == sym_refs.end()) {
-            sym_refs.emplace_back(file, line_number, line_preview);
+            sym_refs.emplace_back(file, line_number, store_preview(line_preview), m_pool.get());
             return {symbol, false};
         }
 
         auto& lines = files_it->lines();
         if (std::ranges::find_if(lines, [&](const Line& l) { return l.number() == line_number; }) ==
             lines.end())
-            lines.push_back(Line{line_number, line_preview});
+            lines.emplace_back(line_number, store_preview(line_preview));
 
         return {symbol, false};
     }
 
-    result insert_non_existing(const std::string& symbol, FileInfo* file, usize line,
+    result insert_non_existing(const std::string& symbol, File_id file, usize line,
                                const std::string& preview)
     {
-        m_symbols.push_back(std::make_unique<Symbol>(symbol, file, line, preview));
-        Symbol* new_symbol = m_symbols.back().get();
+        Arena& arena = m_arenas->local();
+        std::pmr::polymorphic_allocator<Symbol> alloc{&arena};
+
+        Symbol* new_symbol = alloc.new_object<Symbol>(arena.store(symbol), file, line,
+                                                      store_preview(preview), m_pool.get());
+        m_symbols.emplace_back(new_symbol);
 
         m_symbol_finder.insert(new_symbol->name(), new_symbol);
         // m_symbol_searcher.insert_suffix(new_symbol->name(), new_symbol);
@@ -150,7 +172,7 @@ public:
         return {new_symbol, true};
     }
 
-    void erase(const std::string& symbol_name, FileInfo* file, usize line_number)
+    void erase(const std::string& symbol_name, File_id file, usize line_number)
     {
         auto* r = m_symbol_finder.search(symbol_name);
         if (r == nullptr)
@@ -179,7 +201,7 @@ public:
             m_symbol_finder.erase(symbol_name);
 
         auto symbols_it =
-            std::ranges::find_if(m_symbols, [&](std::unique_ptr<Symbol>& unique_symbol) {
+            std::ranges::find_if(m_symbols, [&](Symbol_ptr& unique_symbol) {
                 return unique_symbol.get() == symbol;
             });
 
@@ -187,17 +209,65 @@ public:
         m_symbols.erase(symbols_it);
     }
 
+    /**
+     * Erases references to the erased files (sorted), before their ids are reused by other files.
+     * Symbols left without references are erased. All symbols are visited, so erased files should
+     * be collected and erased at once.
+     */
+    void erase_files(const std::vector<File_id>& files)
+    {
+        if (files.empty())
+            return;
+
+        usize kept = 0;
+        for (usize i = 0; i < m_symbols.size(); ++i) {
+            auto& sym_refs = m_symbols[i]->refs();
+            std::erase_if(sym_refs, [&](const Symbol_file_refs& ref) {
+                return std::ranges::binary_search(files, ref.file());
+            });
+
+            if (sym_refs.empty()) {
+                m_symbol_finder.erase(m_symbols[i]->name());
+                continue;
+            }
+
+            if (kept != i)
+                m_symbols[kept] = std::move(m_symbols[i]);
+
+            ++kept;
+        }
+
+        m_symbols.resize(kept);
+    }
+
+    /**
+     * Stores line preview in the arena. All symbols of a line share the same preview, so we
+     * reuse the last stored one if line didn't change.
+     */
+    std::string_view store_preview(std::string_view preview)
+    {
+        if (preview != m_last_preview)
+            m_last_preview = m_arenas->local().store(preview);
+
+        return m_last_preview;
+    }
+
     Symbol* search(const std::string& symbol_name)
     {
         auto* symbol = m_symbol_finder.search(symbol_name);
         return symbol != nullptr ? symbol->value() : nullptr;
     }
 
+    /**
+     * Memory used by symbols, their file references, lines and previews, with allocator slack.
+     */
     auto symbols_size()
     {
-        return m_symbols.size() * (sizeof(std::unique_ptr<Symbol>) + sizeof(Symbol));
+        return m_symbols.capacity() * sizeof(Symbol_ptr) + m_memory->stats().usable();
     }
 
+    [[nodiscard]] const Memory_stats& memory_stats() const noexcept { return m_memory->stats(); }
+
     auto symbol_finder_size(bool full_leaves = true)
     {
         return m_symbol_finder.size_in_bytes(full_leaves);
@@ -208,6 +278,10 @@ public:
         std::cout << "---------------------------------------\n";
         std::cout << "Symbols count: " << m_symbols.size() << "\n";
 
+        std::cout << std::format("Symbols arena: {} bytes used, {} bytes reserved\n",
+                                 m_arenas->used(), m_arenas->reserved());
+        std::cout << "Symbols memory:\n" << m_memory->stats().report();
+
         std::cout << "Symbol finder stats:\n";
         m_symbol_finder.print_stats();
 
@@ -217,7 +291,23 @@ public:
     }
 
 public:
-    std::vector<std::unique_ptr<Symbol>> m_symbols;
+    using Symbol_ptr = std::unique_ptr<Symbol, Symbol_deleter>;
+
+    // Memory resources must outlive all symbol structures, so they are declared first.
+
+    // Counts allocations of all symbol structures.
+    std::unique_ptr<Tracking_resource> m_memory = std::make_unique<Tracking_resource>();
+
+    // Per thread arenas holding symbols, symbol names and line previews.
+    std::unique_ptr<Arena_pool> m_arenas = std::make_unique<Arena_pool>(m_memory.get());
+
+    // Pools for symbol file refs and lines, which grow and shrink, so they can't use the arena.
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> m_pool =
+        std::make_unique<std::pmr::unsynchronized_pool_resource>(m_memory.get());
+
+    std::string_view m_last_preview; // Last stored line preview.
+
+    std::vector<Symbol_ptr> m_symbols;
 
     /**
      * Trie that holds all suffixes of all symbols, which enables symbol search by symbol name.
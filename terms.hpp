@@ -0,0 +1,179 @@
+/**
+ * Copyright 2025, Aleksandar Colic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef FINDER_TERMS_HPP
+#define FINDER_TERMS_HPP
+
+#include <charconv>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "types.hpp"
+
+/**
+ * Single term of a query. Query is a conjunction of terms separated by spaces:
+ *   name      - file name (or path/name) pattern with * wildcards, as a single term query
+ *   ^name     - name pattern that matches from the start of the file name
+ *   ext:cpp   - file extension is exactly cpp
+ *   dir:src   - file is in a directory whose name contains src, at any depth
+ *   size>10M  - file is larger (or with <, smaller) than 10 MiB; units are k, M, G and T
+ *   mtime<2h  - file was modified less (or with >, more) than 2 hours ago; units are s, m, h, d
+ *               and w
+ *   type:f    - entry is a file (f) or a directory (d)
+ * Any term can be negated with a ! prefix, and quotes keep spaces inside a term ("my file").
+ * Metadata terms (size, mtime and type) with malformed values are name terms.
+ */
+struct Query_term {
+    enum class Kind : u8 { name, ext, dir, size, mtime, type };
+
+    Kind m_kind = Kind::name;
+    bool m_negated = false;
+    bool m_anchored = false; // Name term that matches from the start of the name.
+    std::string m_text;
+
+    char m_op = 0;   // Comparison of size and mtime terms, < or >.
+    u64 m_value = 0; // Bytes of size terms, seconds of mtime terms.
+};
+
+/**
+ * Parses a number with an optional unit suffix (10M, 2h). Units and scales are parallel, and
+ * number without a unit is taken as is. Returns nullopt if text is malformed or overflows.
+ */
+inline std::optional<u64> parse_quantity(std::string_view text, std::string_view units,
+                                         const u64* scales)
+{
+    u64 value = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end == text.data())
+        return std::nullopt;
+
+    const std::string_view unit{end, text.data() + text.size()};
+    if (unit.empty())
+        return value;
+
+    const usize pos = units.find(unit);
+    if (unit.size() != 1 || pos == std::string_view::npos)
+        return std::nullopt;
+
+    if (value > std::numeric_limits<u64>::max() / scales[pos])
+        return std::nullopt;
+
+    return value * scales[pos];
+}
+
+/**
+ * Parses unquoted metadata term text (without negation) into term. Returns false if text is not a
+ * well formed metadata term.
+ */
+inline bool parse_metadata_term(std::string_view text, Query_term& term)
+{
+    static constexpr u64 size_scales[] = {u64(1) << 10, u64(1) << 10, u64(1) << 20,
+                                          u64(1) << 30, u64(1) << 40};
+    static constexpr u64 mtime_scales[] = {1, 60, 3600, 86400, 604800};
+
+    if (text == "type:f" || text == "type:d") {
+        term.m_kind = Query_term::Kind::type;
+        term.m_text = text.substr(5);
+        return true;
+    }
+
+    std::optional<u64> value;
+    if (text.starts_with("size>") || text.starts_with("size<")) {
+        term.m_kind = Query_term::Kind::size;
+        term.m_op = text[4];
+        value = parse_quantity(text.substr(5), "kKMGT", size_scales);
+    }
+    else if (text.starts_with("mtime>") || text.starts_with("mtime<")) {
+        term.m_kind = Query_term::Kind::mtime;
+        term.m_op = text[5];
+        value = parse_quantity(text.substr(6), "smhdw", mtime_scales);
+    }
+
+    if (!value) {
+        term.m_kind = Query_term::Kind::name;
+        term.m_op = 0;
+        return false;
+    }
+
+    term.m_text = text;
+    term.m_value = *value;
+    return true;
+}
+
+/**
+ * Splits query into terms. Empty terms (repeated spaces, "" or a bare !) are dropped.
+ */
+inline std::vector<Query_term> parse_terms(std::string_view query)
+{
+    std::vector<Query_term> terms;
+
+    const auto add = [&](std::string text, bool quoted) {
+        Query_term term;
+        if (!quoted && text.starts_with('!')) {
+            term.m_negated = true;
+            text.erase(0, 1);
+        }
+
+        if (!quoted && parse_metadata_term(text, term)) {
+            terms.push_back(std::move(term));
+            return;
+        }
+
+        if (!quoted && text.size() > 4 && (text.starts_with("ext:") || text.starts_with("dir:"))) {
+            term.m_kind = text.starts_with("ext:") ? Query_term::Kind::ext : Query_term::Kind::dir;
+            text.erase(0, 4);
+        }
+
+        if (term.m_kind == Query_term::Kind::ext && text.starts_with('.'))
+            text.erase(0, 1);
+
+        if (!quoted && term.m_kind == Query_term::Kind::name && text.starts_with('^')) {
+            term.m_anchored = true;
+            text.erase(0, 1);
+        }
+
+        term.m_text = std::move(text);
+        if (!term.m_text.empty())
+            terms.push_back(std::move(term));
+    };
+
+    std::string text;
+    bool quoted = false; // Term started with a quote.
+    bool in_quotes = false;
+    for (const char c : query) {
+        if (c == '"') {
+            quoted = quoted || text.empty();
+            in_quotes = !in_quotes;
+        }
+        else if (c == ' ' && !in_quotes) {
+            add(std::move(text), quoted);
+            text.clear();
+            quoted = false;
+        }
+        else {
+            text += c;
+        }
+    }
+
+    add(std::move(text), quoted);
+    return terms;
+}
+
+#endif // FINDER_TERMS_HPP
@@ -0,0 +1,117 @@
+#include <format>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "access_log.hpp"
+#include "files.hpp"
+#include "os.hpp"
+
+// NOLINTBEGIN
+
+static constexpr i64 secs_per_day = 24 * 3600;
+
+TEST(access_log_test, frecency)
+{
+    Access_log log;
+    const i64 now = 1'000'000'000;
+
+    ASSERT_TRUE(log.score("/a/b.txt", now) == 0.0);
+    ASSERT_TRUE(log.record("/a/b.txt", now) == 1.0);
+    ASSERT_TRUE(log.record("/a/b.txt", now) == 2.0);
+    ASSERT_TRUE(log.score("/a/c.txt", now) == 0.0);
+
+    // Scores halve every half life, and picks add to the decayed score.
+    const i64 later = now + i64(Access_log::half_life);
+    ASSERT_NEAR(log.score("/a/b.txt", later), 1.0, 1e-9);
+    ASSERT_NEAR(log.record("/a/b.txt", later), 2.0, 1e-9);
+
+    // Hash continues from a hash of the path prefix.
+    ASSERT_TRUE(Access_log::hash("b.txt", Access_log::hash("/a/")) == Access_log::hash("/a/b.txt"));
+
+    // Full table evicts the lowest scores, and keeps the frequently picked files.
+    for (usize i = 0; i < Access_log::capacity * 2; ++i)
+        log.record(std::format("/tmp/file_{}", i), later);
+
+    ASSERT_NEAR(log.score("/a/b.txt", later), 2.0, 1e-9);
+}
+
+TEST(access_log_test, recent_dirs)
+{
+    const std::string sep = os::path_sep_str;
+    const i64 now = 1'000'000'000;
+
+    Access_log log;
+    ASSERT_TRUE(log.recent_dirs().empty());
+
+    log.record(sep + "a" + sep + "x.txt", now);
+    log.record(sep + "b" + sep + "y.txt", now);
+    log.record(sep + "a" + sep + "z.txt", now);
+    log.record("name_only.txt", now);
+
+    // Most recent first, and each directory once.
+    auto dirs = log.recent_dirs();
+    ASSERT_TRUE(dirs.size() == 2);
+    ASSERT_TRUE(dirs[0] == sep + "a" && dirs[1] == sep + "b");
+
+    for (usize i = 0; i < Access_log::recent_count; ++i)
+        log.record(std::format("{}dir_{}{}f.txt", sep, i, sep), now);
+
+    dirs = log.recent_dirs();
+    ASSERT_TRUE(dirs.size() == Access_log::recent_count);
+    ASSERT_TRUE(dirs.front() == std::format("{}dir_{}", sep, Access_log::recent_count - 1));
+    ASSERT_TRUE(dirs.back() == sep + "dir_0");
+}
+
+TEST(access_log_test, ranking)
+{
+    const std::string path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    Files files;
+    for (usize i = 0; i < 200; ++i)
+        files.insert(path + std::format("notes_{}.txt", i));
+
+    auto r = files.search("notes");
+    ASSERT_TRUE(r.size() == Files::objects_max && r.objects_count() == 200);
+    ASSERT_TRUE(r[0].name() == "notes_0.txt");
+
+    const i64 now = 1'000'000'000;
+    Access_log log;
+    log.record(path + "notes_150.txt", now - (30 * secs_per_day));
+    log.record(path + "notes_199.txt", now);
+    log.record(path + "notes_199.txt", now);
+    log.record(path + "notes_100.txt", now);
+    log.apply(files, now);
+
+    // Picked files are ranked first, even when they are found after results are full.
+    r = files.search("notes");
+    ASSERT_TRUE(r.size() == Files::objects_max && r.objects_count() == 200);
+    ASSERT_TRUE(r[0].name() == "notes_199.txt");
+    ASSERT_TRUE(r[1].name() == "notes_100.txt");
+    ASSERT_TRUE(r[2].name() == "notes_150.txt");
+    ASSERT_TRUE(r[3].name() == "notes_0.txt");
+    ASSERT_TRUE(r[0].match_bs()[path.size()]);
+
+    // Ranking doesn't depend on how the search is split.
+    Files::Matches merged;
+    for (usize i = 0; i < 4; ++i)
+        merged.insert(files.partial_search(files.compile("notes"), 4, i));
+
+    ASSERT_TRUE(merged.objects_count() == 200);
+    for (usize i = 0; i < Files::objects_max; ++i)
+        ASSERT_TRUE(merged[i].id() == r[i].id());
+
+    ASSERT_TRUE(files.search("notes_15").objects_count() == 11);
+    ASSERT_TRUE(files.search("notes_15")[0].name() == "notes_150.txt");
+
+    // Erased file loses its boost, and its slot is reused without it.
+    files.erase(path + "notes_199.txt");
+    files.insert(path + "notes_new.txt");
+    ASSERT_TRUE(files.search("notes")[0].name() == "notes_100.txt");
+}
+
+// NOLINTEND
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "bitmap.hpp"
+#include "util.hpp"
+
+// NOLINTBEGIN
+
+static std::vector<u32> ids(const Id_bitmap& bitmap, u32 begin = 0, u32 end = ~u32(0))
+{
+    std::vector<u32> v;
+    bitmap.for_each(begin, end, [&](u32 id) { v.push_back(id); });
+    return v;
+}
+
+TEST(bitmap_test, sparse)
+{
+    Id_bitmap bitmap;
+    ASSERT_TRUE(bitmap.empty());
+
+    bitmap.insert(5);
+    bitmap.insert(70'000);
+    bitmap.insert(1);
+    bitmap.insert(5);
+    ASSERT_TRUE(bitmap.count() == 3);
+    ASSERT_TRUE(bitmap.contains(70'000));
+    ASSERT_TRUE(!bitmap.contains(4));
+    ASSERT_TRUE(ids(bitmap) == (std::vector<u32>{1, 5, 70'000}));
+    ASSERT_TRUE(ids(bitmap, 2, 70'000) == (std::vector<u32>{5}));
+
+    bitmap.erase(70'000);
+    bitmap.erase(70'001);
+    ASSERT_TRUE(ids(bitmap) == (std::vector<u32>{1, 5}));
+
+    bitmap.erase(1);
+    bitmap.erase(5);
+    ASSERT_TRUE(bitmap.empty());
+}
+
+TEST(bitmap_test, dense)
+{
+    Id_bitmap bitmap;
+    for (u32 i = 0; i < 10'000; ++i)
+        bitmap.insert(i * 3);
+
+    ASSERT_TRUE(bitmap.count() == 10'000);
+    ASSERT_TRUE(bitmap.contains(9'999 * 3));
+    ASSERT_TRUE(!bitmap.contains(9'999 * 3 + 1));
+    ASSERT_TRUE(ids(bitmap, 30, 40) == (std::vector<u32>{30, 33, 36, 39}));
+
+    // Dense container goes back to sparse when most of the ids are erased.
+    for (u32 i = 0; i < 9'000; ++i)
+        bitmap.erase(i * 3);
+
+    ASSERT_TRUE(bitmap.count() == 1'000);
+    ASSERT_TRUE(ids(bitmap).front() == 27'000);
+    ASSERT_TRUE(bitmap.size_in_bytes() < 8 * 1024);
+}
+
+TEST(bitmap_test, unite_and_intersect)
+{
+    Id_bitmap a;
+    Id_bitmap b;
+    for (u32 i = 0; i < 6'000; ++i) {
+        a.insert(i * 2);
+        b.insert(i * 3);
+    }
+
+    Id_bitmap u = a;
+    u.unite(b);
+    ASSERT_TRUE(u.count() == 6'000 + 6'000 - 2'000);
+
+    Id_bitmap i = a;
+    i.intersect(b);
+    ASSERT_TRUE(i.count() == 2'000);
+    ASSERT_TRUE(ids(i, 0, 13) == (std::vector<u32>{0, 6, 12}));
+
+    Id_bitmap sparse;
+    sparse.insert(3);
+    sparse.insert(4);
+    sparse.insert(70'000);
+    sparse.insert(140'000);
+
+    Id_bitmap dense = a; // Dense and sparse, and containers missing on either side.
+    dense.insert(140'000);
+    dense.intersect(sparse);
+    ASSERT_TRUE(ids(dense) == (std::vector<u32>{4, 140'000}));
+
+    sparse.intersect(a); // Sparse and dense.
+    ASSERT_TRUE(ids(sparse) == (std::vector<u32>{4}));
+}
+
+TEST(bitmap_test, subtract)
+{
+    Id_bitmap a;
+    Id_bitmap b;
+    for (u32 i = 0; i < 6'000; ++i) {
+        a.insert(i * 2);
+        b.insert(i * 3);
+    }
+
+    Id_bitmap d = a; // Dense minus dense.
+    d.subtract(b);
+    ASSERT_TRUE(d.count() == 4'000);
+    ASSERT_TRUE(ids(d, 0, 13) == (std::vector<u32>{2, 4, 8, 10}));
+
+    Id_bitmap sparse;
+    sparse.insert(2);
+    sparse.insert(70'000);
+
+    d.subtract(sparse); // Dense minus sparse, and a missing container.
+    ASSERT_TRUE(d.count() == 3'999);
+    ASSERT_TRUE(!d.contains(2));
+
+    sparse.subtract(a); // Sparse minus dense, container emptied.
+    ASSERT_TRUE(sparse.count() == 1);
+    ASSERT_TRUE(sparse.contains(70'000));
+}
+
+// NOLINTEND
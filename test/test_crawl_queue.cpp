@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "crawl_queue.hpp"
+#include "os.hpp"
+
+// NOLINTBEGIN
+
+// Path with separators of the platform.
+static std::string native(std::string path)
+{
+    std::ranges::replace(path, '/', os::path_sep);
+    return path;
+}
+
+static std::vector<std::string> order(const Crawl_queue& queue)
+{
+    std::vector<std::string> paths;
+    for (const Crawl_queue::Dir& dir : queue.dirs())
+        paths.push_back(dir.m_path);
+
+    return paths;
+}
+
+TEST(crawl_queue_test, priority_order)
+{
+    using Priority = Crawl_queue::Priority;
+
+    Crawl_queue queue{native("/")};
+    ASSERT_TRUE(order(queue) == std::vector<std::string>{native("/")});
+
+    ASSERT_TRUE(queue.add(native("/usr"), Priority::cold));
+    ASSERT_TRUE(queue.add(native("/home/user/src/"), Priority::hot));
+    ASSERT_TRUE(queue.add(native("/home/user"), Priority::hot));
+    ASSERT_TRUE(queue.add(native("/var"), Priority::cold));
+
+    // Scheduled once, with the first priority, and trailing separators don't matter.
+    ASSERT_TRUE(!queue.add(native("/home/user/"), Priority::cold));
+    ASSERT_TRUE(!queue.add(native("/"), Priority::hot));
+    ASSERT_TRUE(queue.size() == 5);
+
+    const std::vector<std::string> expected{native("/home/user/src"), native("/home/user"),
+                                            native("/"), native("/usr"), native("/var")};
+    ASSERT_TRUE(order(queue) == expected);
+
+    ASSERT_TRUE(queue.scheduled(native("/home/user/src")) && queue.scheduled(native("/usr")));
+    ASSERT_TRUE(!queue.scheduled(native("/home")) && !queue.scheduled(native("/usr/lib")));
+}
+
+TEST(crawl_queue_test, inside_root)
+{
+    using Priority = Crawl_queue::Priority;
+
+    Crawl_queue queue{native("/home/user")};
+    ASSERT_TRUE(!queue.add(native("/usr"), Priority::cold));
+    ASSERT_TRUE(!queue.add(native("/home"), Priority::hot));
+    ASSERT_TRUE(!queue.add(native("/home/user2"), Priority::hot));
+    ASSERT_TRUE(!queue.add(native("/home/user/"), Priority::hot));
+    ASSERT_TRUE(queue.add(native("/home/user/src"), Priority::hot));
+
+    // Root spelled with a trailing separator.
+    Crawl_queue with_sep{native("/home/user/")};
+    ASSERT_TRUE(with_sep.add(native("/home/user/src"), Priority::hot));
+    ASSERT_TRUE(!with_sep.add(native("/home/user2"), Priority::hot));
+    ASSERT_TRUE(order(with_sep).front() == native("/home/user/src"));
+}
+
+// NOLINTEND
@@ -7,6 +7,7 @@
 
 #include "files.hpp"
 #include "os.hpp"
+#include "query.hpp"
 #include "util.hpp"
 
 // NOLINTBEGIN
@@ -30,33 +31,33 @@ TEST(files_test, sanity_test_1)
 
     auto r = files.search("my_file_1");
     ASSERT_TRUE(r.size() == 1);
-    ASSERT_TRUE(r[0]->name() == file_name);
-    ASSERT_TRUE(r[0]->path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path);
 
     r = files.search("m");
     ASSERT_TRUE(r.size() == 1);
-    ASSERT_TRUE(r[0]->name() == file_name);
-    ASSERT_TRUE(r[0]->path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path);
 
     r = files.search("my");
     ASSERT_TRUE(r.size() == 1);
-    ASSERT_TRUE(r[0]->name() == file_name);
-    ASSERT_TRUE(r[0]->path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path);
 
     r = files.search("file");
     ASSERT_TRUE(r.size() == 1);
-    ASSERT_TRUE(r[0]->name() == file_name);
-    ASSERT_TRUE(r[0]->path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path);
 
     r = files.search("_");
     ASSERT_TRUE(r.size() == 1);
-    ASSERT_TRUE(r[0]->name() == file_name);
-    ASSERT_TRUE(r[0]->path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path);
 
     r = files.search("1");
     ASSERT_TRUE(r.size() == 1);
-    ASSERT_TRUE(r[0]->name() == file_name);
-    ASSERT_TRUE(r[0]->path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path);
 
     files.erase(file);
 
@@ -95,39 +96,39 @@ TEST(files_test, sanity_test_2)
 
     auto r = files.search("attach.cpp");
     ASSERT_TRUE(r.size() == 2);
-    ASSERT_TRUE(r[0]->path() == file_path_1 || r[1]->path() == file_path_1);
-    ASSERT_TRUE(r[0]->path() == file_path_2 || r[1]->path() == file_path_2);
-    ASSERT_TRUE(r[0]->name() == file_name && r[1]->name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path_1 || r[1].path() == file_path_1);
+    ASSERT_TRUE(r[0].path() == file_path_2 || r[1].path() == file_path_2);
+    ASSERT_TRUE(r[0].name() == file_name && r[1].name() == file_name);
 
     r = files.search("attach");
     ASSERT_TRUE(r.size() == 2);
-    ASSERT_TRUE(r[0]->path() == file_path_1 || r[1]->path() == file_path_1);
-    ASSERT_TRUE(r[0]->path() == file_path_2 || r[1]->path() == file_path_2);
-    ASSERT_TRUE(r[0]->name() == file_name && r[1]->name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path_1 || r[1].path() == file_path_1);
+    ASSERT_TRUE(r[0].path() == file_path_2 || r[1].path() == file_path_2);
+    ASSERT_TRUE(r[0].name() == file_name && r[1].name() == file_name);
 
     r = files.search("cpp");
     ASSERT_TRUE(r.size() == 2);
-    ASSERT_TRUE(r[0]->path() == file_path_1 || r[1]->path() == file_path_1);
-    ASSERT_TRUE(r[0]->path() == file_path_2 || r[1]->path() == file_path_2);
-    ASSERT_TRUE(r[0]->name() == file_name && r[1]->name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path_1 || r[1].path() == file_path_1);
+    ASSERT_TRUE(r[0].path() == file_path_2 || r[1].path() == file_path_2);
+    ASSERT_TRUE(r[0].name() == file_name && r[1].name() == file_name);
 
     r = files.search(".");
     ASSERT_TRUE(r.size() == 2);
-    ASSERT_TRUE(r[0]->path() == file_path_1 || r[1]->path() == file_path_1);
-    ASSERT_TRUE(r[0]->path() == file_path_2 || r[1]->path() == file_path_2);
-    ASSERT_TRUE(r[0]->name() == file_name && r[1]->name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path_1 || r[1].path() == file_path_1);
+    ASSERT_TRUE(r[0].path() == file_path_2 || r[1].path() == file_path_2);
+    ASSERT_TRUE(r[0].name() == file_name && r[1].name() == file_name);
 
     files.erase(file_1);
 
     r = files.search("attach.cpp");
     ASSERT_TRUE(r.size() == 1);
-    ASSERT_TRUE(r[0]->path() == file_path_2);
-    ASSERT_TRUE(r[0]->name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path_2);
+    ASSERT_TRUE(r[0].name() == file_name);
 
     r = files.search("cpp");
     ASSERT_TRUE(r.size() == 1);
-    ASSERT_TRUE(r[0]->path() == file_path_2);
-    ASSERT_TRUE(r[0]->name() == file_name);
+    ASSERT_TRUE(r[0].path() == file_path_2);
+    ASSERT_TRUE(r[0].name() == file_name);
 }
 
 TEST(files_test, sanity_test_3)
@@ -152,39 +153,39 @@ TEST(files_test, sanity_test_3)
 
     auto r = files.search("attach_");
     ASSERT_TRUE(r.size() == 2);
-    ASSERT_TRUE(r[0]->path() == file_path && r[1]->path() == file_path);
-    ASSERT_TRUE(r[0]->name() == file_name_1 || r[1]->name() == file_name_1);
-    ASSERT_TRUE(r[0]->name() == file_name_2 || r[1]->name() == file_name_2);
+    ASSERT_TRUE(r[0].path() == file_path && r[1].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_1 || r[1].name() == file_name_1);
+    ASSERT_TRUE(r[0].name() == file_name_2 || r[1].name() == file_name_2);
 
     r = files.search("attach");
     ASSERT_TRUE(r.size() == 2);
-    ASSERT_TRUE(r[0]->path() == file_path && r[1]->path() == file_path);
-    ASSERT_TRUE(r[0]->name() == file_name_1 || r[1]->name() == file_name_1);
-    ASSERT_TRUE(r[0]->name() == file_name_2 || r[1]->name() == file_name_2);
+    ASSERT_TRUE(r[0].path() == file_path && r[1].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_1 || r[1].name() == file_name_1);
+    ASSERT_TRUE(r[0].name() == file_name_2 || r[1].name() == file_name_2);
 
     r = files.search("cpp");
     ASSERT_TRUE(r.size() == 2);
-    ASSERT_TRUE(r[0]->path() == file_path && r[1]->path() == file_path);
-    ASSERT_TRUE(r[0]->name() == file_name_1 || r[1]->name() == file_name_1);
-    ASSERT_TRUE(r[0]->name() == file_name_2 || r[1]->name() == file_name_2);
+    ASSERT_TRUE(r[0].path() == file_path && r[1].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_1 || r[1].name() == file_name_1);
+    ASSERT_TRUE(r[0].name() == file_name_2 || r[1].name() == file_name_2);
 
     r = files.search(".");
     ASSERT_TRUE(r.size() == 2);
-    ASSERT_TRUE(r[0]->path() == file_path && r[1]->path() == file_path);
-    ASSERT_TRUE(r[0]->name() == file_name_1 || r[1]->name() == file_name_1);
-    ASSERT_TRUE(r[0]->name() == file_name_2 || r[1]->name() == file_name_2);
+    ASSERT_TRUE(r[0].path() == file_path && r[1].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_1 || r[1].name() == file_name_1);
+    ASSERT_TRUE(r[0].name() == file_name_2 || r[1].name() == file_name_2);
 
     files.erase(file_1);
 
     r = files.search("attach");
     ASSERT_TRUE(r.size() == 1);
-    ASSERT_TRUE(r[0]->path() == file_path);
-    ASSERT_TRUE(r[0]->name() == file_name_2);
+    ASSERT_TRUE(r[0].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_2);
 
     r = files.search("cpp");
     ASSERT_TRUE(r.size() == 1);
-    ASSERT_TRUE(r[0]->path() == file_path);
-    ASSERT_TRUE(r[0]->name() == file_name_2);
+    ASSERT_TRUE(r[0].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_2);
 }
 
 TEST(files_test, file_system_paths)
@@ -205,7 +206,8 @@ TEST(files_test, file_system_paths)
     for (std::string file_path; std::getline(in_file_stream, file_path);) {
         auto path = std::filesystem::path(file_path);
 
-        auto file_name = path.filename().string();
+        // Lowercase query is case insensitive (smart case).
+        auto file_name = fold_case(path.filename().string());
         if (file_name.find("cpp") != std::string::npos)
             ++cpp_files_count;
 
@@ -370,32 +372,32 @@ TEST(files_test, partial_files_search_test)
 
     r = files.partial_search("my_file", 5, 0);
     ASSERT_TRUE(r.objects_count() == 1);
-    ASSERT_TRUE(r[0].m_file->path() == file_path);
-    ASSERT_TRUE(r[0].m_file->name() == file_name_1);
+    ASSERT_TRUE(r[0].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_1);
     res.insert(r);
 
     r = files.partial_search("my_file", 5, 1);
     ASSERT_TRUE(r.objects_count() == 1);
-    ASSERT_TRUE(r[0].m_file->path() == file_path);
-    ASSERT_TRUE(r[0].m_file->name() == file_name_2);
+    ASSERT_TRUE(r[0].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_2);
     res.insert(r);
 
     r = files.partial_search("my_file", 5, 2);
     ASSERT_TRUE(r.objects_count() == 1);
-    ASSERT_TRUE(r[0].m_file->path() == file_path);
-    ASSERT_TRUE(r[0].m_file->name() == file_name_3);
+    ASSERT_TRUE(r[0].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_3);
     res.insert(r);
 
     r = files.partial_search("my_file", 5, 3);
     ASSERT_TRUE(r.objects_count() == 1);
-    ASSERT_TRUE(r[0].m_file->path() == file_path);
-    ASSERT_TRUE(r[0].m_file->name() == file_name_4);
+    ASSERT_TRUE(r[0].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_4);
     res.insert(r);
 
     r = files.partial_search("my_file", 5, 4);
     ASSERT_TRUE(r.objects_count() == 1);
-    ASSERT_TRUE(r[0].m_file->path() == file_path);
-    ASSERT_TRUE(r[0].m_file->name() == file_name_5);
+    ASSERT_TRUE(r[0].path() == file_path);
+    ASSERT_TRUE(r[0].name() == file_name_5);
     res.insert(r);
 
     ASSERT_TRUE(res.objects_count() == 5);
@@ -508,4 +510,501 @@ TEST(files_test, partial_files_search_test_2)
     ASSERT_TRUE(res.objects_count() == 1000);
 }
 
+TEST(files_test, erased_file_ids_are_reused)
+{
+    Files files;
+
+    const std::string file_path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    const File_id id_1 = files.insert(file_path + "file_1").get();
+    const File_id id_2 = files.insert(file_path + "file_2").get();
+    ASSERT_TRUE(id_1 != id_2);
+    ASSERT_TRUE(files.insert(file_path + "file_1").get() == id_1);
+
+    files.erase(file_path + "file_1");
+    ASSERT_TRUE(files.files_count() == 1);
+    ASSERT_TRUE(files.search("file_1").empty());
+
+    const File_id id_3 = files.insert(file_path + "file_3").get();
+    ASSERT_TRUE(id_3 == id_1);
+    ASSERT_TRUE(files.files_count() == 2);
+    ASSERT_TRUE(files.name(id_3) == "file_3");
+    ASSERT_TRUE(files.path(id_3) == file_path);
+    ASSERT_TRUE(files.name(id_2) == "file_2");
+}
+
+TEST(files_test, directory_table)
+{
+    for (const bool dir_index : {false, true}) {
+        Files files{Files::Options{.m_dir_index = dir_index}};
+
+        const std::string root =
+#if defined _WIN32
+            R"(C:\User\)";
+#elif defined __linux__
+            R"(/User/)";
+#endif
+
+        const std::string sep = os::path_sep_str;
+        files.insert(root + "project" + sep + "src" + sep + "main.cpp");
+        files.insert(root + "project" + sep + "src" + sep + "util.cpp");
+        files.insert(root + "project" + sep + "include" + sep + "util.hpp");
+        files.insert(root + "project_2" + sep + "main.cpp");
+        ASSERT_TRUE(files.dirs_count() == 6);
+
+        // Directory is found with or without the trailing separator.
+        const std::vector<std::string> src_files{"main.cpp", "util.cpp"};
+        ASSERT_TRUE(files.dir_file_names(root + "project" + sep + "src") == src_files);
+        ASSERT_TRUE(files.dir_file_names(root + "project" + sep + "src" + sep) == src_files);
+        ASSERT_TRUE(files.dir_file_names(root + "project").empty());
+        ASSERT_TRUE(files.dir_file_names(root + "nothing").empty());
+
+        auto r = files.search(root + "project" + sep + "src" + sep + "main");
+        ASSERT_TRUE(r.size() == 1);
+        ASSERT_TRUE(r[0].path() == root + "project" + sep + "src" + sep);
+        ASSERT_TRUE(r[0].full_path() == root + "project" + sep + "src" + sep + "main.cpp");
+
+        // Path filter matches directory name prefixes, the same as full path prefixes.
+        ASSERT_TRUE(files.search(root + "proj" + sep + "main").size() == 2);
+        ASSERT_TRUE(files.search(root + "project" + sep + "util").size() == 2);
+        ASSERT_TRUE(files.search(root + "project_" + sep + "main").size() == 1);
+        ASSERT_TRUE(files.search(root + "nothing" + sep + "main").empty());
+
+        // Empty directories are removed together with their empty parents.
+        files.erase(root + "project" + sep + "include" + sep + "util.hpp");
+        ASSERT_TRUE(files.dirs_count() == 5);
+        files.erase(root + "project" + sep + "src" + sep + "main.cpp");
+        files.erase(root + "project" + sep + "src" + sep + "util.cpp");
+        ASSERT_TRUE(files.dirs_count() == 3);
+        ASSERT_TRUE(files.search(root + "project" + sep + "util").empty());
+
+        files.insert(root + "project" + sep + "docs" + sep + "readme.md");
+        ASSERT_TRUE(files.dirs_count() == 5);
+        ASSERT_TRUE(files.search("readme")[0].path() == root + "project" + sep + "docs" + sep);
+    }
+}
+
+TEST(files_test, name_mask_prefilter)
+{
+    ASSERT_TRUE(char_mask("Makefile") == char_mask("makefile"));
+    ASSERT_TRUE((char_mask("main.cpp") & char_mask("pm.")) == char_mask("pm."));
+    ASSERT_TRUE((char_mask("main.cpp") & char_mask("x")) != char_mask("x"));
+
+    Files files;
+
+    const std::string file_path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    for (usize i = 0; i < 10; ++i)
+        files.insert(file_path + std::format("main_{}.cpp", i));
+
+    files.insert(file_path + "x_file.txt");
+    files.erase(file_path + "main_3.cpp");
+
+    // All names except one miss 'x', so they are rejected without a name match.
+    auto r = files.search("x");
+    ASSERT_TRUE(r.size() == 1);
+    ASSERT_TRUE(r.stats().m_rejected == 9);
+    ASSERT_TRUE(r.stats().m_scanned == 10);
+
+    // Mask is only a prefilter, name still has to contain the query.
+    ASSERT_TRUE(files.search("ppc.").empty());
+    ASSERT_TRUE(files.search("n_1.c").size() == 1);
+}
+
+TEST(files_test, extension_candidates)
+{
+    Files files;
+
+    const std::string file_path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    for (usize i = 0; i < 100; ++i)
+        files.insert(file_path + std::format("file_{}.txt", i));
+
+    files.insert(file_path + "main.cpp");
+    files.insert(file_path + "main.cppm");
+    files.insert(file_path + "main.cpp.orig");
+    files.insert(file_path + "cpp");
+
+    // Candidates are files with extension starting with "cpp" and files with more than one dot.
+    auto pattern = files.compile("*.cpp");
+    ASSERT_TRUE(pattern.m_candidates);
+    ASSERT_TRUE(pattern.m_candidates->count() == 3);
+
+    auto r = files.search("*.cpp");
+    ASSERT_TRUE(r.size() == 3);
+    ASSERT_TRUE(r.stats().m_scanned == 3);
+    ASSERT_TRUE(files.search("main*.cpp").size() == 3);
+    ASSERT_TRUE(files.search("in.cppm").size() == 1);
+
+    // Most files match, so they are scanned.
+    ASSERT_TRUE(!files.compile(".txt").m_candidates);
+    ASSERT_TRUE(files.search(".txt").objects_count() == 100);
+
+    files.erase(file_path + "main.cpp");
+    ASSERT_TRUE(files.search("*.cpp").size() == 2);
+    ASSERT_TRUE(files.compile("*.cpp").m_candidates->count() == 2);
+}
+
+TEST(files_test, query_planner)
+{
+    Files files;
+
+    const std::string path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    for (usize i = 0; i < 1000; ++i)
+        files.insert(path + std::format("big{}file_{}.txt", os::path_sep, i));
+
+    for (usize i = 0; i < 10; ++i)
+        files.insert(path + std::format("small{}file_{}.txt", os::path_sep, i));
+
+    files.insert(path + "small" + os::path_sep + "main.cpp");
+
+    // Query mask is selective enough, so a bulk scan is the cheapest.
+    auto pattern = files.compile("main");
+    ASSERT_TRUE(pattern.m_plan.m_access == Files::Plan::Access::scan);
+    ASSERT_TRUE(pattern.m_plan.m_files == 1011);
+    ASSERT_TRUE(!pattern.m_candidates);
+
+    pattern = files.compile(".cpp");
+    ASSERT_TRUE(pattern.m_plan.m_access == Files::Plan::Access::extension);
+    ASSERT_TRUE(pattern.m_plan.m_files == 1);
+
+    // Most names pass the mask, so only files of the searched directory are visited.
+    pattern = files.compile(path + "small" + os::path_sep + "file");
+    ASSERT_TRUE(pattern.m_plan.m_access == Files::Plan::Access::subtree);
+    ASSERT_TRUE(pattern.m_plan.m_files == 11);
+    ASSERT_TRUE(pattern.m_plan.m_cost > 0.0);
+
+    auto r = files.partial_search(pattern, 1, 0);
+    ASSERT_TRUE(r.objects_count() == 10);
+    ASSERT_TRUE(r.stats().m_scanned == 11);
+    ASSERT_TRUE(files.partial_search(pattern, 4, 3).objects_count() +
+                    files.partial_search(pattern, 4, 0).objects_count() ==
+                10);
+
+    // Searched directory has almost all files, building its candidates costs more than a scan.
+    pattern = files.compile(path + "big" + os::path_sep + "file");
+    ASSERT_TRUE(pattern.m_plan.m_access == Files::Plan::Access::scan);
+    ASSERT_TRUE(files.partial_search(pattern, 1, 0).objects_count() == 1000);
+}
+
+TEST(files_test, query_terms)
+{
+    const auto terms = parse_terms(R"(main !test ext:.cpp !dir:build "my file" "!x" !)");
+    ASSERT_TRUE(terms.size() == 6);
+    ASSERT_TRUE(terms[1].m_negated && terms[1].m_text == "test");
+    ASSERT_TRUE(terms[2].m_kind == Query_term::Kind::ext && terms[2].m_text == "cpp");
+    ASSERT_TRUE(terms[3].m_kind == Query_term::Kind::dir && terms[3].m_negated);
+    ASSERT_TRUE(terms[4].m_text == "my file");
+    ASSERT_TRUE(!terms[5].m_negated && terms[5].m_text == "!x");
+
+    Files files;
+
+    const std::string path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    const std::string sep{os::path_sep};
+    for (const char* dir : {"src", "build", "test"}) {
+        for (usize i = 0; i < 20; ++i) {
+            files.insert(path + dir + sep + std::format("main_{}.cpp", i));
+            files.insert(path + dir + sep + std::format("main_{}.h", i));
+            files.insert(path + dir + sep + std::format("util_{}.cpp", i));
+        }
+    }
+
+    files.insert(path + "src" + sep + "my file.txt");
+
+    // Name terms match in any order.
+    ASSERT_TRUE(files.search("cpp main_1").objects_count() == 33);
+    ASSERT_TRUE(files.search("main_1 !_1.h").objects_count() == 63);
+    ASSERT_TRUE(files.search("\"my file\"").size() == 1);
+    ASSERT_TRUE(files.search("my file").size() == 1);
+
+    // ext: and dir: terms are intersected before the scan.
+    auto pattern = files.compile("ext:cpp dir:src main");
+    ASSERT_TRUE(pattern.m_plan.m_access == Files::Plan::Access::index);
+    ASSERT_TRUE(pattern.m_plan.m_files == 40);
+
+    auto r = files.partial_search(pattern, 1, 0);
+    ASSERT_TRUE(r.objects_count() == 20);
+    ASSERT_TRUE(r.stats().m_scanned == 40);
+
+    // Highlight covers all name terms.
+    r = files.search("ext:h dir:test 9.h main");
+    ASSERT_TRUE(r.objects_count() == 2);
+    ASSERT_TRUE(r[0].name() == "main_9.h" || r[0].name() == "main_19.h");
+
+    r = files.search("ext:h dir:test _9 main");
+    ASSERT_TRUE(r.size() == 1);
+    ASSERT_TRUE(r[0].name() == "main_9.h");
+    for (usize i = 0; i < 8; ++i)
+        ASSERT_TRUE(r[0].match_bs()[path.size() + 5 + i] == (i < 6));
+
+    pattern = files.compile("ext:cpp !dir:build !dir:test");
+    ASSERT_TRUE(pattern.m_plan.m_access == Files::Plan::Access::index);
+    ASSERT_TRUE(pattern.m_plan.m_files == 40);
+
+    // Without candidates, files passing negated terms are visited directly when that is cheaper
+    // than a scan.
+    pattern = files.compile("main !dir:build");
+    ASSERT_TRUE(pattern.m_plan.m_access == Files::Plan::Access::filter);
+    ASSERT_TRUE(pattern.m_plan.m_files == 121);
+    ASSERT_TRUE(files.partial_search(pattern, 1, 0).objects_count() == 80);
+
+    ASSERT_TRUE(files.search("ext:xyz").empty());
+    ASSERT_TRUE(!files.fuzzy(files.compile("mian dir:src")));
+
+    // Pinned path is the path of the first name term.
+    Query query;
+    query.pinned() = path + "test" + sep;
+    query.query() = "ext:h 1";
+    ASSERT_TRUE(files.partial_search(files.compile(query.terms()), 1, 0).objects_count() == 11);
+    query.query() = "ext:h";
+    ASSERT_TRUE(files.partial_search(files.compile(query.terms()), 1, 0).objects_count() == 20);
+}
+
+TEST(files_test, metadata_terms)
+{
+    auto terms = parse_terms("size>10k !mtime<2h type:d size>1X mtime<");
+    ASSERT_TRUE(terms.size() == 5);
+    ASSERT_TRUE(terms[0].m_kind == Query_term::Kind::size && terms[0].m_op == '>' &&
+                terms[0].m_value == 10240);
+    ASSERT_TRUE(terms[1].m_kind == Query_term::Kind::mtime && terms[1].m_negated &&
+                terms[1].m_value == 7200);
+    ASSERT_TRUE(terms[2].m_kind == Query_term::Kind::type && terms[2].m_text == "d");
+    ASSERT_TRUE(terms[3].m_kind == Query_term::Kind::name && terms[4].m_text == "mtime<");
+
+    const std::string path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    // Metadata terms need metadata columns.
+    Files plain;
+    plain.insert(path + "a.txt");
+    ASSERT_TRUE(!plain.compile("a size>1").m_error.empty());
+    ASSERT_TRUE(plain.search("a size>1").empty());
+
+    Files files{Files::Options{.m_metadata = true}};
+
+    const i64 now = std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count();
+
+    // File i has i KiB, was modified i and a half hours ago, and every 10th entry is a directory.
+    for (usize i = 0; i < 1000; ++i) {
+        const File_id id = files.insert(path + std::format("file_{}", i)).get();
+        files.set_metadata(id, os::File_stat{.m_size = i * 1024,
+                                             .m_mtime = now - (i64(i) * 3600) - 1800,
+                                             .m_mode = i % 10 == 0 ? os::mode_dir : os::mode_file,
+                                             .m_device = 1});
+    }
+
+    ASSERT_TRUE(files.metadata(File_id::from_index(5)).m_size == 5 * 1024);
+    ASSERT_TRUE(files.search("file size>989k").objects_count() == 10);
+    ASSERT_TRUE(files.search("file size<10k").objects_count() == 10);
+    ASSERT_TRUE(files.search("file !size<10k").objects_count() == 990);
+    ASSERT_TRUE(files.search("file mtime<4h").objects_count() == 4);
+    ASSERT_TRUE(files.search("file mtime>997h").objects_count() == 3);
+    ASSERT_TRUE(files.search("file type:d").objects_count() == 100);
+    ASSERT_TRUE(files.search("file_1 type:f size<100k").objects_count() == 10);
+
+    // Files passing selective filters are visited directly, broad ones are checked per scanned
+    // file.
+    auto pattern = files.compile("file size>989k");
+    ASSERT_TRUE(pattern.m_plan.m_access == Files::Plan::Access::filter);
+    ASSERT_TRUE(pattern.m_plan.m_files == 10);
+    ASSERT_TRUE(files.partial_search(pattern, 1, 0).stats().m_scanned == 10);
+
+    pattern = files.compile("file !size<10k");
+    ASSERT_TRUE(pattern.m_plan.m_access == Files::Plan::Access::scan);
+    ASSERT_TRUE(!pattern.m_filter.empty());
+
+    // Reused slots of erased files start with empty metadata.
+    files.erase(path + "file_999");
+    files.insert(path + "new_file");
+    ASSERT_TRUE(files.search("new_file size<1").objects_count() == 1);
+}
+
+TEST(files_test, name_index)
+{
+    auto terms = parse_terms("^lib !^test \"^x\" ext:^h");
+    ASSERT_TRUE(terms.size() == 4);
+    ASSERT_TRUE(terms[0].m_anchored && terms[0].m_text == "lib");
+    ASSERT_TRUE(terms[1].m_anchored && terms[1].m_negated && terms[1].m_text == "test");
+    ASSERT_TRUE(!terms[2].m_anchored && terms[2].m_text == "^x");
+    ASSERT_TRUE(!terms[3].m_anchored);
+
+    const std::string path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    Files plain;
+    Files indexed{Files::Options{.m_name_index = true}};
+    Files compressed{Files::Options{.m_compress_names = true, .m_name_index = true}};
+
+    // Enough files for a few batched merges, spread over directories to keep inserts fast.
+    const auto file = [&](usize i, std::string_view prefix) {
+        return std::format("{}d{}{}{}_{}.so", path, i % 64, os::path_sep, prefix, i);
+    };
+    const auto prefix = [](usize i) {
+        return i % 4 == 0 ? "lib" : (i % 4 == 1 ? "Libz" : "my_lib");
+    };
+
+    for (usize i = 0; i < 10'000; ++i) {
+        for (Files* files : {&plain, &indexed, &compressed})
+            files->insert(file(i, prefix(i)));
+    }
+
+    const auto count = [](const Files& files, const std::string& query) {
+        return files.partial_search(files.compile(query), 1, 0).objects_count();
+    };
+
+    ASSERT_TRUE(plain.compile("^lib").m_plan.name() == "scan");
+    ASSERT_TRUE(count(plain, "^lib") == 5'000);
+    ASSERT_TRUE(count(plain, "lib") == 10'000);
+    ASSERT_TRUE(count(plain, "^Lib") == 2'500);
+
+    for (Files* files : {&indexed, &compressed}) {
+        ASSERT_TRUE(files->compile("^libz_1").m_plan.name() == "prefix");
+        ASSERT_TRUE(files->compile("^lib").m_plan.name() == "prefix");
+        for (const char* query : {"^lib", "^Lib", "^libz_1", "^lib_1*2 !^libz", "^my_ _3"})
+            ASSERT_TRUE(count(*files, query) == count(plain, query));
+    }
+
+    // Erased files leave the index, and their reused slots are indexed by their new names.
+    for (usize i = 0; i < 10'000; i += 3) {
+        for (Files* files : {&plain, &indexed, &compressed}) {
+            files->erase(file(i, prefix(i)));
+            files->insert(file(i, "aa"));
+        }
+    }
+
+    for (Files* files : {&indexed, &compressed}) {
+        for (const char* query : {"^lib", "^Lib", "^libz_1", "^aa_", "^aa_1", "^zz"})
+            ASSERT_TRUE(count(*files, query) == count(plain, query));
+
+        ASSERT_TRUE(files->compile("^aa_19").m_plan.name() == "prefix");
+        ASSERT_TRUE(files->search("^aa_199")[0].name().starts_with("aa_199"));
+    }
+}
+
+TEST(files_test, smart_case)
+{
+    ASSERT_TRUE(fold_case("README.md") == "readme.md");
+    ASSERT_TRUE(fold_case("\xC3\x84pfel") == "\xC3\xA4pfel");     // Äpfel
+    ASSERT_TRUE(fold_case("\xE2\x84\xAA" "elvin") == "kelvin");      // Kelvin sign
+    ASSERT_TRUE(fold_case("bad\xFF\xC3") == "bad\xFF\xC3");        // Invalid UTF-8
+    ASSERT_TRUE(fold_code_point(0x0391) == 0x03B1);                  // Greek alpha
+    ASSERT_TRUE(fold_code_point(0x0101) == 0x0101);
+
+    Files files;
+
+    const std::string file_path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    files.insert(file_path + "README.md");
+    files.insert(file_path + "readme.txt");
+    files.insert(file_path + "\xC3\x84pfel.TXT");
+    files.insert(file_path + "\xE2\x84\xAA" "elvin.txt");
+
+    // Lowercase query ignores case.
+    ASSERT_TRUE(files.search("readme").size() == 2);
+    ASSERT_TRUE(files.search("\xC3\xA4pfel").size() == 1);
+    ASSERT_TRUE(files.search("*.txt").size() == 3);
+
+    // Query with uppercase is case sensitive.
+    ASSERT_TRUE(files.search("README").size() == 1);
+    ASSERT_TRUE(files.search("*.TXT").size() == 1);
+    ASSERT_TRUE(files.search("\xC3\x84pfel").size() == 1);
+    ASSERT_TRUE(files.search("Apfel").empty());
+
+    // Highlight covers original bytes of the 3 byte Kelvin sign.
+    auto r = files.search("kel");
+    ASSERT_TRUE(r.size() == 1);
+    const usize name_begin = file_path.size();
+    for (usize i = 0; i < 5; ++i)
+        ASSERT_TRUE(r[0].match_bs()[name_begin + i]);
+
+    ASSERT_TRUE(!r[0].match_bs()[name_begin + 5]);
+}
+
+TEST(files_test, fuzzy_search)
+{
+    ASSERT_TRUE(Fuzzy_pattern{"config"}.search("my_config.h").m_distance == 0);
+    ASSERT_TRUE(Fuzzy_pattern{"config"}.search("my_config.h").m_end == 9);
+    ASSERT_TRUE(Fuzzy_pattern{"cnofig"}.search("config").m_distance == 2);
+    ASSERT_TRUE(Fuzzy_pattern{"confg"}.search("config.h").m_distance == 1);
+    ASSERT_TRUE(Fuzzy_pattern{"confxg"}.search("config.h").m_distance == 1);
+    ASSERT_TRUE(Fuzzy_pattern{"conffig"}.search("config.h").m_distance == 1);
+    ASSERT_TRUE(Fuzzy_pattern{"abc"}.search("xyz").m_distance == 3);
+
+    Files files;
+
+    const std::string file_path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    files.insert(file_path + "config.h");
+    files.insert(file_path + "main.cpp");
+    files.insert(file_path + "makefile");
+
+    auto pattern = files.compile("confg");
+    ASSERT_TRUE(files.partial_search(pattern, 1, 0).empty());
+
+    // Fuzzy pattern for single part queries only.
+    ASSERT_TRUE(!files.fuzzy(files.compile("co*fg")));
+    ASSERT_TRUE(!files.fuzzy(files.compile("cf")));
+
+    auto fuzzy = files.fuzzy(pattern);
+    ASSERT_TRUE(fuzzy && fuzzy->m_max_errors == 1);
+
+    auto r = files.partial_search(*fuzzy, 1, 0);
+    ASSERT_TRUE(r.size() == 1);
+    ASSERT_TRUE(r[0].name() == "config.h");
+    ASSERT_TRUE(r.stats().m_rejected == 2); // Masks of other names miss more than one class.
+
+    // Highlight is a pattern sized window that ends at the first best match ("conf").
+    for (usize i = 0; i < 6; ++i)
+        ASSERT_TRUE(r[0].match_bs()[file_path.size() + i] == (i < 4));
+
+    ASSERT_TRUE(files.partial_search(*files.fuzzy(files.compile("mian.cpp")), 1, 0).size() == 1);
+}
+
 // NOLINTEND
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "finder.hpp"
+
+// NOLINTBEGIN
+
+namespace fs = std::filesystem;
+
+static void write(const fs::path& path, const std::string& text)
+{
+    fs::create_directories(path.parent_path());
+    std::ofstream{path} << text;
+}
+
+static void wait_crawl(const Finder& finder)
+{
+    while (finder.crawling())
+        std::this_thread::sleep_for(1ms);
+}
+
+static std::vector<std::string> names(Files& files, const fs::path& dir)
+{
+    std::vector<std::string> result = files.dir_file_names(dir.string());
+    std::ranges::sort(result);
+    return result;
+}
+
+TEST(finder_test, rescan)
+{
+    const fs::path root = fs::temp_directory_path() / "finder_rescan_test";
+    fs::remove_all(root);
+    write(root / "a.cpp", "int alpha = 1;\n");
+    write(root / "keep.txt", "");
+    write(root / "sub" / "b.cpp", "int beta = 2;\n");
+    write(root / "sub" / "deep" / "c.txt", "");
+
+    Finder finder{Options{.m_root = root.string(), .m_symbols = true, .m_rescan = true}};
+    wait_crawl(finder);
+
+    Files& files = finder.files();
+    ASSERT_TRUE(files.files_count() == 6); // Directories are indexed too.
+    ASSERT_TRUE(finder.find_symbols("alpha") != nullptr);
+
+    fs::remove(root / "a.cpp");
+    fs::remove_all(root / "sub" / "deep");
+    write(root / "new.cpp", "int gamma = 3;\n");
+    write(root / "sub" / "nested" / "d" / "e.txt", "");
+
+    ASSERT_TRUE(finder.rescan());
+    wait_crawl(finder);
+    ASSERT_TRUE(finder.last_rescan().has_value());
+
+    ASSERT_TRUE(files.files_count() == 7);
+    ASSERT_TRUE((names(files, root) == std::vector<std::string>{"keep.txt", "new.cpp", "sub"}));
+    ASSERT_TRUE((names(files, root / "sub") == std::vector<std::string>{"b.cpp", "nested"}));
+    ASSERT_TRUE(names(files, root / "sub" / "deep").empty());
+    ASSERT_TRUE(names(files, root / "sub" / "nested" / "d") == std::vector<std::string>{"e.txt"});
+
+    // Symbols of erased files are gone, even if their ids were reused by new files.
+    ASSERT_TRUE(finder.find_symbols("alpha") == nullptr);
+    ASSERT_TRUE(finder.find_symbols("beta") != nullptr);
+
+    const Symbol* gamma = finder.find_symbols("gamma");
+    ASSERT_TRUE(gamma != nullptr && gamma->refs().size() == 1);
+    ASSERT_TRUE(files.full_path(gamma->refs()[0].file()) == (root / "new.cpp").string());
+
+    fs::remove_all(root);
+}
+
+// NOLINTEND
@@ -0,0 +1,86 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "gitignore.hpp"
+#include "os.hpp"
+
+// NOLINTBEGIN
+
+namespace fs = std::filesystem;
+
+TEST(gitignore_test, glob)
+{
+    ASSERT_TRUE(Glob{"build"}.match("build"));
+    ASSERT_TRUE(!Glob{"build"}.match("build2"));
+    ASSERT_TRUE(Glob{"*.o"}.match("main.o"));
+    ASSERT_TRUE(!Glob{"*.o"}.match("src/main.o"));
+    ASSERT_TRUE(Glob{"tmp*"}.match("tmp_1"));
+    ASSERT_TRUE(!Glob{"tmp*"}.match("tmp/1"));
+    ASSERT_TRUE(Glob{"?.txt"}.match("a.txt"));
+    ASSERT_TRUE(!Glob{"?.txt"}.match("ab.txt"));
+    ASSERT_TRUE(Glob{"lib[0-9].so"}.match("lib7.so"));
+    ASSERT_TRUE(!Glob{"lib[!0-9].so"}.match("lib7.so"));
+    ASSERT_TRUE(Glob{"\\*.txt"}.match("*.txt"));
+    ASSERT_TRUE(!Glob{"\\*.txt"}.match("a.txt"));
+
+    ASSERT_TRUE(Glob{"**/objects"}.match("objects"));
+    ASSERT_TRUE(Glob{"**/objects"}.match(".git/objects"));
+    ASSERT_TRUE(!Glob{"**/objects"}.match("my_objects"));
+    ASSERT_TRUE(Glob{"a/**/b"}.match("a/b"));
+    ASSERT_TRUE(Glob{"a/**/b"}.match("a/x/y/b"));
+    ASSERT_TRUE(Glob{"docs/**"}.match("docs/a/b.md"));
+    ASSERT_TRUE(Glob{"src/*.cpp"}.match("src/main.cpp"));
+    ASSERT_TRUE(!Glob{"src/*.cpp"}.match("src/a/main.cpp"));
+
+    // Memoized, so patterns that are exponential for backtracking are fast.
+    ASSERT_TRUE(!Glob{"*a*a*a*a*a*a*a*a*b"}.match(std::string(200, 'a')));
+}
+
+TEST(gitignore_test, rules)
+{
+    const auto rules = Gitignore::parse("# comment\n\n*.o\n!keep.o\nbuild/\n/out\ndocs/*.md  \r\n");
+    ASSERT_TRUE(rules.size() == 5);
+    ASSERT_TRUE(rules[1].m_negated && !rules[1].m_anchored);
+    ASSERT_TRUE(rules[2].m_dir_only && !rules[2].m_anchored);
+    ASSERT_TRUE(rules[3].m_anchored && rules[3].m_glob.match("out"));
+    ASSERT_TRUE(rules[4].m_anchored && rules[4].m_glob.match("docs/a.md"));
+}
+
+TEST(gitignore_test, frames)
+{
+    const fs::path root = fs::temp_directory_path() / "finder_gitignore_test";
+    fs::remove_all(root);
+    fs::create_directories(root / "sub");
+
+    std::ofstream{root / ".gitignore"} << "*.o\nbuild/\n/out\n";
+    std::ofstream{root / "sub" / ".ignore"} << "!main.o\n*.tmp\n";
+
+    const std::string dir = root.string();
+    const std::string sep = os::path_sep_str;
+
+    Gitignore ignore;
+    ignore.enter(dir + sep, -1);
+    ASSERT_TRUE(ignore.ignored(dir + sep + "a.o", false));
+    ASSERT_TRUE(!ignore.ignored(dir + sep + "a.cpp", false));
+    ASSERT_TRUE(ignore.ignored(dir + sep + "build", true));
+    ASSERT_TRUE(!ignore.ignored(dir + sep + "build", false));
+    ASSERT_TRUE(ignore.ignored(dir + sep + "out", true));
+    ASSERT_TRUE(ignore.ignored(dir + sep + ".git", true));
+
+    // Inner frame overrides the outer one, and is popped when the crawl leaves its directory.
+    ignore.enter(dir + sep + "sub", 0);
+    ASSERT_TRUE(!ignore.ignored(dir + sep + "sub" + sep + "main.o", false));
+    ASSERT_TRUE(ignore.ignored(dir + sep + "sub" + sep + "x.o", false));
+    ASSERT_TRUE(ignore.ignored(dir + sep + "sub" + sep + "x.tmp", false));
+    ASSERT_TRUE(!ignore.ignored(dir + sep + "sub" + sep + "out", true)); // Anchored to root.
+
+    ignore.leave(0);
+    ASSERT_TRUE(!ignore.ignored(dir + sep + "x.tmp", false));
+    ASSERT_TRUE(ignore.ignored(dir + sep + "main.o", false));
+
+    fs::remove_all(root);
+}
+
+// NOLINTEND
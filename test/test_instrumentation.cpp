@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include "instrumentation.hpp"
+#include "util.hpp"
+
+// NOLINTBEGIN
+
+TEST(instrumentation_test, histogram_small_values_are_exact)
+{
+    Histogram h;
+    for (u64 i = 1; i <= 20; ++i)
+        h.record(i);
+
+    ASSERT_TRUE(h.count() == 20);
+    ASSERT_TRUE(h.min() == 1);
+    ASSERT_TRUE(h.max() == 20);
+    ASSERT_TRUE(h.percentile(50) == 10);
+    ASSERT_TRUE(h.percentile(100) == 20);
+}
+
+TEST(instrumentation_test, histogram_relative_error)
+{
+    Histogram h;
+    for (u64 i = 1; i <= 100'000; ++i)
+        h.record(i * 1000);
+
+    const auto close = [](u64 value, u64 expected) {
+        return value >= expected && f64(value) <= f64(expected) * 1.04;
+    };
+
+    ASSERT_TRUE(close(h.percentile(50), 50'000'000));
+    ASSERT_TRUE(close(h.percentile(99), 99'000'000));
+    ASSERT_TRUE(h.percentile(100) == 100'000'000);
+}
+
+TEST(instrumentation_test, histogram_merge)
+{
+    Histogram h1;
+    Histogram h2;
+
+    h1.record(5);
+    h2.record(1'000'000);
+    h1.merge(h2);
+
+    ASSERT_TRUE(h1.count() == 2);
+    ASSERT_TRUE(h1.min() == 5);
+    ASSERT_TRUE(h1.max() == 1'000'000);
+}
+
+TEST(instrumentation_test, json_report)
+{
+    Instrumentation instr;
+    instr.record(Stage::scan, 1500ns);
+    instr.record_keystroke(2ms);
+    instr.add(Counter::files_scanned, 42);
+
+    std::string json = instr.to_json();
+    ASSERT_TRUE(json.find("\"scan\": {\"count\": 1") != std::string::npos);
+    ASSERT_TRUE(json.find("\"files_scanned\": 42") != std::string::npos);
+}
+
+TEST(instrumentation_test, plans)
+{
+    Instrumentation instr;
+    instr.record_plan(Plan_record{.m_access = "scan", .m_estimated_files = 100, .m_files = 100});
+    instr.record_plan(Plan_record{.m_access = "extension", .m_estimated_files = 5, .m_files = 4});
+    instr.record_plan(Plan_record{.m_access = "scan", .m_estimated_files = 100, .m_files = 90});
+
+    ASSERT_TRUE(instr.plans().size() == 2);
+    ASSERT_TRUE(instr.plans()[0].m_count == 2);
+    ASSERT_TRUE(instr.plans()[0].m_files == 190);
+
+    const std::string json = instr.to_json();
+    ASSERT_TRUE(json.find("\"extension\": {\"count\": 1, \"estimated_files\": 5, \"files\": 4") !=
+                std::string::npos);
+
+    instr.toggle_status_line();
+    ASSERT_TRUE(instr.status_line().find("plan: scan est 100 files") != std::string::npos);
+}
+
+// NOLINTEND
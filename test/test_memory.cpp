@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "files.hpp"
+#include "memory.hpp"
+#include "names.hpp"
+#include "symbols.hpp"
+#include "util.hpp"
+
+// NOLINTBEGIN
+
+TEST(memory_test, tracking_resource_counts_live_bytes)
+{
+    Tracking_resource memory;
+
+    {
+        std::pmr::vector<u64> v{&memory};
+        v.reserve(100);
+
+        const Memory_stats& stats = memory.stats();
+        ASSERT_TRUE(stats.allocations() == 1);
+        ASSERT_TRUE(stats.live() == 1);
+        ASSERT_TRUE(stats.requested() == 100 * sizeof(u64));
+        ASSERT_TRUE(stats.usable() >= stats.requested());
+        ASSERT_TRUE(stats.fragmentation() >= 0.0 && stats.fragmentation() < 1.0);
+
+        const auto& sc = stats.size_class_stats(Memory_stats::size_class(100 * sizeof(u64)));
+        ASSERT_TRUE(sc.m_allocations == 1);
+        ASSERT_TRUE(sc.m_requested == 100 * sizeof(u64));
+    }
+
+    const Memory_stats& stats = memory.stats();
+    ASSERT_TRUE(stats.live() == 0);
+    ASSERT_TRUE(stats.requested() == 0);
+    ASSERT_TRUE(stats.usable() == 0);
+    ASSERT_TRUE(stats.peak() >= 100 * sizeof(u64));
+}
+
+TEST(memory_test, size_classes)
+{
+    ASSERT_TRUE(Memory_stats::size_class(0) == 0);
+    ASSERT_TRUE(Memory_stats::size_class(1) == 1);
+    ASSERT_TRUE(Memory_stats::size_class(7) == 3);
+    ASSERT_TRUE(Memory_stats::size_class(8) == 4);
+    ASSERT_TRUE(Memory_stats::size_class(4096) == 13);
+}
+
+TEST(memory_test, arena)
+{
+    Tracking_resource memory;
+    Arena arena{&memory, 1024};
+
+    std::string_view s = arena.store("file_name.cpp");
+    ASSERT_TRUE(s == "file_name.cpp");
+    ASSERT_TRUE(s.data()[s.size()] == '\0');
+
+    void* aligned = arena.allocate(24, 16);
+    ASSERT_TRUE(reinterpret_cast<uptr>(aligned) % 16 == 0);
+    ASSERT_TRUE(memory.stats().allocations() == 1);
+
+    // Big allocations get their own chunk and don't waste the current one.
+    ASSERT_TRUE(arena.allocate(4096, 8) != nullptr);
+    ASSERT_TRUE(memory.stats().allocations() == 2);
+
+    std::string_view s2 = arena.store("other");
+    ASSERT_TRUE(s2.data() > s.data() && s2.data() < s.data() + 1024);
+    ASSERT_TRUE(memory.stats().allocations() == 2);
+    ASSERT_TRUE(arena.used() == 14 + 24 + 4096 + 6);
+
+    arena.release();
+    ASSERT_TRUE(arena.used() == 0);
+    ASSERT_TRUE(arena.reserved() == 0);
+    ASSERT_TRUE(memory.stats().live() == 0);
+}
+
+TEST(memory_test, arena_pool_per_thread)
+{
+    Arena_pool pool;
+
+    Arena* main_arena = &pool.local();
+    ASSERT_TRUE(&pool.local() == main_arena);
+
+    Arena* thread_arena = nullptr;
+    std::thread t{[&] { thread_arena = &pool.local(); }};
+    t.join();
+
+    ASSERT_TRUE(thread_arena != nullptr);
+    ASSERT_TRUE(thread_arena != main_arena);
+
+    // Other pool on the same thread gets its own arena.
+    Arena_pool other;
+    ASSERT_TRUE(&other.local() != main_arena);
+    ASSERT_TRUE(&pool.local() == main_arena);
+}
+
+TEST(memory_test, files_memory)
+{
+    Files files;
+
+    const std::string path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    for (usize i = 0; i < 100; ++i)
+        files.insert(path + std::format("file_{}", i));
+
+    ASSERT_TRUE(files.memory_stats().live() > 0);
+    ASSERT_TRUE(files.memory_stats().requested() >= 100 * sizeof(usize));
+
+    auto r = files.search("file_42");
+    ASSERT_TRUE(r.size() == 1);
+    ASSERT_TRUE(r[0].name() == "file_42");
+    ASSERT_TRUE(r[0].name().data()[r[0].name().size()] == '\0');
+
+    for (usize i = 0; i < 100; ++i)
+        files.erase(path + std::format("file_{}", i));
+
+    ASSERT_TRUE(files.search("file").empty());
+}
+
+TEST(memory_test, front_coded_names)
+{
+    Tracking_resource memory;
+    Front_coded_names names{&memory};
+
+    std::vector<std::string> expected;
+    std::vector<Front_coded_names::Entry> entries;
+    for (usize i = 0; i < 100; ++i) {
+        expected.push_back(i < 50 ? std::format("libfoo.so.{}", i) : std::format("foo_{}.h", i));
+        entries.push_back(names.add(expected.back()));
+    }
+
+    expected.push_back(std::string(20'000, 'x'));
+    entries.push_back(names.add(expected.back()));
+    expected.push_back("libfoo.so");
+    entries.push_back(names.add(expected.back()));
+
+    ASSERT_TRUE(names.count() == expected.size());
+    ASSERT_TRUE(names.used() < names.raw_size());
+
+    // Sequential decoding.
+    Front_coded_names::Cursor cursor;
+    for (usize i = 0; i < entries.size(); ++i)
+        ASSERT_TRUE(names.get(entries[i], cursor) == expected[i]);
+
+    // Random decoding.
+    for (usize i : {usize(42), usize(3), usize(101), usize(17), usize(16), usize(100)})
+        ASSERT_TRUE(names.get(entries[i], cursor) == expected[i]);
+}
+
+TEST(memory_test, files_compressed_names)
+{
+    Files files{Files::Options{.m_compress_names = true}};
+
+    const std::string path =
+#if defined _WIN32
+        R"(C:\User\win_user_1\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    for (usize i = 0; i < 100; ++i)
+        files.insert(path + std::format("libfoo.so.{}", i));
+
+    auto r = files.search("libfoo.so.42");
+    ASSERT_TRUE(r.size() == 1);
+    ASSERT_TRUE(r[0].name() == "libfoo.so.42");
+    ASSERT_TRUE(r[0].full_path() == path + "libfoo.so.42");
+    ASSERT_TRUE(files.search("so.1").size() == 11);
+
+    files.erase(path + "libfoo.so.42");
+    ASSERT_TRUE(files.search("libfoo.so.42").empty());
+    ASSERT_TRUE(files.files_count() == 99);
+}
+
+TEST(memory_test, symbols_share_line_previews)
+{
+    Symbols symbols;
+    const File_id file{0};
+
+    const std::string preview = "int symbol_1 = symbol_2;";
+    symbols.insert("symbol_1", file, 1, preview);
+    symbols.insert("symbol_2", file, 1, preview);
+
+    const Symbol* s1 = symbols.search("symbol_1");
+    const Symbol* s2 = symbols.search("symbol_2");
+    ASSERT_TRUE(s1 != nullptr && s2 != nullptr);
+    ASSERT_TRUE(std::string_view{s1->name()} == "symbol_1");
+    ASSERT_TRUE(s1->refs()[0].lines()[0].preview() == s2->refs()[0].lines()[0].preview());
+    ASSERT_TRUE(symbols.symbols_size() >= symbols.memory_stats().usable());
+}
+
+// NOLINTEND
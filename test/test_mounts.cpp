@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "mounts.hpp"
+
+// NOLINTBEGIN
+
+TEST(mounts_test, mountinfo)
+{
+    const std::string mountinfo =
+        "22 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw\n"
+        "23 22 0:21 / /proc rw,nosuid shared:12 - proc proc rw\n"
+        "24 22 0:22 / /sys rw,nosuid shared:2 - sysfs sysfs rw\n"
+        "25 24 0:23 / /sys/fs/cgroup rw - cgroup2 cgroup2 rw\n"
+        "30 22 0:40 / /mnt/nas rw shared:20 - nfs4 server:/export rw\n"
+        "31 22 0:41 / /home/user/remote rw - fuse.sshfs user@host: rw\n"
+        "32 22 8:17 / /mnt/my\\040disk rw - ext4 /dev/sdb1 rw\n"
+        "33 22 0:50 / /var/lib/docker/overlay2/x/merged rw - overlay overlay rw\n"
+        "34 22 8:17 /dir /mnt/bind rw - ext4 /dev/sdb1 rw\n"
+        "malformed line\n"
+        "35 22 0:60 / /tmp rw shared:5 - tmpfs tmpfs rw\n";
+
+    const Mount_table mounts{mountinfo};
+    ASSERT_TRUE(mounts.size() == 10);
+
+    using Kind = Mount_table::Kind;
+    ASSERT_TRUE(mounts.mount_at("/proc")->m_kind == Kind::pseudo);
+    ASSERT_TRUE(mounts.mount_at("/sys/fs/cgroup")->m_kind == Kind::pseudo);
+    ASSERT_TRUE(mounts.mount_at("/mnt/nas")->m_kind == Kind::remote);
+    ASSERT_TRUE(mounts.mount_at("/home/user/remote")->m_kind == Kind::fuse);
+    ASSERT_TRUE(mounts.mount_at("/home/user/remote")->m_type == "fuse.sshfs");
+    ASSERT_TRUE(mounts.mount_at("/var/lib/docker/overlay2/x/merged")->m_kind == Kind::overlay);
+    ASSERT_TRUE(mounts.mount_at("/tmp")->m_kind == Kind::local);
+    ASSERT_TRUE(mounts.mount_at("/mnt") == nullptr);
+
+    // Escaped mount points, and devices shared by bind mounts.
+    ASSERT_TRUE(mounts.mount_at("/mnt/my disk") != nullptr);
+    ASSERT_TRUE(mounts.mount_at("/mnt/my disk")->m_device == ((u64(8) << 32) | 17));
+    ASSERT_TRUE(mounts.mount_at("/mnt/bind")->m_device ==
+                mounts.mount_at("/mnt/my disk")->m_device);
+
+    // Mount of a path is the one with the longest mount point.
+    ASSERT_TRUE(mounts.mount_of("/home/user/src")->m_point == "/");
+    ASSERT_TRUE(mounts.mount_of("/sys/fs/cgroup/cpu")->m_point == "/sys/fs/cgroup");
+    ASSERT_TRUE(mounts.mount_of("/sys/fs")->m_point == "/sys");
+    ASSERT_TRUE(mounts.mount_of("/tmpfile")->m_point == "/");
+
+    ASSERT_TRUE(Mount_table{""}.size() == 0);
+}
+
+// NOLINTEND
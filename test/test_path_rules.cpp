@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "path_rules.hpp"
+
+// NOLINTBEGIN
+
+static bool indexed(const Path_rules& rules, const std::string& path)
+{
+    return rules.check(path).m_index;
+}
+
+static bool entered(const Path_rules& rules, const std::string& path)
+{
+    return rules.check(path).m_recurse;
+}
+
+TEST(path_rules_test, ignore_and_include)
+{
+    const Path_rules none;
+    ASSERT_TRUE(indexed(none, "/usr/lib") && entered(none, "/usr/lib"));
+
+    const Path_rules rules{{"/usr", "/proc", "/home/user/.cache"},
+                           {"/usr/lib/python3", "/home/user/.cache/keep"}};
+
+    ASSERT_TRUE(indexed(rules, "/home/user/src"));
+    ASSERT_TRUE(indexed(rules, "/us"));
+    ASSERT_TRUE(indexed(rules, "/p"));
+
+    // Ignore rules are prefixes, like before.
+    ASSERT_TRUE(!indexed(rules, "/proc") && !entered(rules, "/proc"));
+    ASSERT_TRUE(!indexed(rules, "/proc/1/maps") && !entered(rules, "/proc/1/maps"));
+    ASSERT_TRUE(!indexed(rules, "/usr_local") && !entered(rules, "/usr_local"));
+
+    // Ignored directories on the way to an include are entered, but not indexed.
+    ASSERT_TRUE(!indexed(rules, "/usr") && entered(rules, "/usr"));
+    ASSERT_TRUE(!indexed(rules, "/usr/lib") && entered(rules, "/usr/lib"));
+    ASSERT_TRUE(!indexed(rules, "/usr/share") && !entered(rules, "/usr/share"));
+    ASSERT_TRUE(!indexed(rules, "/home/user/.cache") && entered(rules, "/home/user/.cache"));
+    ASSERT_TRUE(!entered(rules, "/home/user/.cache/tmp"));
+
+    // Included paths and everything below them are indexed.
+    ASSERT_TRUE(indexed(rules, "/usr/lib/python3") && entered(rules, "/usr/lib/python3"));
+    ASSERT_TRUE(indexed(rules, "/usr/lib/python3/os.py"));
+    ASSERT_TRUE(indexed(rules, "/home/user/.cache/keep/a/b"));
+
+    // Ignore rule added after the include rule below it doesn't hide the include.
+    Path_rules later{{}, {"/mnt/data"}};
+    later.ignore("/mnt");
+    ASSERT_TRUE(!entered(later, "/mnt/c") && entered(later, "/mnt"));
+    ASSERT_TRUE(indexed(later, "/mnt/data/x"));
+}
+
+TEST(path_rules_test, long_lists)
+{
+    std::vector<std::string> ignore_list;
+    for (int i = 0; i < 10'000; ++i)
+        ignore_list.push_back("/data/set_" + std::to_string(i) + "/");
+
+    const Path_rules rules{ignore_list, {"/data/set_42/keep"}};
+    ASSERT_TRUE(!entered(rules, "/data/set_7/a"));
+    ASSERT_TRUE(indexed(rules, "/data/set_7"));
+    ASSERT_TRUE(indexed(rules, "/data/set_10000/a"));
+    ASSERT_TRUE(!indexed(rules, "/data/set_42/") && entered(rules, "/data/set_42/"));
+    ASSERT_TRUE(indexed(rules, "/data/set_42/keep/x"));
+}
+
+// NOLINTEND
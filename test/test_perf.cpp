@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "perf.hpp"
+
+// NOLINTBEGIN
+
+static Perf_sample sample(u64 cycles, u64 instructions, u64 cache_misses, u64 branches,
+                          u64 branch_misses)
+{
+    return Perf_sample{{cycles, instructions, cache_misses, branches, branch_misses}};
+}
+
+TEST(perf_test, sample_arithmetic)
+{
+    Perf_sample sum = sample(10, 20, 1, 2, 3);
+    sum += sample(5, 10, 0, 1, 1);
+    ASSERT_TRUE(sum.m_values == sample(15, 30, 1, 3, 4).m_values);
+    ASSERT_TRUE(sum.ipc() == 2.0);
+    ASSERT_TRUE(Perf_sample{}.ipc() == 0.0);
+
+    // Later read can be smaller when multiplexing scale changes, difference saturates at 0.
+    const Perf_sample diff = sample(100, 50, 7, 9, 2) - sample(40, 60, 7, 3, 5);
+    ASSERT_TRUE(diff.m_values == sample(60, 0, 0, 6, 0).m_values);
+    ASSERT_TRUE(diff[Perf_event::cycles] == 60 && diff[Perf_event::branches] == 6);
+}
+
+TEST(perf_test, stats_per_stage)
+{
+    Perf_stats stats;
+    ASSERT_TRUE(stats.stages().empty());
+    ASSERT_TRUE(stats.to_json() == "{}");
+
+    stats.add("scan", sample(10, 20, 1, 2, 3));
+    stats.add("crawl", sample(4, 2, 0, 0, 0));
+    stats.add("scan", sample(30, 20, 1, 0, 1));
+
+    const auto stages = stats.stages();
+    ASSERT_TRUE(stages.size() == 2);
+    ASSERT_TRUE(stages.at("scan").m_count == 2);
+    ASSERT_TRUE(stages.at("scan").m_sample.m_values == sample(40, 40, 2, 2, 4).m_values);
+    ASSERT_TRUE(stages.at("crawl").m_count == 1);
+
+    // Stages are ordered by name.
+    const std::string expected =
+        "{\n"
+        "    \"crawl\": {\"count\": 1, \"ipc\": 0.500, \"cycles\": 4, \"instructions\": 2, "
+        "\"cache_misses\": 0, \"branches\": 0, \"branch_misses\": 0},\n"
+        "    \"scan\": {\"count\": 2, \"ipc\": 1.000, \"cycles\": 40, \"instructions\": 40, "
+        "\"cache_misses\": 2, \"branches\": 2, \"branch_misses\": 4}\n"
+        "  }";
+    ASSERT_TRUE(stats.to_json() == expected);
+}
+
+// NOLINTEND
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+#include "files.hpp"
+#include "regex.hpp"
+
+// NOLINTBEGIN
+
+static bool matches(const std::string& pattern, std::string_view text)
+{
+    const Regex regex{pattern};
+    Regex::Dfa dfa{regex};
+    return dfa.search(text);
+}
+
+TEST(regex_test, syntax)
+{
+    ASSERT_TRUE(matches("abc", "xxabcxx"));
+    ASSERT_TRUE(!matches("abd", "xxabcxx"));
+    ASSERT_TRUE(matches("a.c", "abc"));
+    ASSERT_TRUE(matches("^abc$", "abc"));
+    ASSERT_TRUE(!matches("^abc$", "abcd"));
+    ASSERT_TRUE(!matches("^bc", "abc"));
+    ASSERT_TRUE(matches("bc$", "abc"));
+    ASSERT_TRUE(matches("^(foo|bar)_\\d+\\.txt$", "bar_42.txt"));
+    ASSERT_TRUE(!matches("^(foo|bar)_\\d+\\.txt$", "baz_42.txt"));
+    ASSERT_TRUE(!matches("^(foo|bar)_\\d+\\.txt$", "foo_.txt"));
+    ASSERT_TRUE(matches("^[a-c]+[^a-c]$", "abcabcx"));
+    ASSERT_TRUE(!matches("^[a-c]+[^a-c]$", "abcabc"));
+    ASSERT_TRUE(matches("^a{2,3}$", "aaa"));
+    ASSERT_TRUE(!matches("^a{2,3}$", "aaaa"));
+    ASSERT_TRUE(matches("^a{2}b?$", "aab"));
+    ASSERT_TRUE(matches("^x{1,}$", "xxxx"));
+    ASSERT_TRUE(matches("a{x}", "a{x}")); // Not a quantifier, braces are literals.
+    ASSERT_TRUE(matches("^(?:ab)*$", ""));
+    ASSERT_TRUE(matches("^\\w+\\s\\W$", "file_1 ."));
+    ASSERT_TRUE(matches("^caf.$", "caf\xC3\xA9"));
+    ASSERT_TRUE(matches("^caf[^a]$", "caf\xC3\xA9"));
+    ASSERT_TRUE(matches("^\xC3\xA9+$", "\xC3\xA9\xC3\xA9"));
+
+    for (const char* invalid : {"(ab", "ab)", "[ab", "*a", "a\\", "\\q", "[z-a]", "a{3,2}",
+                                "a{1001}", "(?=a)"})
+        ASSERT_THROW(Regex{invalid}, std::runtime_error);
+}
+
+TEST(regex_test, required_literals)
+{
+    ASSERT_TRUE(Regex{"^lib.*\\.so\\.\\d+$"}.literals() ==
+                (std::vector<std::string>{"lib", ".so."}));
+    ASSERT_TRUE(Regex{"abc+d"}.literals() == (std::vector<std::string>{"abc", "d"}));
+    ASSERT_TRUE(Regex{"a?b(cd)+e"}.literals() == (std::vector<std::string>{"bcd", "e"}));
+    ASSERT_TRUE(Regex{"foo|bar"}.literals().empty());
+}
+
+TEST(regex_test, adversarial_patterns)
+{
+    // Exponential for backtracking engines, linear here.
+    const Regex regex{"^(a+)+$"};
+    Regex::Dfa dfa{regex};
+    ASSERT_TRUE(!dfa.search(std::string(10'000, 'a') + "b"));
+    ASSERT_TRUE(dfa.search(std::string(10'000, 'a')));
+
+    // DFA for (a|b)*a(a|b){12} has thousands of states, the cache is cleared when it is full.
+    const Regex big{"(a|b)*a(a|b){12}$"};
+    Regex::Dfa big_dfa{big};
+    std::string text;
+    for (usize i = 0; i < 100'000; ++i)
+        text += (i * 7919 % 13) < 6 ? 'a' : 'b';
+
+    ASSERT_TRUE(big_dfa.search(text) == (text[text.size() - 13] == 'a'));
+    ASSERT_TRUE(big_dfa.cache_size() <= Regex::Dfa::max_cache_size + 64 * 1024);
+
+    ASSERT_THROW(Regex{"((((((((((a{1000}){1000}))))))))))"}, std::runtime_error);
+    ASSERT_THROW(Regex{std::string(100, '(') + std::string(100, ')')}, std::runtime_error);
+    ASSERT_THROW(Regex{std::string(2000, 'a')}, std::runtime_error);
+}
+
+TEST(regex_test, files_search)
+{
+    Files files;
+
+    const std::string file_path =
+#if defined _WIN32
+        R"(C:\\User\\win_user_1\\)";
+#elif defined __linux__
+        R"(/User/win_user_1/)";
+#endif
+
+    for (const char* name : {"libfoo.so.1", "libfoo.so", "foo_test.cpp", "Main.cpp", "main.h"})
+        files.insert(file_path + name);
+
+    auto r = files.partial_search(files.compile_regex("^lib.*\\.so\\.\\d+$"), 1, 0);
+    ASSERT_TRUE(r.size() == 1);
+    ASSERT_TRUE(r[0].name() == "libfoo.so.1");
+
+    // Smart case.
+    ASSERT_TRUE(files.partial_search(files.compile_regex("^main\\.(cpp|h)$"), 1, 0).size() == 2);
+    ASSERT_TRUE(files.partial_search(files.compile_regex("^Main\\."), 1, 0).size() == 1);
+    ASSERT_TRUE(files.partial_search(files.compile_regex("^\\w+\\.\\w$"), 1, 0).size() == 1);
+
+    // Highlight is the leftmost longest match.
+    r = files.partial_search(files.compile_regex("_t\\w+"), 1, 0);
+    ASSERT_TRUE(r.size() == 1);
+    for (usize i = 0; i < 12; ++i)
+        ASSERT_TRUE(r[0].match_bs()[file_path.size() + i] == (i >= 3 && i < 8));
+
+    // Path filters directories, same as for wildcard queries.
+    ASSERT_TRUE(files.partial_search(files.compile_regex("\\.cpp$", file_path), 1, 0).size() ==
+                2);
+    ASSERT_TRUE(files.partial_search(files.compile_regex("\\.cpp$", "/none/"), 1, 0).empty());
+
+    // Incomplete regex while typing matches nothing.
+    const auto invalid = files.compile_regex("main(");
+    ASSERT_TRUE(!invalid.m_error.empty());
+    ASSERT_TRUE(files.partial_search(invalid, 1, 0).empty());
+    ASSERT_TRUE(!files.fuzzy(files.compile_regex("mian")));
+}
+
+// NOLINTEND
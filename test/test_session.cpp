@@ -0,0 +1,84 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <variant>
+
+#include "os.hpp"
+#include "session.hpp"
+#include "util.hpp"
+
+// NOLINTBEGIN
+
+namespace fs = std::filesystem;
+
+static std::string session_path(const std::string& name)
+{
+    return (fs::temp_directory_path() / ("finder_session_test_" + name)).string();
+}
+
+static bool loads(const std::string& text)
+{
+    const std::string path = session_path("invalid");
+    std::ofstream{path} << text;
+
+    try {
+        Session::load(path);
+        return true;
+    }
+    catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+TEST(session_test, record_and_load)
+{
+    const std::string path = session_path("record");
+    {
+        Session_recorder recorder{path, "/home/user", 1234, 5678,
+                                  os::Coordinates{.x = 120, .y = 40}};
+        std::this_thread::sleep_for(20ms);
+        recorder.record(os::ConsoleInput{i32('a')});
+        recorder.record(os::ConsoleInput{os::Coordinates{.x = 100, .y = 30}});
+        recorder.record(os::ConsoleInput{i32(17)});
+    }
+
+    const Session session = Session::load(path);
+    ASSERT_TRUE(session.m_root == "/home/user");
+    ASSERT_TRUE(session.m_files_count == 1234);
+    ASSERT_TRUE(session.m_generation == 5678);
+    ASSERT_TRUE(session.m_terminal.x == 120 && session.m_terminal.y == 40);
+
+    ASSERT_TRUE(session.m_events.size() == 3);
+    ASSERT_TRUE(std::get<i32>(session.m_events[0].m_input) == 'a');
+    ASSERT_TRUE(session.m_events[0].m_delay >= 20ms);
+
+    const auto resize = std::get<os::Coordinates>(session.m_events[1].m_input);
+    ASSERT_TRUE(resize.x == 100 && resize.y == 30);
+    ASSERT_TRUE(session.m_events[1].m_delay < session.m_events[0].m_delay);
+    ASSERT_TRUE(std::get<i32>(session.m_events[2].m_input) == 17);
+
+    // Delays are read as written.
+    ASSERT_TRUE(loads("finder-session 1\nkey 153000 102\nresize 2000 100 30\n"));
+    std::ofstream{path} << "finder-session 1\nroot / with space\nkey 153000 102\n\n";
+    const Session manual = Session::load(path);
+    ASSERT_TRUE(manual.m_root == "/ with space");
+    ASSERT_TRUE(manual.m_events.size() == 1 && manual.m_events[0].m_delay == 153000us);
+}
+
+TEST(session_test, invalid_files)
+{
+    ASSERT_TRUE(!loads(""));
+    ASSERT_TRUE(!loads("finder-session 2\nfiles 1\n"));
+    ASSERT_TRUE(!loads("finder-log 1\n"));
+    ASSERT_TRUE(!loads("finder-session 1\nfiles 1\nmouse 10 1 1\n"));
+    ASSERT_TRUE(!loads("finder-session 1\nkey 153000\n"));
+    ASSERT_TRUE(!loads("finder-session 1\nresize 2000 100\n"));
+    ASSERT_TRUE(!loads("finder-session 1\nfiles many\n"));
+
+    ASSERT_THROW(Session::load(session_path("missing_file")), std::runtime_error);
+}
+
+// NOLINTEND
@@ -37,14 +37,37 @@
  * defined and including Tracy.hpp in every file that needs instrumentation. Just put T prefix
  * (TZoneScoped for example) and profile...
  * Please define all other macros that you wish to use and are not defined here.
+ *
+ * Lockable macros declare a plain mutex when tracy is disabled, so use them for every mutex that
+ * should show up in tracy contention view, e.g. TTracyLockable(std::mutex, m_lock).
  */
 #ifdef TRACY_ENABLE
 #include "tracy/Tracy.hpp"
 #define TZoneScoped ZoneScoped
+#define TZoneScopedN(name) ZoneScopedN(name)
+#define TZoneValue(x) ZoneValue(x)
 #define TTracyMessageL(x) TracyMessageL(x)
+#define TTracyPlot(name, x) TracyPlot(name, x)
+#define TFrameMark FrameMark
+#define TTracyLockable(type, var) TracyLockable(type, var)
+#define TTracyLockableN(type, var, desc) TracyLockableN(type, var, desc)
+#define TLockableBase(type) LockableBase(type)
+#define TTracySharedLockableN(type, var, desc) TracySharedLockableN(type, var, desc)
+#define TSharedLockableBase(type) SharedLockableBase(type)
+#define TLockMark(var) LockMark(var)
 #else
 #define TZoneScoped NO_OP
+#define TZoneScopedN(name) NO_OP
+#define TZoneValue(x) NO_OP
 #define TTracyMessageL(x) NO_OP
+#define TTracyPlot(name, x) NO_OP
+#define TFrameMark NO_OP
+#define TTracyLockable(type, var) type var
+#define TTracyLockableN(type, var, desc) type var
+#define TLockableBase(type) type
+#define TTracySharedLockableN(type, var, desc) type var
+#define TSharedLockableBase(type) type
+#define TLockMark(var) NO_OP
 #endif // TRACY_ENABLE
 
 #ifdef __cpp_lib_hardware_interference_size
@@ -111,6 +134,14 @@ inline Time_point now() noexcept
     return Clock::now();
 }
 
+/**
+ * Wall clock time in seconds since epoch, for timestamps that outlive the process.
+ */
+inline i64 unix_time() noexcept
+{
+    return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+}
+
 /**
  * Stopwatch that uses steady_clock for time measurement.
  * You can pass time Unit for default formatting if print is specified. Default is milliseconds.